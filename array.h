@@ -2,6 +2,18 @@
 #include <stdint.h>
 #include <string.h>
 #include <cassert>
+#include <new>
+#include <utility>
+#include "memory.h"
+
+// Where Array's data lives, determines how the array grows and is released.
+enum ArrayStorage {
+    ARRAY_STORAGE_HEAP,
+    // Data points into InlineArray's own buffer, moves to heap once it doesn't fit.
+    ARRAY_STORAGE_INLINE,
+    // Data is taken from a StackAllocator and goes away when the allocator is reset.
+    ARRAY_STORAGE_ARENA,
+};
 
 // Array is a data struct used as a dynamically allocated list.
 template <typename T>
@@ -9,12 +21,22 @@ struct Array {
     T *data;
     uint32_t count;
     uint32_t size;
+    MemoryTag tag;
+    ArrayStorage storage;
+    StackAllocator *allocator;
 
     T& operator[](uint32_t index) {
         return (this->data[index]);
     }
 };
 
+// InlineArray keeps first N items inside the struct itself, so short arrays never touch the heap.
+// It can be passed anywhere Array<T> * is expected, but it must not be copied by value.
+template <typename T, uint32_t N>
+struct InlineArray : Array<T> {
+    T inline_data[N];
+};
+
 
 // `array` namespace handles operations on Array.
 namespace array {
@@ -23,18 +45,53 @@ namespace array {
     
     //  Initialize Array
     template <typename T>
-    void init(Array<T> *array, uint32_t size) {
+    void init(Array<T> *array, uint32_t size, MemoryTag tag = MEMORY_TAG_GENERAL) {
         array->size = size;
         array->count = 0;
-        array->data = (T *)malloc(size * sizeof(T));
+        array->tag = tag;
+        array->storage = ARRAY_STORAGE_HEAP;
+        array->allocator = NULL;
+        array->data = memory::alloc_heap<T>(size, tag);
         assert(array->data);
     }
 
+    //  Initialize Array with memory from `allocator`. Its memory is never freed on its own,
+    //  the whole array is dropped by resetting the allocator (e.g. at the end of a frame).
+    template <typename T>
+    void init(Array<T> *array, uint32_t size, StackAllocator *allocator) {
+        array->size = size;
+        array->count = 0;
+        array->tag = allocator->tag;
+        array->storage = ARRAY_STORAGE_ARENA;
+        array->allocator = allocator;
+        array->data = memory::alloc_stack<T>(allocator, size);
+        assert(array->data);
+    }
+
+    //  Initialize InlineArray, no memory is allocated until the array outgrows N items.
+    template <typename T, uint32_t N>
+    void init(InlineArray<T, N> *array, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        array->size = N;
+        array->count = 0;
+        array->tag = tag;
+        array->storage = ARRAY_STORAGE_INLINE;
+        array->allocator = NULL;
+        array->data = array->inline_data;
+    }
+
     //  Returns initialized Array
     template <typename T>
-    Array<T> get(uint32_t size) {
+    Array<T> get(uint32_t size, MemoryTag tag = MEMORY_TAG_GENERAL) {
         Array<T> array;
-        array::init(&array, size);
+        array::init(&array, size, tag);
+        return array;
+    }
+
+    //  Returns initialized arena-backed Array
+    template <typename T>
+    Array<T> get(uint32_t size, StackAllocator *allocator) {
+        Array<T> array;
+        array::init(&array, size, allocator);
         return array;
     }
 
@@ -44,26 +101,106 @@ namespace array {
         array->count = 0;
     }
 
+    // Make sure the array can hold at least `size` items. Heap arrays grow with realloc and
+    // arena arrays sitting on top of their arena just bump it, so the block can often be
+    // extended in place instead of being copied.
+    template <typename T>
+    void reserve(Array<T> *array, uint32_t size) {
+        if(size <= array->size) return;
+
+        memory::track_array_growth(array->tag);
+        T *new_mem = NULL;
+        if(array->storage == ARRAY_STORAGE_INLINE) {
+            new_mem = memory::alloc_heap<T>(size, array->tag);
+            assert(new_mem);
+            memcpy(new_mem, array->data, sizeof(T) * array->count);
+            array->storage = ARRAY_STORAGE_HEAP;
+        } else if(array->storage == ARRAY_STORAGE_ARENA) {
+            StackAllocator *allocator = array->allocator;
+            char *arena_top = (char *)allocator->storage + allocator->top;
+            if((char *)(array->data + array->size) == arena_top) {
+                // Alignment of 1 makes sure the extension starts right at the end of the array.
+                T *extension = memory::alloc_stack<T>(allocator, size - array->size, 1);
+                assert(extension);
+                new_mem = array->data;
+            } else {
+                // The old block is left behind until the allocator is reset.
+                new_mem = memory::alloc_stack<T>(allocator, size);
+                assert(new_mem);
+                memcpy(new_mem, array->data, sizeof(T) * array->count);
+            }
+        } else {
+            new_mem = memory::realloc_heap<T>(array->data, size, array->tag);
+            assert(new_mem);
+        }
+        array->data = new_mem;
+        array->size = size;
+    }
+
+    // Grow geometrically so that `count` items fit.
+    template <typename T>
+    void grow(Array<T> *array, uint32_t count) {
+        uint32_t new_size = array->size > 0 ? array->size : 1;
+        while(new_size < count) {
+            new_size *= array_expansion_ratio;
+        }
+        array::reserve(array, new_size);
+    }
+
+    // Set number of items in the array, new items are left uninitialized.
+    template <typename T>
+    void resize(Array<T> *array, uint32_t count) {
+        if(count > array->size) {
+            array::grow(array, count);
+        }
+        array->count = count;
+    }
+
     // Add an element into array, possibly reallocate and move all the contents
     template <typename T>
-    void add(Array<T> *array, T item) {
+    void add(Array<T> *array, const T &item) {
         // In case the array is full, reallocate
         if(array->size == array->count) {
-            T *new_mem = (T *)malloc(array->size * array_expansion_ratio * sizeof(T));
-            assert(new_mem);
-            memcpy(new_mem, array->data, sizeof(T) * array->size);
-            free(array->data);
-            array->data = new_mem;
-            array->size *= array_expansion_ratio;
+            // `item` may live inside the array itself, copy it before data moves.
+            if(&item >= array->data && &item < array->data + array->count) {
+                T item_copy = item;
+                array::grow(array, array->count + 1);
+                array->data[array->count++] = item_copy;
+                return;
+            }
+            array::grow(array, array->count + 1);
         }
 
         array->data[array->count++] = item;
     }
 
+    // Add `count` elements at once, reallocating at most once.
+    template <typename T>
+    void add_n(Array<T> *array, const T *items, uint32_t count) {
+        if(array->count + count > array->size) {
+            array::grow(array, array->count + count);
+        }
+        memcpy(array->data + array->count, items, sizeof(T) * count);
+        array->count += count;
+    }
+
+    // Construct a new element directly in array's memory and return pointer to it.
+    template <typename T, typename... Args>
+    T *emplace(Array<T> *array, Args&&... args) {
+        if(array->size == array->count) {
+            array::grow(array, array->count + 1);
+        }
+        T *item = new (&array->data[array->count++]) T{std::forward<Args>(args)...};
+        return item;
+    }
+
     // Completely release the array, freeing all the memory
     template <typename T>
     void release(Array<T> *array) {
-        free(array->data);
+        if(array->storage == ARRAY_STORAGE_HEAP) {
+            memory::free_heap(array->data, array->tag);
+        }
+        array->data = NULL;
         array->size = 0;
         array->count = 0;
     }
@@ -0,0 +1,593 @@
+#include "bvh.h"
+#include "jobs.h"
+#include "memory.h"
+#include <atomic>
+
+/*
+
+Primitive section.
+
+*/
+
+inline Vector3 component_min(Vector3 a, Vector3 b) {
+    return Vector3(math::min(a.x, b.x), math::min(a.y, b.y), math::min(a.z, b.z));
+}
+
+inline Vector3 component_max(Vector3 a, Vector3 b) {
+    return Vector3(math::max(a.x, b.x), math::max(a.y, b.y), math::max(a.z, b.z));
+}
+
+inline void get_triangle(BVH *bvh, uint32_t triangle, Vector3 *a, Vector3 *b, Vector3 *c) {
+    if(bvh->indices) {
+        *a = bvh->vertices[bvh->indices[triangle * 3 + 0]];
+        *b = bvh->vertices[bvh->indices[triangle * 3 + 1]];
+        *c = bvh->vertices[bvh->indices[triangle * 3 + 2]];
+    } else {
+        *a = bvh->vertices[triangle * 3 + 0];
+        *b = bvh->vertices[triangle * 3 + 1];
+        *c = bvh->vertices[triangle * 3 + 2];
+    }
+}
+
+void get_primitive_bounds(BVH *bvh, uint32_t primitive, Vector3 *lower, Vector3 *upper) {
+    if(bvh->type == BVH_BOXES) {
+        AABB box = bvh->boxes[primitive];
+        *lower = box.center - box.extents;
+        *upper = box.center + box.extents;
+    } else {
+        Vector3 a, b, c;
+        get_triangle(bvh, primitive, &a, &b, &c);
+        *lower = component_min(a, component_min(b, c));
+        *upper = component_max(a, component_max(b, c));
+    }
+}
+
+// Distance along the ray, -1 if the primitive is missed.
+float intersect_primitive(BVH *bvh, uint32_t primitive, Vector3 origin, Vector3 direction) {
+    if(bvh->type == BVH_BOXES) {
+        return math::ray_aabb_intersection(origin, direction, bvh->boxes[primitive]);
+    }
+    Vector3 a, b, c;
+    get_triangle(bvh, primitive, &a, &b, &c);
+    return math::ray_triangle_intersection(origin, direction, a, b, c);
+}
+
+/*
+
+Build section.
+
+Nodes come from an array big enough for the worst case (2n - 1 nodes). Both children of a node are
+allocated together after the node itself, so children always have bigger indices than their parents.
+
+*/
+
+const uint32_t SAH_BIN_COUNT = 16;
+// Cost of visiting a node relative to testing a primitive.
+const float SAH_TRAVERSAL_COST = 1.0f;
+const uint32_t MAX_LEAF_SIZE = 8;
+// Nodes deeper than this are split in the middle, which bounds the depth of the tree to 64 and so
+// the size of traversal stacks.
+const uint32_t SAH_MAX_DEPTH = 32;
+const uint32_t TRAVERSAL_STACK_SIZE = 128;
+// Subtrees with fewer primitives are built on the current thread.
+const uint32_t PARALLEL_BUILD_MIN_COUNT = 4096;
+
+struct Bounds {
+    Vector3 lower;
+    Vector3 upper;
+};
+
+inline Bounds get_empty_bounds() {
+    Bounds result;
+    result.lower = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+    result.upper = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    return result;
+}
+
+inline void grow(Bounds *bounds, Vector3 lower, Vector3 upper) {
+    bounds->lower = component_min(bounds->lower, lower);
+    bounds->upper = component_max(bounds->upper, upper);
+}
+
+// Half of the surface area, only ratios of areas matter for SAH.
+inline float get_half_area(Bounds bounds) {
+    Vector3 size = bounds.upper - bounds.lower;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+inline uint32_t get_bin(float centroid, float low, float scale) {
+    uint32_t bin = (uint32_t)((centroid - low) * scale);
+    return bin < SAH_BIN_COUNT ? bin : SAH_BIN_COUNT - 1;
+}
+
+struct BuildContext {
+    BVH *bvh;
+    Vector3 *lower;
+    Vector3 *upper;
+    Vector3 *centroids;
+    std::atomic<uint32_t> node_count;
+};
+
+struct BuildTask {
+    BuildContext *context;
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    uint32_t depth;
+};
+
+void build_node(BuildContext *context, uint32_t node_index, uint32_t first, uint32_t count, uint32_t depth);
+
+void build_node_job(void *data) {
+    BuildTask *task = (BuildTask *)data;
+    build_node(task->context, task->node, task->first, task->count, task->depth);
+}
+
+void build_node(BuildContext *context, uint32_t node_index, uint32_t first, uint32_t count, uint32_t depth) {
+    uint32_t *indices = context->bvh->primitive_indices;
+    BVHNode *node = &context->bvh->nodes[node_index];
+
+    Bounds bounds = get_empty_bounds();
+    Bounds centroid_bounds = get_empty_bounds();
+    for(uint32_t i = first; i < first + count; ++i) {
+        uint32_t primitive = indices[i];
+        grow(&bounds, context->lower[primitive], context->upper[primitive]);
+        grow(&centroid_bounds, context->centroids[primitive], context->centroids[primitive]);
+    }
+    node->lower = bounds.lower;
+    node->upper = bounds.upper;
+    node->first = first;
+    node->count = count;
+    if(count <= 2) return;
+
+    // Find the cheapest split between bins on all axes.
+    float best_cost = FLT_MAX;
+    int best_axis = -1;
+    uint32_t best_bin = 0;
+    for(int axis = 0; axis < 3 && depth < SAH_MAX_DEPTH; ++axis) {
+        float low = centroid_bounds.lower[axis];
+        float extent = centroid_bounds.upper[axis] - low;
+        if(extent <= 0.0f) continue;
+        float scale = SAH_BIN_COUNT / extent;
+
+        Bounds bins[SAH_BIN_COUNT];
+        uint32_t bin_counts[SAH_BIN_COUNT] = {};
+        for(uint32_t b = 0; b < SAH_BIN_COUNT; ++b) bins[b] = get_empty_bounds();
+        for(uint32_t i = first; i < first + count; ++i) {
+            uint32_t primitive = indices[i];
+            uint32_t bin = get_bin(context->centroids[primitive][axis], low, scale);
+            grow(&bins[bin], context->lower[primitive], context->upper[primitive]);
+            bin_counts[bin]++;
+        }
+
+        // Sweep from the right storing costs of the right sides, then from the left evaluating splits.
+        // Split b puts bins [0, b] on the left.
+        float right_costs[SAH_BIN_COUNT - 1];
+        Bounds right = get_empty_bounds();
+        uint32_t right_count = 0;
+        for(uint32_t b = SAH_BIN_COUNT - 1; b > 0; --b) {
+            grow(&right, bins[b].lower, bins[b].upper);
+            right_count += bin_counts[b];
+            right_costs[b - 1] = right_count ? get_half_area(right) * right_count : 0.0f;
+        }
+        Bounds left = get_empty_bounds();
+        uint32_t left_count = 0;
+        for(uint32_t b = 0; b < SAH_BIN_COUNT - 1; ++b) {
+            grow(&left, bins[b].lower, bins[b].upper);
+            left_count += bin_counts[b];
+            if(left_count == 0 || left_count == count) continue;
+            float cost = get_half_area(left) * left_count + right_costs[b];
+            if(cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = b;
+            }
+        }
+    }
+
+    float leaf_cost = get_half_area(bounds) * count;
+    float split_cost = get_half_area(bounds) * SAH_TRAVERSAL_COST + best_cost;
+    if(count <= MAX_LEAF_SIZE && (best_axis < 0 || leaf_cost <= split_cost)) return;
+
+    // Without a usable split (too deep or all centroids in one place) split in the middle.
+    uint32_t split = first + count / 2;
+    if(best_axis >= 0) {
+        float low = centroid_bounds.lower[best_axis];
+        float scale = SAH_BIN_COUNT / (centroid_bounds.upper[best_axis] - low);
+        uint32_t i = first;
+        uint32_t j = first + count;
+        while(i < j) {
+            if(get_bin(context->centroids[indices[i]][best_axis], low, scale) <= best_bin) {
+                ++i;
+            } else {
+                --j;
+                uint32_t temp = indices[i];
+                indices[i] = indices[j];
+                indices[j] = temp;
+            }
+        }
+        split = i;
+    }
+
+    uint32_t children = context->node_count.fetch_add(2, std::memory_order_relaxed);
+    node->first = children;
+    node->count = 0;
+
+    uint32_t left_count = split - first;
+    if(count >= PARALLEL_BUILD_MIN_COUNT) {
+        BuildTask task = {context, children, first, left_count, depth + 1};
+        JobCounter counter = {};
+        jobs::run(build_node_job, &task, &counter);
+        build_node(context, children + 1, split, count - left_count, depth + 1);
+        jobs::wait(&counter);
+    } else {
+        build_node(context, children, first, left_count, depth + 1);
+        build_node(context, children + 1, split, count - left_count, depth + 1);
+    }
+}
+
+void compute_primitive_bounds(void *data, uint32_t start, uint32_t end) {
+    BuildContext *context = (BuildContext *)data;
+    for(uint32_t i = start; i < end; ++i) {
+        get_primitive_bounds(context->bvh, i, &context->lower[i], &context->upper[i]);
+        context->centroids[i] = (context->lower[i] + context->upper[i]) * 0.5f;
+        context->bvh->primitive_indices[i] = i;
+    }
+}
+
+void build_tree(BVH *bvh) {
+    uint32_t count = bvh->primitive_count;
+    bvh->nodes = NULL;
+    bvh->node_count = 0;
+    bvh->primitive_indices = NULL;
+    if(count == 0) return;
+
+    bvh->nodes = memory::alloc_heap<BVHNode>(count * 2 - 1, MEMORY_TAG_BVH);
+    bvh->primitive_indices = memory::alloc_heap<uint32_t>(count, MEMORY_TAG_BVH);
+
+    BuildContext context;
+    context.bvh = bvh;
+    context.lower = memory::alloc_heap<Vector3>(count, MEMORY_TAG_BVH);
+    context.upper = memory::alloc_heap<Vector3>(count, MEMORY_TAG_BVH);
+    context.centroids = memory::alloc_heap<Vector3>(count, MEMORY_TAG_BVH);
+    context.node_count = 1;
+    jobs::parallel_for(count, compute_primitive_bounds, &context, PARALLEL_BUILD_MIN_COUNT);
+
+    build_node(&context, 0, 0, count, 0);
+    bvh->node_count = context.node_count.load();
+    bvh->nodes = memory::realloc_heap(bvh->nodes, bvh->node_count, MEMORY_TAG_BVH);
+
+    memory::free_heap(context.lower, MEMORY_TAG_BVH);
+    memory::free_heap(context.upper, MEMORY_TAG_BVH);
+    memory::free_heap(context.centroids, MEMORY_TAG_BVH);
+}
+
+BVH bvh::build(const AABB *boxes, uint32_t count) {
+    BVH result = {};
+    result.type = BVH_BOXES;
+    result.boxes = boxes;
+    result.primitive_count = count;
+    build_tree(&result);
+    return result;
+}
+
+BVH bvh::build(const Vector3 *vertices, const uint32_t *indices, uint32_t triangle_count) {
+    BVH result = {};
+    result.type = BVH_TRIANGLES;
+    result.vertices = vertices;
+    result.indices = indices;
+    result.primitive_count = triangle_count;
+    build_tree(&result);
+    return result;
+}
+
+// Children have bigger indices than their parents, so going backwards visits children first.
+void bvh::refit(BVH *bvh) {
+    for(uint32_t i = bvh->node_count; i > 0; --i) {
+        BVHNode *node = &bvh->nodes[i - 1];
+        Bounds bounds = get_empty_bounds();
+        if(node->count) {
+            for(uint32_t j = node->first; j < node->first + node->count; ++j) {
+                Vector3 lower, upper;
+                get_primitive_bounds(bvh, bvh->primitive_indices[j], &lower, &upper);
+                grow(&bounds, lower, upper);
+            }
+        } else {
+            grow(&bounds, bvh->nodes[node->first].lower, bvh->nodes[node->first].upper);
+            grow(&bounds, bvh->nodes[node->first + 1].lower, bvh->nodes[node->first + 1].upper);
+        }
+        node->lower = bounds.lower;
+        node->upper = bounds.upper;
+    }
+}
+
+void bvh::release(BVH *bvh) {
+    if(bvh->primitive_count) {
+        memory::free_heap(bvh->nodes, MEMORY_TAG_BVH);
+        memory::free_heap(bvh->primitive_indices, MEMORY_TAG_BVH);
+    }
+    *bvh = {};
+}
+
+/*
+
+Single ray traversal section.
+
+Closer child is visited first, the other one goes on a stack together with its entry distance,
+so it can be skipped once a closer hit is found.
+
+*/
+
+struct Ray {
+    Vector3 origin;
+    Vector3 direction;
+    Vector3 inverse_direction;
+};
+
+struct StackEntry {
+    uint32_t node;
+    float distance;
+};
+
+// Entry distance of the ray into the node, FLT_MAX if it misses or enters after `max_distance`.
+inline float intersect_node(BVHNode *node, Ray *ray, float max_distance) {
+    float entry = 0.0f;
+    float exit = max_distance;
+    for(int axis = 0; axis < 3; ++axis) {
+        float t0 = (node->lower[axis] - ray->origin[axis]) * ray->inverse_direction[axis];
+        float t1 = (node->upper[axis] - ray->origin[axis]) * ray->inverse_direction[axis];
+        entry = math::max(entry, math::min(t0, t1));
+        exit = math::min(exit, math::max(t0, t1));
+    }
+    return entry <= exit ? entry : FLT_MAX;
+}
+
+bool traverse(BVH *bvh, Ray *ray, float max_distance, bool any_hit, RayHit *hit) {
+    if(bvh->node_count == 0) return false;
+    float closest = max_distance;
+    uint32_t closest_primitive = BVH_NO_HIT;
+
+    StackEntry stack[TRAVERSAL_STACK_SIZE];
+    uint32_t stack_size = 0;
+    if(intersect_node(&bvh->nodes[0], ray, closest) != FLT_MAX) {
+        stack[stack_size++] = StackEntry{0, 0.0f};
+    }
+    while(stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if(entry.distance >= closest) continue;
+
+        BVHNode *node = &bvh->nodes[entry.node];
+        while(node->count == 0) {
+            uint32_t near = node->first;
+            uint32_t far = node->first + 1;
+            float near_distance = intersect_node(&bvh->nodes[near], ray, closest);
+            float far_distance = intersect_node(&bvh->nodes[far], ray, closest);
+            if(far_distance < near_distance) {
+                uint32_t temp = near;
+                near = far;
+                far = temp;
+                float temp_distance = near_distance;
+                near_distance = far_distance;
+                far_distance = temp_distance;
+            }
+            if(near_distance == FLT_MAX) break;
+            if(far_distance != FLT_MAX) {
+                stack[stack_size++] = StackEntry{far, far_distance};
+            }
+            node = &bvh->nodes[near];
+        }
+        if(node->count == 0) continue;
+
+        for(uint32_t i = node->first; i < node->first + node->count; ++i) {
+            uint32_t primitive = bvh->primitive_indices[i];
+            float distance = intersect_primitive(bvh, primitive, ray->origin, ray->direction);
+            if(distance >= 0.0f && distance < closest) {
+                closest = distance;
+                closest_primitive = primitive;
+                if(any_hit) break;
+            }
+        }
+        if(any_hit && closest_primitive != BVH_NO_HIT) break;
+    }
+
+    if(closest_primitive == BVH_NO_HIT) return false;
+    if(hit) {
+        hit->distance = closest;
+        hit->primitive = closest_primitive;
+    }
+    return true;
+}
+
+Ray get_ray(Vector3 origin, Vector3 direction) {
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.inverse_direction = Vector3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    return ray;
+}
+
+bool bvh::intersect(BVH *bvh, Vector3 origin, Vector3 direction, RayHit *hit, float max_distance) {
+    Ray ray = get_ray(origin, direction);
+    return traverse(bvh, &ray, max_distance, false, hit);
+}
+
+bool bvh::intersect_any(BVH *bvh, Vector3 origin, Vector3 direction, float max_distance) {
+    Ray ray = get_ray(origin, direction);
+    return traverse(bvh, &ray, max_distance, true, NULL);
+}
+
+/*
+
+Packet traversal section.
+
+4 rays go through the tree together, a node is visited if any of them hits it. Nodes and primitives
+are tested against all 4 rays at once with SSE.
+
+*/
+
+struct PacketData {
+    BVH *bvh;
+    const Vector3 *origins;
+    const Vector3 *directions;
+    uint32_t count;
+    RayHit *hits;
+    float max_distance;
+};
+
+#ifdef CPPLIB_MATHS_SSE
+struct RayPacket {
+    __m128 origin[3];
+    __m128 direction[3];
+    __m128 inverse_direction[3];
+};
+
+// Mask of rays entering the box before their `closest` distance.
+inline __m128 intersect_box_packet(Vector3 lower, Vector3 upper, RayPacket *packet, __m128 closest, __m128 *distance) {
+    __m128 entry = _mm_setzero_ps();
+    __m128 exit = closest;
+    for(int axis = 0; axis < 3; ++axis) {
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(lower[axis]), packet->origin[axis]), packet->inverse_direction[axis]);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(upper[axis]), packet->origin[axis]), packet->inverse_direction[axis]);
+        entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+        exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+    }
+    *distance = entry;
+    return _mm_cmple_ps(entry, exit);
+}
+
+// Same as math::ray_triangle_intersection for 4 rays.
+inline __m128 intersect_triangle_packet(Vector3 a, Vector3 b, Vector3 c, RayPacket *packet, __m128 *distance) {
+    Vector3 edge_1 = b - a;
+    Vector3 edge_2 = c - a;
+    __m128 e1_x = _mm_set1_ps(edge_1.x), e1_y = _mm_set1_ps(edge_1.y), e1_z = _mm_set1_ps(edge_1.z);
+    __m128 e2_x = _mm_set1_ps(edge_2.x), e2_y = _mm_set1_ps(edge_2.y), e2_z = _mm_set1_ps(edge_2.z);
+    __m128 *d = packet->direction;
+
+    __m128 p_x = _mm_sub_ps(_mm_mul_ps(d[1], e2_z), _mm_mul_ps(d[2], e2_y));
+    __m128 p_y = _mm_sub_ps(_mm_mul_ps(d[2], e2_x), _mm_mul_ps(d[0], e2_z));
+    __m128 p_z = _mm_sub_ps(_mm_mul_ps(d[0], e2_y), _mm_mul_ps(d[1], e2_x));
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1_x, p_x), _mm_mul_ps(e1_y, p_y)), _mm_mul_ps(e1_z, p_z));
+    __m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+    __m128 s_x = _mm_sub_ps(packet->origin[0], _mm_set1_ps(a.x));
+    __m128 s_y = _mm_sub_ps(packet->origin[1], _mm_set1_ps(a.y));
+    __m128 s_z = _mm_sub_ps(packet->origin[2], _mm_set1_ps(a.z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(s_x, p_x), _mm_mul_ps(s_y, p_y)), _mm_mul_ps(s_z, p_z)), inverse_determinant);
+
+    __m128 q_x = _mm_sub_ps(_mm_mul_ps(s_y, e1_z), _mm_mul_ps(s_z, e1_y));
+    __m128 q_y = _mm_sub_ps(_mm_mul_ps(s_z, e1_x), _mm_mul_ps(s_x, e1_z));
+    __m128 q_z = _mm_sub_ps(_mm_mul_ps(s_x, e1_y), _mm_mul_ps(s_y, e1_x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(d[0], q_x), _mm_mul_ps(d[1], q_y)), _mm_mul_ps(d[2], q_z)), inverse_determinant);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2_x, q_x), _mm_mul_ps(e2_y, q_y)), _mm_mul_ps(e2_z, q_z)), inverse_determinant);
+
+    __m128 zero = _mm_setzero_ps();
+    __m128 abs_determinant = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+    __m128 mask = _mm_cmpge_ps(abs_determinant, _mm_set1_ps(1e-12f));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+    mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    mask = _mm_and_ps(mask, _mm_cmpge_ps(t, zero));
+    *distance = t;
+    return mask;
+}
+
+void traverse_packet(BVH *bvh, RayPacket *packet, __m128 *closest, __m128i *primitives) {
+    uint32_t stack[TRAVERSAL_STACK_SIZE];
+    uint32_t stack_size = 0;
+    stack[stack_size++] = 0;
+
+    // Children are ordered by the first ray's direction.
+    Vector3 direction = Vector3(_mm_cvtss_f32(packet->direction[0]), _mm_cvtss_f32(packet->direction[1]), _mm_cvtss_f32(packet->direction[2]));
+    while(stack_size > 0) {
+        BVHNode *node = &bvh->nodes[stack[--stack_size]];
+        __m128 distance;
+        if(_mm_movemask_ps(intersect_box_packet(node->lower, node->upper, packet, *closest, &distance)) == 0) continue;
+
+        if(node->count == 0) {
+            BVHNode *left = &bvh->nodes[node->first];
+            BVHNode *right = &bvh->nodes[node->first + 1];
+            float left_to_right = math::dot((right->lower + right->upper) - (left->lower + left->upper), direction);
+            // Closer child goes on the stack last, so it's popped first.
+            if(left_to_right >= 0.0f) {
+                stack[stack_size++] = node->first + 1;
+                stack[stack_size++] = node->first;
+            } else {
+                stack[stack_size++] = node->first;
+                stack[stack_size++] = node->first + 1;
+            }
+            continue;
+        }
+
+        for(uint32_t i = node->first; i < node->first + node->count; ++i) {
+            uint32_t primitive = bvh->primitive_indices[i];
+            __m128 hit;
+            if(bvh->type == BVH_BOXES) {
+                AABB box = bvh->boxes[primitive];
+                hit = intersect_box_packet(box.center - box.extents, box.center + box.extents, packet, *closest, &distance);
+            } else {
+                Vector3 a, b, c;
+                get_triangle(bvh, primitive, &a, &b, &c);
+                hit = intersect_triangle_packet(a, b, c, packet, &distance);
+            }
+            hit = _mm_and_ps(hit, _mm_cmplt_ps(distance, *closest));
+            *closest = _mm_or_ps(_mm_and_ps(hit, distance), _mm_andnot_ps(hit, *closest));
+            __m128i hit_i = _mm_castps_si128(hit);
+            *primitives = _mm_or_si128(_mm_and_si128(hit_i, _mm_set1_epi32((int)primitive)), _mm_andnot_si128(hit_i, *primitives));
+        }
+    }
+}
+#endif
+
+// Processes packets in [start, end) range.
+void intersect_packets(void *data, uint32_t start, uint32_t end) {
+    PacketData *batch = (PacketData *)data;
+    for(uint32_t packet_index = start; packet_index < end; ++packet_index) {
+        uint32_t first = packet_index * 4;
+        uint32_t ray_count = batch->count - first < 4 ? batch->count - first : 4;
+#ifdef CPPLIB_MATHS_SSE
+        // Missing rays in the last packet repeat the last ray.
+        float origins[3][4];
+        float directions[3][4];
+        for(uint32_t lane = 0; lane < 4; ++lane) {
+            uint32_t ray = first + (lane < ray_count ? lane : ray_count - 1);
+            for(int axis = 0; axis < 3; ++axis) {
+                origins[axis][lane] = batch->origins[ray][axis];
+                directions[axis][lane] = batch->directions[ray][axis];
+            }
+        }
+        RayPacket packet;
+        for(int axis = 0; axis < 3; ++axis) {
+            packet.origin[axis] = _mm_loadu_ps(origins[axis]);
+            packet.direction[axis] = _mm_loadu_ps(directions[axis]);
+            packet.inverse_direction[axis] = _mm_div_ps(_mm_set1_ps(1.0f), packet.direction[axis]);
+        }
+
+        __m128 closest = _mm_set1_ps(batch->max_distance);
+        __m128i primitives = _mm_set1_epi32((int)BVH_NO_HIT);
+        if(batch->bvh->node_count) {
+            traverse_packet(batch->bvh, &packet, &closest, &primitives);
+        }
+
+        float distances[4];
+        uint32_t hit_primitives[4];
+        _mm_storeu_ps(distances, closest);
+        _mm_storeu_si128((__m128i *)hit_primitives, primitives);
+        for(uint32_t lane = 0; lane < ray_count; ++lane) {
+            batch->hits[first + lane] = RayHit{distances[lane], hit_primitives[lane]};
+        }
+#else
+        for(uint32_t ray = first; ray < first + ray_count; ++ray) {
+            RayHit *hit = &batch->hits[ray];
+            if(!bvh::intersect(batch->bvh, batch->origins[ray], batch->directions[ray], hit, batch->max_distance)) {
+                *hit = RayHit{batch->max_distance, BVH_NO_HIT};
+            }
+        }
+#endif
+    }
+}
+
+void bvh::intersect(BVH *bvh, const Vector3 *origins, const Vector3 *directions, uint32_t count, RayHit *hits,
+                    float max_distance) {
+    PacketData data = {bvh, origins, directions, count, hits, max_distance};
+    jobs::parallel_for((count + 3) / 4, intersect_packets, &data, 64);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <float.h>
+#include "maths.h"
+
+// Bounding volume hierarchy over boxes or triangles, answers ray queries without testing every primitive.
+//
+// Usage:
+// BVH bvh = bvh::build(vertices, indices, triangle_count);
+// RayHit hit;
+// if(bvh::intersect(&bvh, origin, direction, &hit)) {
+//     // hit.primitive is the index of the closest triangle.
+// }
+// bvh::release(&bvh);
+//
+// Trees are built with binned SAH, big subtrees are built in parallel on the job system (see jobs.h).
+// Primitive arrays aren't copied and have to outlive the BVH. After primitives move, `bvh::refit`
+// updates node bounds without changing the tree, queries stay correct but get slower the more
+// the primitives move.
+
+// Leaves have `count` primitives starting at `primitive_indices[first]`, interior nodes have `count`
+// set to 0 and children at `first` and `first + 1`.
+struct BVHNode {
+    Vector3 lower;
+    uint32_t first;
+    Vector3 upper;
+    uint32_t count;
+};
+
+enum BVHPrimitiveType {
+    BVH_BOXES,
+    BVH_TRIANGLES,
+};
+
+struct BVH {
+    BVHNode *nodes;
+    uint32_t node_count;
+    uint32_t *primitive_indices;
+    uint32_t primitive_count;
+
+    BVHPrimitiveType type;
+    const AABB *boxes;
+    const Vector3 *vertices;
+    // Triangle i uses vertices indices[3i], indices[3i + 1] and indices[3i + 2]. If NULL, triangle i
+    // uses vertices 3i, 3i + 1 and 3i + 2.
+    const uint32_t *indices;
+};
+
+const uint32_t BVH_NO_HIT = 0xFFFFFFFF;
+
+struct RayHit {
+    // In units of ray direction length.
+    float distance;
+    uint32_t primitive;
+};
+
+namespace bvh {
+    BVH build(const AABB *boxes, uint32_t count);
+    BVH build(const Vector3 *vertices, const uint32_t *indices, uint32_t triangle_count);
+    // Recompute node bounds after primitives moved.
+    void refit(BVH *bvh);
+    void release(BVH *bvh);
+
+    // Closest hit closer than `max_distance`. Boxes are hit where the ray enters them, or at 0 if the ray
+    // starts inside. Triangles are double-sided.
+    bool intersect(BVH *bvh, Vector3 origin, Vector3 direction, RayHit *hit, float max_distance = FLT_MAX);
+    // Returns as soon as any hit closer than `max_distance` is found, use for visibility tests.
+    bool intersect_any(BVH *bvh, Vector3 origin, Vector3 direction, float max_distance = FLT_MAX);
+    // Closest hits of `count` rays, traced in packets of 4 rays sharing node visits, so rays next to
+    // each other should be coherent (e.g. neighbouring pixels). Missed rays get BVH_NO_HIT primitive.
+    // Large batches are split over job system threads.
+    void intersect(BVH *bvh, const Vector3 *origins, const Vector3 *directions, uint32_t count, RayHit *hits,
+                   float max_distance = FLT_MAX);
+}
+
+#ifdef CPPLIB_BVH_IMPL
+#include "bvh.cpp"
+#endif
\ No newline at end of file
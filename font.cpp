@@ -3,6 +3,9 @@
 #include <math.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef CPPLIB_FONT_JOBS
+#include "jobs.h"
+#endif
 
 #ifdef DEBUG
 #include<stdio.h>
@@ -353,6 +356,41 @@ float get_distance(Vector2 p_pixel, OutlineSegment *segments, uint32_t segment_c
     return d;
 }
 
+// Everything needed to rasterize part of a glyph's SDF into the font bitmap.
+struct GlyphSDFContext {
+    uint8_t *font_bitmap;
+    int32_t bitmap_size;
+    int bitmap_x, bitmap_y;
+    int bitmap_width, bitmap_height;
+    int padding;
+    float x_min_pixel, y_min_pixel;
+    OutlineSegment *segments;
+    uint32_t segment_count;
+    float funits_to_pixels_scaling;
+};
+
+// Rasterize glyph SDF rows in [start_row, end_row) range, can be used as `jobs::parallel_for` function.
+void rasterize_glyph_sdf_rows(void *data, uint32_t start_row, uint32_t end_row) {
+    GlyphSDFContext *context = (GlyphSDFContext *)data;
+    for(int y = int(start_row); y < int(end_row); ++y) {
+        for(int x = 0; x < context->bitmap_width; ++x) {
+            float x_pixel = x + context->x_min_pixel - context->padding + 0.5f;
+            float y_pixel = y + context->y_min_pixel - context->padding + 0.5f;
+            Vector2 p_pixel = Vector2(x_pixel, y_pixel);
+            
+            float d = get_distance(p_pixel, context->segments, context->segment_count, context->funits_to_pixels_scaling);
+            d /= float(context->padding); // TODO: Is this correct?
+
+            // Normalize from (-1, 1) to (0, 1) range.
+            d = math::clamp(d, -1.0f, 1.0f) * 0.5f + 0.5f;
+
+            int dst_x = x + context->bitmap_x;
+            int dst_y = context->bitmap_height - 1 - y + context->bitmap_y;  // "glyph space" has y-axis up, bitmap down.
+            context->font_bitmap[dst_x + dst_y * context->bitmap_size] = uint8_t(math::clamp(d, 0.0f, 1.0f) * 255.0f);
+        }
+    }
+}
+
 // TODO: This function could probably be shorter.
 Font font::get(uint8_t *data, int32_t data_size, int32_t size, int32_t bitmap_size) {
     Font font = {};
@@ -555,24 +593,16 @@ Font font::get(uint8_t *data, int32_t data_size, int32_t size, int32_t bitmap_si
         // After this point we don't need the glyph anymore.
         ttf::release(&glyph);
 
-        // Create an SDF map.
-        for(int y = 0; y < bitmap_height; ++y) {
-            for(int x = 0; x < bitmap_width; ++x) {
-                float x_pixel = x + x_min_pixel - padding + 0.5f;
-                float y_pixel = y + y_min_pixel - padding + 0.5f;
-                Vector2 p_pixel = Vector2(x_pixel, y_pixel);
-                
-                float d = get_distance(p_pixel, segments, segment_count, funits_to_pixels_scaling);
-                d /= float(padding); // TODO: Is this correct?
-
-                // Normalize from (-1, 1) to (0, 1) range.
-                d = math::clamp(d, -1.0f, 1.0f) * 0.5f + 0.5f;
-
-                int dst_x = x + bitmap_x;
-                int dst_y = bitmap_height - 1 - y + bitmap_y;  // "glyph space" has y-axis up, bitmap down.
-                font_bitmap[dst_x + dst_y * bitmap_size] = uint8_t(math::clamp(d, 0.0f, 1.0f) * 255.0f);
-            }
-        }
+        // Create an SDF map. Rows are independent, so with CPPLIB_FONT_JOBS they're spread over job system threads.
+        GlyphSDFContext sdf_context = {
+            font_bitmap, bitmap_size, bitmap_x, bitmap_y, bitmap_width, bitmap_height, padding,
+            x_min_pixel, y_min_pixel, segments, uint32_t(segment_count), funits_to_pixels_scaling
+        };
+#ifdef CPPLIB_FONT_JOBS
+        jobs::parallel_for(uint32_t(bitmap_height), rasterize_glyph_sdf_rows, &sdf_context, 4);
+#else
+        rasterize_glyph_sdf_rows(&sdf_context, 0, uint32_t(bitmap_height));
+#endif
 
         font.glyphs[c - 32] = {bitmap_x, bitmap_y, bitmap_width, bitmap_height, x_offset, y_offset, advance};
 
@@ -33,6 +33,9 @@ namespace font {
         - data_size: size of data block in bytes
         - size: height of the font in pixels
         - bitmap_size: size of a side of bitmap that stores font, in pixels
+
+    If CPPLIB_FONT_JOBS is defined when compiling font.cpp, glyph SDFs are rasterized on job system threads
+    (see jobs.h), which then has to be initialized.
     */
     Font get(uint8_t *data, int32_t data_size, int32_t size, int32_t bitmap_size);
 
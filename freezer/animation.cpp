@@ -34,7 +34,7 @@ AnimationPlayer animation::get(Skeleton skeleton, Animation *animations, uint32_
     player.skeleton = skeleton;
     player.animations = animations;
     player.animation_count = animation_count;
-    player.output_matrices = memory::alloc_heap<Matrix4x4>(skeleton.bones.count);
+    player.output_matrices = memory::alloc_heap<Matrix4x4>(skeleton.bones.count, MEMORY_TAG_ANIMATION);
 
     return player;
 }
@@ -52,6 +52,8 @@ void animation::update(AnimationPlayer *player, float dt)
 
 void animation::evaluate(AnimationPlayer *player)
 {
+    HotScope hot_scope("animation::evaluate");
+
     Animation *animation = &player->animations[player->current_animation];
     Skeleton *skeleton = &player->skeleton;
     float current_part = player->current_time / animation->duration * (animation->frame_count - 1);
@@ -104,7 +104,7 @@ static AssetDatabase asset_db;
 
 void resources::init(char *adf_file)
 {
-	allocator = memory::get_stack_allocator(MEGABYTES(10));
+	allocator = memory::get_stack_allocator(GIGABYTES(1), MEMORY_TAG_RESOURCES);
 
 	File asset_definition_file = file_system::read_file(adf_file);
 	if (asset_definition_file.size > 0) {
@@ -244,7 +244,7 @@ void process_font(AssetInfo font_info, sid id)
 		return;
 	}
 
-	uint8_t *font_data = memory::alloc_heap<uint8_t>(font_file.size);
+	uint8_t *font_data = memory::alloc_heap<uint8_t>(font_file.size, MEMORY_TAG_RESOURCES);
 	memcpy(font_data, font_file.data, font_file.size);
 
 	table::add(&fonts, id, font_data);
@@ -302,7 +302,7 @@ void release_audio_ogg(AssetInfo ogg_info, sid id)
 void release_font(AssetInfo ogg_info, sid id)
 {
 	uint8_t *font_data = *(table::get(&fonts, id));
-	memory::free_heap(font_data);
+	memory::free_heap(font_data, MEMORY_TAG_RESOURCES);
 	table::remove(&fonts, id);
 }
 
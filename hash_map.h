@@ -0,0 +1,288 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+#include "memory.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define CPPLIB_HASH_MAP_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// HashMap is an open-addressing robin hood hash map. Every slot has a control byte
+// (0 for empty slot, otherwise 0x80 | 7 bits of the hash) which lets lookups test
+// 16 slots at once. Deletion uses backward shift, so there are no tombstones.
+// NOTE: Pointers to values are invalidated by `set` and `remove`.
+template <typename K, typename V>
+struct HashMapSlot {
+    K key;
+    V value;
+};
+
+template <typename K, typename V>
+struct HashMap {
+    uint8_t *ctrl;
+    HashMapSlot<K, V> *slots;
+    uint32_t capacity;
+    uint32_t count;
+    MemoryTag tag;
+};
+
+// `hash_map` namespace handles operations on HashMap.
+namespace hash_map {
+    // Maximum ratio of item count to capacity before the map grows.
+    const float max_load_factor = 0.85f;
+    // Number of control bytes tested at once, capacity is never smaller than this.
+    const uint32_t group_width = 16;
+    const uint8_t ctrl_empty = 0;
+
+    // Key hashing, custom key types can provide their own `hash_key` overload.
+    inline uint32_t hash_key(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdull;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ull;
+        key ^= key >> 33;
+        return uint32_t(key);
+    }
+
+    // 32-bit keys only need a single multiply (Fibonacci hashing).
+    inline uint32_t hash_key(uint32_t key) {
+        return uint32_t((uint64_t(key) * 0x9e3779b97f4a7c15ull) >> 32);
+    }
+
+    inline uint32_t hash_key(int32_t key) {
+        return hash_key(uint32_t(key));
+    }
+
+    inline uint32_t hash_key(int64_t key) {
+        return hash_key(uint64_t(key));
+    }
+
+    inline uint32_t hash_key(const void *key) {
+        return hash_key(uint64_t(uintptr_t(key)));
+    }
+
+    inline uint8_t ctrl_from_hash(uint32_t hash) {
+        return uint8_t(0x80 | (hash >> 25));
+    }
+
+    // Returns bitmask of slots in the group starting at `ctrl` whose control byte equals `value`.
+    inline uint32_t match_group(const uint8_t *ctrl, uint8_t value) {
+#ifdef CPPLIB_HASH_MAP_SSE2
+        __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+        __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8(char(value)));
+        return uint32_t(_mm_movemask_epi8(match));
+#else
+        uint32_t mask = 0;
+        for(uint32_t i = 0; i < group_width; ++i) {
+            if(ctrl[i] == value) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    inline uint32_t lowest_bit_index(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return uint32_t(index);
+#else
+        return uint32_t(__builtin_ctz(mask));
+#endif
+    }
+
+    // Set control byte, first `group_width` bytes are mirrored past the end so groups can wrap around.
+    template <typename K, typename V>
+    void set_ctrl(HashMap<K, V> *map, uint32_t slot, uint8_t value) {
+        map->ctrl[slot] = value;
+        if(slot < group_width) {
+            map->ctrl[map->capacity + slot] = value;
+        }
+    }
+
+    //  Initialize HashMap, `capacity` is rounded up to power of 2.
+    template <typename K, typename V>
+    void init(HashMap<K, V> *map, uint32_t capacity, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        uint32_t rounded_capacity = group_width;
+        while(rounded_capacity < capacity) {
+            rounded_capacity *= 2;
+        }
+
+        map->capacity = rounded_capacity;
+        map->count = 0;
+        map->tag = tag;
+        map->ctrl = memory::alloc_heap<uint8_t>(rounded_capacity + group_width, tag);
+        map->slots = memory::alloc_heap<HashMapSlot<K, V>>(rounded_capacity, tag);
+        assert(map->ctrl && map->slots);
+        memset(map->ctrl, ctrl_empty, rounded_capacity + group_width);
+    }
+
+    //  Returns initialized HashMap
+    template <typename K, typename V>
+    HashMap<K, V> get(uint32_t capacity = group_width, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        HashMap<K, V> map;
+        hash_map::init(&map, capacity, tag);
+        return map;
+    }
+
+    // Distance of the item in `slot` from its home slot.
+    template <typename K, typename V>
+    uint32_t get_probe_distance(HashMap<K, V> *map, uint32_t slot) {
+        uint32_t mask = map->capacity - 1;
+        return (slot - (hash_key(map->slots[slot].key) & mask)) & mask;
+    }
+
+    // Returns slot index of `key` or -1 if it's not in the map.
+    template <typename K, typename V>
+    int64_t find_slot(HashMap<K, V> *map, K key, uint32_t hash) {
+        uint32_t mask = map->capacity - 1;
+        uint8_t ctrl = ctrl_from_hash(hash);
+        uint32_t position = hash & mask;
+
+        // Most lookups hit the home slot, check it before scanning whole groups.
+        if(map->ctrl[position] == ctrl && map->slots[position].key == key) {
+            return position;
+        }
+
+        // Items form unbroken runs starting at their home slot, so the first empty slot ends the search.
+        for(uint32_t probed = 0; probed < map->capacity; probed += group_width) {
+            uint32_t matches = match_group(map->ctrl + position, ctrl);
+            uint32_t empties = match_group(map->ctrl + position, ctrl_empty);
+            if(empties) {
+                // Ignore matches past the first empty slot.
+                matches &= (empties & (0u - empties)) - 1;
+            }
+
+            while(matches) {
+                uint32_t slot = (position + lowest_bit_index(matches)) & mask;
+                if(map->slots[slot].key == key) {
+                    return slot;
+                }
+                matches &= matches - 1;
+            }
+
+            if(empties) {
+                return -1;
+            }
+            position = (position + group_width) & mask;
+        }
+        return -1;
+    }
+
+    // Returns pointer to value stored under `key` or NULL.
+    template <typename K, typename V>
+    V *find(HashMap<K, V> *map, K key) {
+        int64_t slot = hash_map::find_slot(map, key, hash_key(key));
+        if(slot < 0) return NULL;
+        return &map->slots[slot].value;
+    }
+
+    template <typename K, typename V>
+    bool contains(HashMap<K, V> *map, K key) {
+        return hash_map::find_slot(map, key, hash_key(key)) >= 0;
+    }
+
+    // Insert an item known not to be in the map. Richer items (closer to home) give up
+    // their slot to poorer ones, keeping probe lengths short.
+    template <typename K, typename V>
+    void insert_new(HashMap<K, V> *map, K key, V value, uint32_t hash) {
+        uint32_t mask = map->capacity - 1;
+        uint32_t slot = hash & mask;
+        uint32_t distance = 0;
+        while(true) {
+            if(map->ctrl[slot] == ctrl_empty) {
+                set_ctrl(map, slot, ctrl_from_hash(hash));
+                map->slots[slot] = HashMapSlot<K, V>{key, value};
+                map->count++;
+                return;
+            }
+
+            uint32_t slot_hash = hash_key(map->slots[slot].key);
+            uint32_t slot_distance = (slot - (slot_hash & mask)) & mask;
+            if(slot_distance < distance) {
+                HashMapSlot<K, V> evicted = map->slots[slot];
+
+                set_ctrl(map, slot, ctrl_from_hash(hash));
+                map->slots[slot] = HashMapSlot<K, V>{key, value};
+
+                key = evicted.key;
+                value = evicted.value;
+                hash = slot_hash;
+                distance = slot_distance;
+            }
+
+            slot = (slot + 1) & mask;
+            distance++;
+        }
+    }
+
+    // Rehash all items into a table of `capacity` slots.
+    template <typename K, typename V>
+    void rehash(HashMap<K, V> *map, uint32_t capacity) {
+        HashMap<K, V> old_map = *map;
+        hash_map::init(map, capacity, old_map.tag);
+        for(uint32_t i = 0; i < old_map.capacity; ++i) {
+            if(old_map.ctrl[i] != ctrl_empty) {
+                HashMapSlot<K, V> *old_slot = &old_map.slots[i];
+                hash_map::insert_new(map, old_slot->key, old_slot->value, hash_key(old_slot->key));
+            }
+        }
+        memory::free_heap(old_map.ctrl, old_map.tag);
+        memory::free_heap(old_map.slots, old_map.tag);
+    }
+
+    // Insert or overwrite value stored under `key`.
+    template <typename K, typename V>
+    void set(HashMap<K, V> *map, K key, V value) {
+        uint32_t hash = hash_key(key);
+        int64_t slot = hash_map::find_slot(map, key, hash);
+        if(slot >= 0) {
+            map->slots[slot].value = value;
+            return;
+        }
+
+        if(float(map->count + 1) > float(map->capacity) * max_load_factor) {
+            hash_map::rehash(map, map->capacity * 2);
+        }
+        hash_map::insert_new(map, key, value, hash);
+    }
+
+    // Remove `key` from the map, following items are shifted back to fill the hole.
+    template <typename K, typename V>
+    bool remove(HashMap<K, V> *map, K key) {
+        int64_t found_slot = hash_map::find_slot(map, key, hash_key(key));
+        if(found_slot < 0) return false;
+
+        uint32_t mask = map->capacity - 1;
+        uint32_t slot = uint32_t(found_slot);
+        uint32_t next = (slot + 1) & mask;
+        while(map->ctrl[next] != ctrl_empty && hash_map::get_probe_distance(map, next) > 0) {
+            set_ctrl(map, slot, map->ctrl[next]);
+            map->slots[slot] = map->slots[next];
+            slot = next;
+            next = (next + 1) & mask;
+        }
+        set_ctrl(map, slot, ctrl_empty);
+        map->count--;
+        return true;
+    }
+
+    // Remove all items, does not deallocate allocated memory
+    template <typename K, typename V>
+    void reset(HashMap<K, V> *map) {
+        memset(map->ctrl, ctrl_empty, map->capacity + group_width);
+        map->count = 0;
+    }
+
+    // Completely release the map, freeing all the memory
+    template <typename K, typename V>
+    void release(HashMap<K, V> *map) {
+        memory::free_heap(map->ctrl, map->tag);
+        memory::free_heap(map->slots, map->tag);
+        *map = HashMap<K, V>{};
+    }
+}
\ No newline at end of file
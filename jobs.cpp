@@ -0,0 +1,307 @@
+#include "jobs.h"
+#include "memory.h"
+#include "queue.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+/*
+
+Work-stealing deque (Chase-Lev) section.
+
+The owner thread pushes and pops at the bottom, other threads steal from the top.
+Deque only holds pointers to jobs, the jobs themselves live in owner's job ring.
+
+*/
+
+const int64_t JOB_DEQUE_SIZE = 4096;
+// Job ring is bigger than the deque, so a slot is never reused while its job could still be read by a thief.
+const uint32_t JOB_RING_SIZE = JOB_DEQUE_SIZE * 2;
+const uint32_t MAX_THREAD_COUNT = 64;
+const uint32_t INJECTED_QUEUE_SIZE = 4096;
+// How many times an idle worker looks for work before going to sleep.
+const uint32_t IDLE_SPIN_COUNT = 64;
+
+struct JobDeque {
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<int64_t> top;
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<int64_t> bottom;
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<Job *> jobs[JOB_DEQUE_SIZE];
+    Job job_ring[JOB_RING_SIZE];
+    uint32_t job_ring_index;
+};
+
+namespace deque {
+    // Owner only.
+    bool push(JobDeque *deque, Job job) {
+        int64_t bottom = deque->bottom.load(std::memory_order_relaxed);
+        int64_t top = deque->top.load(std::memory_order_acquire);
+        if(bottom - top >= JOB_DEQUE_SIZE) return false;
+
+        Job *slot = &deque->job_ring[deque->job_ring_index++ % JOB_RING_SIZE];
+        *slot = job;
+        deque->jobs[bottom % JOB_DEQUE_SIZE].store(slot, std::memory_order_release);
+        deque->bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only.
+    bool pop(JobDeque *deque, Job *job) {
+        int64_t bottom = deque->bottom.load(std::memory_order_relaxed) - 1;
+        deque->bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = deque->top.load(std::memory_order_relaxed);
+
+        if(top > bottom) {
+            deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Job *slot = deque->jobs[bottom % JOB_DEQUE_SIZE].load(std::memory_order_relaxed);
+        if(top == bottom) {
+            // Last job, race against thieves for it.
+            bool won = deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            deque->bottom.store(bottom + 1, std::memory_order_relaxed);
+            if(!won) return false;
+        }
+        *job = *slot;
+        return true;
+    }
+
+    // Any thread.
+    bool steal(JobDeque *deque, Job *job) {
+        int64_t top = deque->top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = deque->bottom.load(std::memory_order_acquire);
+        if(top >= bottom) return false;
+
+        Job *slot = deque->jobs[top % JOB_DEQUE_SIZE].load(std::memory_order_acquire);
+        Job stolen = *slot;
+        if(!deque->top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return false;
+        }
+        *job = stolen;
+        return true;
+    }
+}
+
+/*
+
+Job system state.
+
+*/
+
+struct JobSystem {
+    JobDeque *deques;
+    uint32_t thread_count;
+    std::thread *workers;
+    MPMCQueue<Job> injected_jobs;
+
+    std::atomic<bool> running;
+    std::atomic<uint32_t> sleeping_count;
+    std::mutex sleep_mutex;
+    std::condition_variable wake_condition;
+};
+
+JobSystem job_system;
+// Index of the deque owned by this thread, -1 for threads outside of the job system.
+thread_local int32_t job_thread_index = -1;
+
+bool is_job_system_running() {
+    return job_system.running.load(std::memory_order_acquire);
+}
+
+void execute_job(Job job) {
+    job.function(job.data);
+    if(job.counter) {
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void wake_workers() {
+    if(job_system.sleeping_count.load(std::memory_order_relaxed) > 0) {
+        job_system.wake_condition.notify_all();
+    }
+}
+
+// Look for work in own deque, then in the shared queue and then in other threads' deques.
+bool find_job(Job *job) {
+    int32_t index = job_thread_index;
+    if(index >= 0 && deque::pop(&job_system.deques[index], job)) {
+        return true;
+    }
+
+    if(queue::pop(&job_system.injected_jobs, job)) {
+        return true;
+    }
+
+    uint32_t start = index >= 0 ? uint32_t(index) + 1 : 0;
+    for(uint32_t i = 0; i < job_system.thread_count; ++i) {
+        uint32_t victim = (start + i) % job_system.thread_count;
+        if(int32_t(victim) == index) continue;
+        if(deque::steal(&job_system.deques[victim], job)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void worker_loop(int32_t index) {
+    job_thread_index = index;
+    uint32_t idle_count = 0;
+    while(is_job_system_running()) {
+        Job job;
+        if(find_job(&job)) {
+            execute_job(job);
+            idle_count = 0;
+            continue;
+        }
+
+        if(++idle_count < IDLE_SPIN_COUNT) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Sleep until new work arrives. Timeout guards against a wake-up sent
+        // between the last failed search and going to sleep.
+        std::unique_lock<std::mutex> lock(job_system.sleep_mutex);
+        job_system.sleeping_count++;
+        job_system.wake_condition.wait_for(lock, std::chrono::milliseconds(1));
+        job_system.sleeping_count--;
+        idle_count = 0;
+    }
+}
+
+void jobs::init(uint32_t worker_count) {
+    if(is_job_system_running()) return;
+
+    if(worker_count == 0) {
+        uint32_t core_count = std::thread::hardware_concurrency();
+        worker_count = core_count > 1 ? core_count - 1 : 0;
+    }
+    if(worker_count > MAX_THREAD_COUNT - 1) {
+        worker_count = MAX_THREAD_COUNT - 1;
+    }
+
+    // Thread calling init owns deque 0, worker i owns deque i + 1.
+    job_system.thread_count = worker_count + 1;
+    job_system.deques = new JobDeque[job_system.thread_count];
+    for(uint32_t i = 0; i < job_system.thread_count; ++i) {
+        job_system.deques[i].top.store(0, std::memory_order_relaxed);
+        job_system.deques[i].bottom.store(0, std::memory_order_relaxed);
+        job_system.deques[i].job_ring_index = 0;
+    }
+    queue::init(&job_system.injected_jobs, INJECTED_QUEUE_SIZE);
+    job_system.sleeping_count.store(0, std::memory_order_relaxed);
+    job_system.running.store(true, std::memory_order_release);
+    job_thread_index = 0;
+
+    job_system.workers = new std::thread[worker_count];
+    for(uint32_t i = 0; i < worker_count; ++i) {
+        job_system.workers[i] = std::thread(worker_loop, int32_t(i + 1));
+    }
+}
+
+void jobs::release() {
+    if(!is_job_system_running()) return;
+
+    job_system.running.store(false, std::memory_order_release);
+    job_system.wake_condition.notify_all();
+    for(uint32_t i = 0; i < job_system.thread_count - 1; ++i) {
+        job_system.workers[i].join();
+    }
+
+    delete[] job_system.workers;
+    delete[] job_system.deques;
+    queue::release(&job_system.injected_jobs);
+    job_system.workers = NULL;
+    job_system.deques = NULL;
+    job_system.thread_count = 0;
+    job_thread_index = -1;
+}
+
+uint32_t jobs::get_thread_count() {
+    return is_job_system_running() ? job_system.thread_count : 1;
+}
+
+void jobs::run(JobFunction *function, void *data, JobCounter *counter) {
+    Job job = {function, data, counter};
+    if(counter) {
+        counter->pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Without job system, or when all queues are full, run the job right away.
+    bool submitted = false;
+    if(is_job_system_running()) {
+        if(job_thread_index >= 0) {
+            submitted = deque::push(&job_system.deques[job_thread_index], job);
+        } else {
+            submitted = queue::push(&job_system.injected_jobs, job);
+        }
+    }
+
+    if(submitted) {
+        wake_workers();
+    } else {
+        execute_job(job);
+    }
+}
+
+void jobs::wait(JobCounter *counter) {
+    while(counter->pending.load(std::memory_order_acquire) > 0) {
+        Job job;
+        if(is_job_system_running() && find_job(&job)) {
+            execute_job(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/*
+
+Parallel for section.
+
+*/
+
+struct ParallelForChunk {
+    ParallelForFunction *function;
+    void *data;
+    uint32_t start;
+    uint32_t end;
+};
+
+void run_parallel_for_chunk(void *data) {
+    ParallelForChunk *chunk = (ParallelForChunk *)data;
+    chunk->function(chunk->data, chunk->start, chunk->end);
+}
+
+// Chunks per thread, more chunks balance uneven work better at the cost of overhead.
+const uint32_t PARALLEL_FOR_CHUNKS_PER_THREAD = 4;
+
+void jobs::parallel_for(uint32_t count, ParallelForFunction *function, void *data, uint32_t min_chunk_size) {
+    if(count == 0) return;
+
+    uint32_t thread_count = jobs::get_thread_count();
+    uint32_t chunk_size = count / (thread_count * PARALLEL_FOR_CHUNKS_PER_THREAD);
+    if(chunk_size < min_chunk_size) chunk_size = min_chunk_size;
+    if(chunk_size < 1) chunk_size = 1;
+
+    uint32_t chunk_count = (count + chunk_size - 1) / chunk_size;
+    if(thread_count == 1 || chunk_count == 1) {
+        function(data, 0, count);
+        return;
+    }
+
+    // Chunk descriptors only need to live until `wait` returns.
+    TempScope temp_scope;
+    ParallelForChunk *chunks = memory::alloc_temp<ParallelForChunk>(chunk_count);
+    JobCounter counter = {};
+    for(uint32_t i = 0; i < chunk_count; ++i) {
+        uint32_t start = i * chunk_size;
+        uint32_t end = start + chunk_size < count ? start + chunk_size : count;
+        chunks[i] = ParallelForChunk{function, data, start, end};
+        jobs::run(run_parallel_for_chunk, &chunks[i], &counter);
+    }
+    jobs::wait(&counter);
+}
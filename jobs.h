@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Job system with a worker thread per core. Every worker (and the thread which called
+// `jobs::init`) owns a work-stealing deque, idle workers steal from the others.
+// Jobs submitted from other threads go through a shared queue.
+//
+// Usage:
+// JobCounter counter = {};
+// jobs::run(function, data, &counter);
+// jobs::wait(&counter); // Runs other jobs while waiting.
+//
+// If `jobs::init` wasn't called, jobs run immediately on the calling thread.
+
+typedef void JobFunction(void *data);
+// Processes items in [start, end) range.
+typedef void ParallelForFunction(void *data, uint32_t start, uint32_t end);
+
+// JobCounter tracks number of unfinished jobs, it can be used to wait for a group of jobs.
+struct JobCounter {
+    std::atomic<int32_t> pending;
+};
+
+struct Job {
+    JobFunction *function;
+    void *data;
+    JobCounter *counter;
+};
+
+namespace jobs {
+    // Start `worker_count` worker threads, 0 means one per core besides the calling thread.
+    void init(uint32_t worker_count = 0);
+    // Stop and join all worker threads.
+    void release();
+    // Number of threads executing jobs, including the thread which called `init`.
+    uint32_t get_thread_count();
+
+    // Submit a job, `counter` (can be NULL) is incremented now and decremented once the job finishes.
+    void run(JobFunction *function, void *data, JobCounter *counter);
+    // Block until counter reaches 0, executing other jobs in the meantime.
+    void wait(JobCounter *counter);
+
+    // Split [0, count) range into chunks of at least `min_chunk_size` items, process them
+    // on all threads and wait for them to finish.
+    void parallel_for(uint32_t count, ParallelForFunction *function, void *data, uint32_t min_chunk_size = 1);
+}
+
+#ifdef CPPLIB_JOBS_IMPL
+#include "jobs.cpp"
+#endif
\ No newline at end of file
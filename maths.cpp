@@ -1,9 +1,11 @@
 #include "maths.h"
 #include <math.h>
-
-Vector3::Vector3(Vector4 v) :
-	x(v.x), y(v.y), z(v.z) {
-}
+#include <float.h>
+#include <string.h>
+#include <atomic>
+#ifdef CPPLIB_MATHS_JOBS
+#include "jobs.h"
+#endif
 
 float math::max(float a, float b) {
 	return a >= b ? a : b;
@@ -149,10 +151,6 @@ Vector4 math::nlerp(Vector4 v1, Vector4 v2, float x) {
 	return math::normalize(r);
 }
 
-Vector3 operator*(float x, Vector3 v) {
-	return v * x;
-}
-
 float math::fmod(float x, float m) {
 	return fmodf(x, m);
 }
@@ -224,58 +222,6 @@ Vector4 math::normalize(Vector4 x) {
 	return x / length;
 }
 
-Matrix4x4 math::get_identity() {
-	Matrix4x4 result = {};
-
-	result[0] = result[5] = result[10] = result[15] = 1;
-
-	return result;
-}
-
-Matrix4x4 math::get_translation(Vector3 v) {
-	Matrix4x4 result = get_translation(v.x, v.y, v.z);
-	return result;
-}
-
-Matrix4x4 math::get_translation(float x, float y, float z) {
-	Matrix4x4 result = {};
-
-	result[0] = 1;
-	result[5] = 1;
-	result[10] = 1;
-	result[12] = x;
-	result[13] = y;
-	result[14] = z;
-	result[15] = 1;
-
-	return result;
-}
-
-Matrix4x4 math::get_scale(float scale) {
-	Matrix4x4 result = {};
-
-	result[0] = result[5] = result[10] = scale;
-	result[15] = 1;
-
-	return result;
-}
-
-Matrix4x4 math::get_scale(float s_x, float s_y, float s_z) {
-	Matrix4x4 result = {};
-
-	result[0] = s_x;
-	result[5] = s_y;
-	result[10] = s_z;
-	result[15] = 1;
-
-	return result;
-}
-
-Matrix4x4 math::get_scale(Vector3 scale) {
-	return math::get_scale(scale.x, scale.y, scale.z);
-}
-
-
 Matrix4x4 math::get_rotation(float angle, Vector3 axis) {
 	float c = math::cos(angle);
 	float s = math::sin(angle);
@@ -308,9 +254,44 @@ Matrix4x4 math::get_rotation(float angle, Vector3 axis) {
 }
 
 Matrix4x4 math::get_rotation(Quaternion q) {
+	Matrix4x4 result = {};
+#ifdef CPPLIB_MATHS_SSE
+	// Same as math::normalize, kept in registers.
+	__m128 v = _mm_loadu_ps(q.v);
+	__m128 length_squared = _mm_mul_ps(v, v);
+	length_squared = _mm_add_ps(length_squared, _mm_shuffle_ps(length_squared, length_squared, _MM_SHUFFLE(2, 3, 0, 1)));
+	length_squared = _mm_add_ps(length_squared, _mm_shuffle_ps(length_squared, length_squared, _MM_SHUFFLE(1, 0, 3, 2)));
+	__m128 length = _mm_sqrt_ps(length_squared);
+	v = _mm_and_ps(_mm_div_ps(v, length), _mm_cmpge_ps(length, _mm_set1_ps(0.001f)));
+
+	// Compute diagonal terms and the sums/differences of off-diagonal products 3 lanes at a time.
+	__m128 v2 = _mm_add_ps(v, v);
+	__m128 w2 = _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(3, 3, 3, 3));
+
+	// (2yy + 2zz, 2xx + 2zz, 2xx + 2yy)
+	__m128 squares = _mm_mul_ps(v, v2);
+	__m128 diagonal = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_add_ps(
+		_mm_shuffle_ps(squares, squares, _MM_SHUFFLE(3, 0, 0, 1)),
+		_mm_shuffle_ps(squares, squares, _MM_SHUFFLE(3, 1, 2, 2))
+	));
+	// (2xy, 2xz, 2yz) and (2wz, 2wy, 2wx)
+	__m128 products = _mm_mul_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 0)), _mm_shuffle_ps(v2, v2, _MM_SHUFFLE(3, 2, 2, 1)));
+	__m128 w_products = _mm_mul_ps(w2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2)));
+
+	__m128 plus = _mm_add_ps(products, w_products);
+	// Last lane is 2ww - 2ww = 0, it's used to fill the w components of the columns.
+	__m128 minus = _mm_sub_ps(products, w_products);
+
+	// Columns are (d0, p0, m1, 0), (m0, d1, p2, 0) and (p1, m2, d2, 0).
+	__m128 column_0 = _mm_shuffle_ps(_mm_shuffle_ps(diagonal, plus, _MM_SHUFFLE(0, 0, 0, 0)), minus, _MM_SHUFFLE(3, 1, 2, 0));
+	__m128 column_1 = _mm_shuffle_ps(_mm_shuffle_ps(minus, diagonal, _MM_SHUFFLE(1, 1, 0, 0)), _mm_shuffle_ps(plus, minus, _MM_SHUFFLE(3, 3, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	__m128 column_2 = _mm_shuffle_ps(_mm_shuffle_ps(plus, minus, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(diagonal, minus, _MM_SHUFFLE(3, 3, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+	_mm_storeu_ps(&result.x[0], column_0);
+	_mm_storeu_ps(&result.x[4], column_1);
+	_mm_storeu_ps(&result.x[8], column_2);
+#else
 	q = math::normalize(q);
 
-	Matrix4x4 result = {};
 	result[0] = 1 - 2 * q.y * q.y - 2 * q.z * q.z;
 	result[1] = 2 * q.x * q.y + 2 * q.w * q.z;
 	result[2] = 2 * q.x * q.z - 2 * q.w * q.y;
@@ -322,6 +303,7 @@ Matrix4x4 math::get_rotation(Quaternion q) {
 	result[8] = 2 * q.x * q.z + 2 * q.w * q.y;
 	result[9] = 2 * q.y * q.z - 2 * q.w * q.x;
 	result[10] = 1 - 2 * q.x * q.x - 2 * q.y * q.y;
+#endif
 
 	result[15] = 1;
 
@@ -341,34 +323,6 @@ Matrix4x4 math::get_perspective_projection_dx_rh(float fov, float aspect_ratio,
 	return result;
 }
 
-Matrix4x4 math::get_orthographics_projection_dx_rh(float left, float right, float bottom, float top, float near, float far) {
-	Matrix4x4 result;
-
-	result[0] = 2.0f / (right - left);
-	result[5] = 2.0f / (top - bottom);
-	result[10] = 1.0f / (far - near);
-	result[12] = -(right + left) / (right - left);
-	result[13] = -(top + bottom) / (top - bottom);
-	result[14] = -(near) / (far - near);
-	result[15] = 1;
-
-	return result;
-}
-
-Matrix4x4 math::get_orthographics_projection_vk_rh(float left, float right, float bottom, float top, float near, float far) {
-	Matrix4x4 result;
-
-	result[0] = 2.0f / (right - left);
-	result[5] = 2.0f / (bottom - top);
-	result[10] = 2.0f / (far - near);
-	result[12] = -(right + left) / (right - left);
-	result[13] = -(top + bottom) / (bottom - top);
-	result[14] = -(far + near) / (far - near);
-	result[15] = 1;
-
-	return result;
-}
-
 Matrix4x4 math::get_look_at(Vector3 eye, Vector3 target, Vector3 up) {
 	Matrix4x4 matrix;
 	Vector3 x, y, z;
@@ -392,31 +346,89 @@ Matrix4x4 math::get_look_at(Vector3 eye, Vector3 target, Vector3 up) {
 	return matrix;
 }
 
-Matrix4x4 math::transpose(Matrix4x4 m) {
-	Matrix4x4 result = {};
-	result[0]  = m[0];
-	result[1]  = m[4];
-	result[2]  = m[8];
-	result[3]  = m[12];
-
-	result[4]  = m[1];
-	result[5]  = m[5];
-	result[6]  = m[9];
-	result[7]  = m[13];
-
-	result[8]  = m[2];
-	result[9]  = m[6];
-	result[10] = m[10];
-	result[11] = m[14];
-
-	result[12] = m[3];
-	result[13] = m[7];
-	result[14] = m[11];
-	result[15] = m[15];
+#ifdef CPPLIB_MATHS_SSE
+// Helpers for the SSE inverse below. 2x2 matrices are packed in a register as (m00, m01, m10, m11).
+#define SHUFFLE_2X2(v1, v2, x, y, z, w) _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(w, z, y, x))
+#define SWIZZLE_2X2(v, x, y, z, w) SHUFFLE_2X2(v, v, x, y, z, w)
+
+// A * B
+inline __m128 mul_2x2(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, SWIZZLE_2X2(b, 0, 3, 0, 3)),
+					  _mm_mul_ps(SWIZZLE_2X2(a, 1, 0, 3, 2), SWIZZLE_2X2(b, 2, 1, 2, 1)));
+}
+
+// adjugate(A) * B
+inline __m128 adj_mul_2x2(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(SWIZZLE_2X2(a, 3, 3, 0, 0), b),
+					  _mm_mul_ps(SWIZZLE_2X2(a, 1, 1, 2, 2), SWIZZLE_2X2(b, 2, 3, 0, 1)));
+}
+
+// A * adjugate(B)
+inline __m128 mul_adj_2x2(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE_2X2(b, 3, 0, 3, 0)),
+					  _mm_mul_ps(SWIZZLE_2X2(a, 1, 0, 3, 2), SWIZZLE_2X2(b, 2, 1, 2, 1)));
+}
+
+// Inverse through 2x2 blocks:
+// M = | A B |   M^-1 = 1/|M| * | X Y |
+//     | C D |                  | Z W |
+// Works the same for column-major storage, since inverse of a transpose is transpose of the inverse.
+Matrix4x4 math::invert(Matrix4x4 m) {
+	__m128 c0 = _mm_loadu_ps(&m.x[0]);
+	__m128 c1 = _mm_loadu_ps(&m.x[4]);
+	__m128 c2 = _mm_loadu_ps(&m.x[8]);
+	__m128 c3 = _mm_loadu_ps(&m.x[12]);
+
+	__m128 a = _mm_movelh_ps(c0, c1);
+	__m128 b = _mm_movehl_ps(c1, c0);
+	__m128 c = _mm_movelh_ps(c2, c3);
+	__m128 d = _mm_movehl_ps(c3, c2);
+
+	// (|A|, |B|, |C|, |D|)
+	__m128 sub_determinants = _mm_sub_ps(
+		_mm_mul_ps(SHUFFLE_2X2(c0, c2, 0, 2, 0, 2), SHUFFLE_2X2(c1, c3, 1, 3, 1, 3)),
+		_mm_mul_ps(SHUFFLE_2X2(c0, c2, 1, 3, 1, 3), SHUFFLE_2X2(c1, c3, 0, 2, 0, 2))
+	);
+	__m128 det_a = SWIZZLE_2X2(sub_determinants, 0, 0, 0, 0);
+	__m128 det_b = SWIZZLE_2X2(sub_determinants, 1, 1, 1, 1);
+	__m128 det_c = SWIZZLE_2X2(sub_determinants, 2, 2, 2, 2);
+	__m128 det_d = SWIZZLE_2X2(sub_determinants, 3, 3, 3, 3);
+
+	__m128 d_c = adj_mul_2x2(d, c);
+	__m128 a_b = adj_mul_2x2(a, b);
+	__m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), mul_2x2(b, d_c));
+	__m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), mul_2x2(c, a_b));
+	__m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), mul_adj_2x2(d, a_b));
+	__m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), mul_adj_2x2(a, d_c));
+
+	// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	__m128 trace = _mm_mul_ps(a_b, SWIZZLE_2X2(d_c, 0, 2, 1, 3));
+	trace = _mm_add_ps(trace, SWIZZLE_2X2(trace, 2, 3, 0, 1));
+	trace = _mm_add_ps(trace, SWIZZLE_2X2(trace, 1, 0, 3, 2));
+	__m128 determinant = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), trace);
+
+	if (_mm_cvtss_f32(determinant) == 0)
+		return math::get_identity();
+
+	// Blocks are still adjugates, so flip signs of the off-diagonal elements.
+	__m128 inverse_determinant = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determinant);
+	x = _mm_mul_ps(x, inverse_determinant);
+	y = _mm_mul_ps(y, inverse_determinant);
+	z = _mm_mul_ps(z, inverse_determinant);
+	w = _mm_mul_ps(w, inverse_determinant);
+
+	Matrix4x4 result;
+	_mm_storeu_ps(&result.x[0], SHUFFLE_2X2(x, y, 3, 1, 3, 1));
+	_mm_storeu_ps(&result.x[4], SHUFFLE_2X2(x, y, 2, 0, 2, 0));
+	_mm_storeu_ps(&result.x[8], SHUFFLE_2X2(z, w, 3, 1, 3, 1));
+	_mm_storeu_ps(&result.x[12], SHUFFLE_2X2(z, w, 2, 0, 2, 0));
 
 	return result;
 }
 
+#undef SHUFFLE_2X2
+#undef SWIZZLE_2X2
+#else
 Matrix4x4 math::invert(Matrix4x4 m) {
 	Matrix4x4 inv;
 	float det;
@@ -546,6 +558,420 @@ Matrix4x4 math::invert(Matrix4x4 m) {
 
 	return result;
 }
+#endif
+
+// Affine matrices and dual quaternions.
+
+Quaternion math::quaternion_multiply(Quaternion a, Quaternion b) {
+	Quaternion result;
+	result.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+	result.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+	result.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+	result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+	return result;
+}
+
+// Shepperd's method, picks the largest of w, x, y, z to divide by.
+Quaternion math::get_quaternion(Matrix3x4 m) {
+	Quaternion result;
+	float trace = m[0] + m[5] + m[10];
+	if (trace > 0) {
+		float s = math::sqrt(trace + 1.0f) * 2.0f;
+		result = Quaternion((m[9] - m[6]) / s, (m[2] - m[8]) / s, (m[4] - m[1]) / s, 0.25f * s);
+	} else if (m[0] > m[5] && m[0] > m[10]) {
+		float s = math::sqrt(1.0f + m[0] - m[5] - m[10]) * 2.0f;
+		result = Quaternion(0.25f * s, (m[1] + m[4]) / s, (m[2] + m[8]) / s, (m[9] - m[6]) / s);
+	} else if (m[5] > m[10]) {
+		float s = math::sqrt(1.0f + m[5] - m[0] - m[10]) * 2.0f;
+		result = Quaternion((m[1] + m[4]) / s, 0.25f * s, (m[6] + m[9]) / s, (m[2] - m[8]) / s);
+	} else {
+		float s = math::sqrt(1.0f + m[10] - m[0] - m[5]) * 2.0f;
+		result = Quaternion((m[2] + m[8]) / s, (m[6] + m[9]) / s, 0.25f * s, (m[4] - m[1]) / s);
+	}
+	return math::normalize(result);
+}
+
+Matrix3x4 math::get_matrix3x4(Matrix4x4 m) {
+	Matrix3x4 result;
+	for (int row = 0; row < 3; ++row) {
+		result[row * 4 + 0] = m[row];
+		result[row * 4 + 1] = m[row + 4];
+		result[row * 4 + 2] = m[row + 8];
+		result[row * 4 + 3] = m[row + 12];
+	}
+	return result;
+}
+
+Matrix4x4 math::get_matrix4x4(Matrix3x4 m) {
+	Matrix4x4 result;
+	for (int row = 0; row < 3; ++row) {
+		result[row] = m[row * 4 + 0];
+		result[row + 4] = m[row * 4 + 1];
+		result[row + 8] = m[row * 4 + 2];
+		result[row + 12] = m[row * 4 + 3];
+	}
+	result[15] = 1;
+	return result;
+}
+
+// Rows of the rotation matrix for a unit quaternion, each column scaled by `scale`.
+inline Matrix3x4 get_rotation_rows(Quaternion q, Vector3 translation, Vector3 scale) {
+	Matrix3x4 result;
+
+	result[0] = (1 - 2 * q.y * q.y - 2 * q.z * q.z) * scale.x;
+	result[1] = (2 * q.x * q.y - 2 * q.w * q.z) * scale.y;
+	result[2] = (2 * q.x * q.z + 2 * q.w * q.y) * scale.z;
+	result[3] = translation.x;
+
+	result[4] = (2 * q.x * q.y + 2 * q.w * q.z) * scale.x;
+	result[5] = (1 - 2 * q.x * q.x - 2 * q.z * q.z) * scale.y;
+	result[6] = (2 * q.y * q.z - 2 * q.w * q.x) * scale.z;
+	result[7] = translation.y;
+
+	result[8] = (2 * q.x * q.z - 2 * q.w * q.y) * scale.x;
+	result[9] = (2 * q.y * q.z + 2 * q.w * q.x) * scale.y;
+	result[10] = (1 - 2 * q.x * q.x - 2 * q.y * q.y) * scale.z;
+	result[11] = translation.z;
+
+	return result;
+}
+
+Matrix3x4 math::get_matrix3x4(Vector3 translation, Quaternion rotation, Vector3 scale) {
+	return get_rotation_rows(math::normalize(rotation), translation, scale);
+}
+
+Matrix3x4 math::get_matrix3x4(DualQuaternion q) {
+	return get_rotation_rows(q.real, math::get_translation(q), Vector3(1, 1, 1));
+}
+
+// Columns of the inverse of the 3x3 part are cross products of its rows divided by the determinant,
+// inverse translation is -(inverse 3x3) * translation.
+Matrix3x4 math::invert(Matrix3x4 m) {
+	Matrix3x4 result;
+#ifdef CPPLIB_MATHS_SSE
+	__m128 r0 = _mm_loadu_ps(&m.x[0]);
+	__m128 r1 = _mm_loadu_ps(&m.x[4]);
+	__m128 r2 = _mm_loadu_ps(&m.x[8]);
+
+	// Translations end up in the w lanes as w * w - w * w = 0.
+#define CROSS(a, b) _mm_sub_ps(                                                                          \
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2))), \
+		_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))))
+	__m128 c0 = CROSS(r1, r2);
+	__m128 c1 = CROSS(r2, r0);
+	__m128 c2 = CROSS(r0, r1);
+#undef CROSS
+
+	__m128 determinant = _mm_mul_ps(r0, c0);
+	determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(2, 3, 0, 1)));
+	determinant = _mm_add_ps(determinant, _mm_shuffle_ps(determinant, determinant, _MM_SHUFFLE(1, 0, 3, 2)));
+	if (_mm_cvtss_f32(determinant) == 0) {
+		result[0] = result[5] = result[10] = 1;
+		return result;
+	}
+
+	__m128 t = _mm_mul_ps(c0, _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(3, 3, 3, 3)));
+	t = CPPLIB_MATHS_MADD(c1, _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(3, 3, 3, 3)), t);
+	t = CPPLIB_MATHS_MADD(c2, _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(3, 3, 3, 3)), t);
+	t = _mm_sub_ps(_mm_setzero_ps(), t);
+
+	// Columns (c0, c1, c2, t) become rows of the result.
+	_MM_TRANSPOSE4_PS(c0, c1, c2, t);
+	__m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+	_mm_storeu_ps(&result.x[0], _mm_mul_ps(c0, inverse_determinant));
+	_mm_storeu_ps(&result.x[4], _mm_mul_ps(c1, inverse_determinant));
+	_mm_storeu_ps(&result.x[8], _mm_mul_ps(c2, inverse_determinant));
+#else
+	Vector3 r0 = Vector3(m[0], m[1], m[2]);
+	Vector3 r1 = Vector3(m[4], m[5], m[6]);
+	Vector3 r2 = Vector3(m[8], m[9], m[10]);
+	Vector3 c0 = math::cross(r1, r2);
+	Vector3 c1 = math::cross(r2, r0);
+	Vector3 c2 = math::cross(r0, r1);
+
+	float determinant = math::dot(r0, c0);
+	if (determinant == 0) {
+		result[0] = result[5] = result[10] = 1;
+		return result;
+	}
+
+	float inverse_determinant = 1.0f / determinant;
+	Vector3 t = -(c0 * m[3] + c1 * m[7] + c2 * m[11]);
+	for (int row = 0; row < 3; ++row) {
+		result[row * 4 + 0] = c0[row] * inverse_determinant;
+		result[row * 4 + 1] = c1[row] * inverse_determinant;
+		result[row * 4 + 2] = c2[row] * inverse_determinant;
+		result[row * 4 + 3] = t[row] * inverse_determinant;
+	}
+#endif
+	return result;
+}
+
+Vector3 math::transform_point(Matrix3x4 m, Vector3 p) {
+	return Vector3(m * Vector4(p, 1.0f));
+}
+
+Vector3 math::transform_direction(Matrix3x4 m, Vector3 d) {
+	return Vector3(m * Vector4(d, 0.0f));
+}
+
+DualQuaternion DualQuaternion::operator *(DualQuaternion q) const {
+	return DualQuaternion(
+		math::quaternion_multiply(real, q.real),
+		math::quaternion_multiply(real, q.dual) + math::quaternion_multiply(dual, q.real)
+	);
+}
+
+DualQuaternion math::get_dual_quaternion(Quaternion rotation, Vector3 translation) {
+	Quaternion real = math::normalize(rotation);
+	Quaternion dual = math::quaternion_multiply(Quaternion(translation, 0.0f), real) * 0.5f;
+	return DualQuaternion(real, dual);
+}
+
+DualQuaternion math::get_dual_quaternion(Matrix3x4 m) {
+	return math::get_dual_quaternion(math::get_quaternion(m), Vector3(m[3], m[7], m[11]));
+}
+
+Vector3 math::get_translation(DualQuaternion q) {
+	Quaternion t = math::quaternion_multiply(q.dual, math::conjugate(q.real)) * 2.0f;
+	return Vector3(t.x, t.y, t.z);
+}
+
+DualQuaternion math::normalize(DualQuaternion q) {
+	float length = math::length(q.real);
+	if (length < 0.001f) {
+		return DualQuaternion();
+	}
+	Quaternion real = q.real / length;
+	Quaternion dual = q.dual / length;
+	// Remove the part of dual not orthogonal to real, so the result stays a rigid transform.
+	dual = dual - real * math::dot(real, dual);
+	return DualQuaternion(real, dual);
+}
+
+DualQuaternion math::conjugate(DualQuaternion q) {
+	return DualQuaternion(math::conjugate(q.real), math::conjugate(q.dual));
+}
+
+DualQuaternion math::nlerp(DualQuaternion q1, DualQuaternion q2, float x) {
+	if (math::dot(q1.real, q2.real) < 0.0f) {
+		q2 = DualQuaternion(-q2.real, -q2.dual);
+	}
+	DualQuaternion result = DualQuaternion(math::lerp(q1.real, q2.real, x), math::lerp(q1.dual, q2.dual, x));
+	return math::normalize(result);
+}
+
+Vector3 math::transform_point(DualQuaternion q, Vector3 p) {
+	return math::rotate(p, q.real) + math::get_translation(q);
+}
+
+// Batch operations.
+// Every operation has a kernel processing [start, end) range, so the range can be split over threads.
+// Vector3 arrays are processed 4 vectors at a time, loaded as 3 registers and shuffled into
+// x, y and z registers. Tail elements use the scalar functions.
+
+#ifdef CPPLIB_MATHS_SSE
+// (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3) -> (x0 x1 x2 x3) (y0 y1 y2 y3) (z0 z1 z2 z3)
+inline void load_vector3x4(const Vector3 *v, __m128 *x, __m128 *y, __m128 *z) {
+	const float *f = v->v;
+	__m128 a = _mm_loadu_ps(f);
+	__m128 b = _mm_loadu_ps(f + 4);
+	__m128 c = _mm_loadu_ps(f + 8);
+	*x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+	*y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	*z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+// Inverse of load_vector3x4.
+inline void store_vector3x4(Vector3 *v, __m128 x, __m128 y, __m128 z) {
+	float *f = v->v;
+	_mm_storeu_ps(f, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(f + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0)));
+	_mm_storeu_ps(f + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// Matrix elements broadcast to all lanes, used when processing 4 vectors at once.
+struct BroadcastMatrix {
+	__m128 x[16];
+};
+
+inline BroadcastMatrix broadcast_matrix(Matrix4x4 *m) {
+	BroadcastMatrix result;
+	for (int i = 0; i < 16; ++i)
+		result.x[i] = _mm_set1_ps(m->x[i]);
+	return result;
+}
+
+// Row `row` of M * (x, y, z, w) for 4 vectors, with `w` being 0 or 1.
+inline __m128 transform_row(BroadcastMatrix *m, int row, __m128 x, __m128 y, __m128 z, bool has_w) {
+	__m128 r = _mm_mul_ps(m->x[row], x);
+	r = CPPLIB_MATHS_MADD(m->x[4 + row], y, r);
+	r = CPPLIB_MATHS_MADD(m->x[8 + row], z, r);
+	return has_w ? _mm_add_ps(r, m->x[12 + row]) : r;
+}
+#endif
+
+struct BatchTransformData {
+	Matrix4x4 m;
+	const void *in;
+	void *out;
+	bool has_w;
+};
+
+struct BatchVectorData {
+	const Vector3 *a;
+	const Vector3 *b;
+	void *out;
+};
+
+void transform_vector4_kernel(void *data, uint32_t start, uint32_t end) {
+	BatchTransformData *batch = (BatchTransformData *)data;
+	const Vector4 *in = (const Vector4 *)batch->in;
+	Vector4 *out = (Vector4 *)batch->out;
+	uint32_t i = start;
+#if defined(CPPLIB_MATHS_SSE) && defined(__AVX__)
+	// Two vectors per register, each 128-bit lane holds one vector.
+	__m256 c0 = _mm256_broadcast_ps((const __m128 *)&batch->m.x[0]);
+	__m256 c1 = _mm256_broadcast_ps((const __m128 *)&batch->m.x[4]);
+	__m256 c2 = _mm256_broadcast_ps((const __m128 *)&batch->m.x[8]);
+	__m256 c3 = _mm256_broadcast_ps((const __m128 *)&batch->m.x[12]);
+	for (; i + 2 <= end; i += 2) {
+		__m256 v = _mm256_loadu_ps(in[i].v);
+		__m256 r = _mm256_mul_ps(c0, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+#if defined(CPPLIB_MATHS_FMA)
+		r = _mm256_fmadd_ps(c1, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)), r);
+		r = _mm256_fmadd_ps(c2, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)), r);
+		r = _mm256_fmadd_ps(c3, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), r);
+#else
+		r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+		r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+		r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+#endif
+		_mm256_storeu_ps(out[i].v, r);
+	}
+#endif
+	for (; i < end; ++i)
+		out[i] = batch->m * in[i];
+}
+
+void transform_vector3_kernel(void *data, uint32_t start, uint32_t end) {
+	BatchTransformData *batch = (BatchTransformData *)data;
+	const Vector3 *in = (const Vector3 *)batch->in;
+	Vector3 *out = (Vector3 *)batch->out;
+	uint32_t i = start;
+#ifdef CPPLIB_MATHS_SSE
+	BroadcastMatrix m = broadcast_matrix(&batch->m);
+	for (; i + 4 <= end; i += 4) {
+		__m128 x, y, z;
+		load_vector3x4(&in[i], &x, &y, &z);
+		__m128 r_x = transform_row(&m, 0, x, y, z, batch->has_w);
+		__m128 r_y = transform_row(&m, 1, x, y, z, batch->has_w);
+		__m128 r_z = transform_row(&m, 2, x, y, z, batch->has_w);
+		store_vector3x4(&out[i], r_x, r_y, r_z);
+	}
+#endif
+	float w = batch->has_w ? 1.0f : 0.0f;
+	for (; i < end; ++i)
+		out[i] = Vector3(batch->m * Vector4(in[i], w));
+}
+
+void normalize_kernel(void *data, uint32_t start, uint32_t end) {
+	BatchVectorData *batch = (BatchVectorData *)data;
+	Vector3 *out = (Vector3 *)batch->out;
+	uint32_t i = start;
+#ifdef CPPLIB_MATHS_SSE
+	__m128 min_length = _mm_set1_ps(0.001f);
+	for (; i + 4 <= end; i += 4) {
+		__m128 x, y, z;
+		load_vector3x4(&batch->a[i], &x, &y, &z);
+		__m128 length = _mm_sqrt_ps(CPPLIB_MATHS_MADD(z, z, CPPLIB_MATHS_MADD(y, y, _mm_mul_ps(x, x))));
+		// Same as math::normalize, too short vectors become zero vectors.
+		__m128 scale = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), length), _mm_cmpge_ps(length, min_length));
+		store_vector3x4(&out[i], _mm_mul_ps(x, scale), _mm_mul_ps(y, scale), _mm_mul_ps(z, scale));
+	}
+#endif
+	for (; i < end; ++i)
+		out[i] = math::normalize(batch->a[i]);
+}
+
+void dot_kernel(void *data, uint32_t start, uint32_t end) {
+	BatchVectorData *batch = (BatchVectorData *)data;
+	float *out = (float *)batch->out;
+	uint32_t i = start;
+#ifdef CPPLIB_MATHS_SSE
+	for (; i + 4 <= end; i += 4) {
+		__m128 a_x, a_y, a_z, b_x, b_y, b_z;
+		load_vector3x4(&batch->a[i], &a_x, &a_y, &a_z);
+		load_vector3x4(&batch->b[i], &b_x, &b_y, &b_z);
+		_mm_storeu_ps(&out[i], CPPLIB_MATHS_MADD(a_z, b_z, CPPLIB_MATHS_MADD(a_y, b_y, _mm_mul_ps(a_x, b_x))));
+	}
+#endif
+	for (; i < end; ++i)
+		out[i] = math::dot(batch->a[i], batch->b[i]);
+}
+
+void cross_kernel(void *data, uint32_t start, uint32_t end) {
+	BatchVectorData *batch = (BatchVectorData *)data;
+	Vector3 *out = (Vector3 *)batch->out;
+	uint32_t i = start;
+#ifdef CPPLIB_MATHS_SSE
+	for (; i + 4 <= end; i += 4) {
+		__m128 a_x, a_y, a_z, b_x, b_y, b_z;
+		load_vector3x4(&batch->a[i], &a_x, &a_y, &a_z);
+		load_vector3x4(&batch->b[i], &b_x, &b_y, &b_z);
+		__m128 x = _mm_sub_ps(_mm_mul_ps(a_y, b_z), _mm_mul_ps(a_z, b_y));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(a_z, b_x), _mm_mul_ps(a_x, b_z));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(a_x, b_y), _mm_mul_ps(a_y, b_x));
+		store_vector3x4(&out[i], x, y, z);
+	}
+#endif
+	for (; i < end; ++i)
+		out[i] = math::cross(batch->a[i], batch->b[i]);
+}
+
+// Arrays shorter than this aren't worth the cost of waking up other threads.
+const uint32_t BATCH_PARALLEL_MIN_COUNT = 16384;
+const uint32_t BATCH_PARALLEL_CHUNK_SIZE = 4096;
+
+void run_batch(void (*kernel)(void *data, uint32_t start, uint32_t end), void *data, uint32_t count) {
+#ifdef CPPLIB_MATHS_JOBS
+	if (count >= BATCH_PARALLEL_MIN_COUNT) {
+		jobs::parallel_for(count, kernel, data, BATCH_PARALLEL_CHUNK_SIZE);
+		return;
+	}
+#endif
+	kernel(data, 0, count);
+}
+
+void math::transform_points(Matrix4x4 m, const Vector4 *in, Vector4 *out, uint32_t count) {
+	BatchTransformData data = {m, in, out, true};
+	run_batch(transform_vector4_kernel, &data, count);
+}
+
+void math::transform_points(Matrix4x4 m, const Vector3 *in, Vector3 *out, uint32_t count) {
+	BatchTransformData data = {m, in, out, true};
+	run_batch(transform_vector3_kernel, &data, count);
+}
+
+void math::transform_directions(Matrix4x4 m, const Vector3 *in, Vector3 *out, uint32_t count) {
+	BatchTransformData data = {m, in, out, false};
+	run_batch(transform_vector3_kernel, &data, count);
+}
+
+void math::normalize(const Vector3 *in, Vector3 *out, uint32_t count) {
+	BatchVectorData data = {in, NULL, out};
+	run_batch(normalize_kernel, &data, count);
+}
+
+void math::dot(const Vector3 *a, const Vector3 *b, float *out, uint32_t count) {
+	BatchVectorData data = {a, b, out};
+	run_batch(dot_kernel, &data, count);
+}
+
+void math::cross(const Vector3 *a, const Vector3 *b, Vector3 *out, uint32_t count) {
+	BatchVectorData data = {a, b, out};
+	run_batch(cross_kernel, &data, count);
+}
 
 
 float math::ray_plane_intersection(Vector3 ray_origin, Vector3 ray_direction, Vector3 plane_normal, float plane_distance) {
@@ -562,48 +988,882 @@ float math::ray_box_intersection(Vector3 ray_origin, Vector3 ray_direction, Vect
 	return 0.0f;
 }
 
+// Slab test, divisions by zero direction components give infinities which compare correctly.
+float math::ray_aabb_intersection(Vector3 ray_origin, Vector3 ray_direction, AABB box) {
+	float entry = 0.0f;
+	float exit = FLT_MAX;
+	for (int axis = 0; axis < 3; ++axis) {
+		float inverse_direction = 1.0f / ray_direction[axis];
+		float t0 = (box.center[axis] - box.extents[axis] - ray_origin[axis]) * inverse_direction;
+		float t1 = (box.center[axis] + box.extents[axis] - ray_origin[axis]) * inverse_direction;
+		entry = math::max(entry, math::min(t0, t1));
+		exit = math::min(exit, math::max(t0, t1));
+	}
+	return entry <= exit ? entry : -1.0f;
+}
+
+// Moller-Trumbore.
+float math::ray_triangle_intersection(Vector3 ray_origin, Vector3 ray_direction, Vector3 a, Vector3 b, Vector3 c) {
+	Vector3 edge_1 = b - a;
+	Vector3 edge_2 = c - a;
+	Vector3 p = math::cross(ray_direction, edge_2);
+	float determinant = math::dot(edge_1, p);
+	if (math::abs(determinant) < 1e-12f) {
+		return -1.0f;
+	}
+	float inverse_determinant = 1.0f / determinant;
+	Vector3 s = ray_origin - a;
+	float u = math::dot(s, p) * inverse_determinant;
+	Vector3 q = math::cross(s, edge_1);
+	float v = math::dot(ray_direction, q) * inverse_determinant;
+	if (u < 0.0f || v < 0.0f || u + v > 1.0f) {
+		return -1.0f;
+	}
+	float t = math::dot(edge_2, q) * inverse_determinant;
+	return t >= 0.0f ? t : -1.0f;
+}
+
+// Bounding volumes.
+
+AABB math::get_aabb(const Vector3 *points, uint32_t count) {
+	if (count == 0) {
+		return AABB{};
+	}
+	Vector3 lower = points[0];
+	Vector3 upper = points[0];
+	for (uint32_t i = 1; i < count; ++i) {
+		for (int axis = 0; axis < 3; ++axis) {
+			lower[axis] = math::min(lower[axis], points[i].v[axis]);
+			upper[axis] = math::max(upper[axis], points[i].v[axis]);
+		}
+	}
+	return AABB{(lower + upper) * 0.5f, (upper - lower) * 0.5f};
+}
+
+// Center is transformed as a point, extents are projected on each axis through absolute values of M.
+AABB math::transform(Matrix4x4 m, AABB box) {
+	AABB result;
+	result.center = Vector3(m * Vector4(box.center, 1.0f));
+	for (int row = 0; row < 3; ++row) {
+		result.extents[row] = math::abs(m[row]) * box.extents.x +
+							  math::abs(m[row + 4]) * box.extents.y +
+							  math::abs(m[row + 8]) * box.extents.z;
+	}
+	return result;
+}
+
+// Planes are sums and differences of the clip space rows: -w <= x <= w, -w <= y <= w, 0 <= z <= w.
+Frustum math::get_frustum(Matrix4x4 m) {
+	Vector4 rows[4];
+	for (int row = 0; row < 4; ++row) {
+		rows[row] = Vector4(m[row], m[row + 4], m[row + 8], m[row + 12]);
+	}
+	Vector4 planes[6] = {
+		rows[3] + rows[0],
+		rows[3] - rows[0],
+		rows[3] + rows[1],
+		rows[3] - rows[1],
+		rows[2],
+		rows[3] - rows[2],
+	};
+
+	Frustum result;
+	for (int i = 0; i < 6; ++i) {
+		Vector3 normal = Vector3(planes[i].x, planes[i].y, planes[i].z);
+		float length = math::length(normal);
+		result.planes[i].normal = normal / length;
+		result.planes[i].distance = planes[i].w / length;
+	}
+	return result;
+}
+
+bool math::intersects(Frustum frustum, AABB box) {
+	for (int i = 0; i < 6; ++i) {
+		Plane *plane = &frustum.planes[i];
+		float distance = math::dot(plane->normal, box.center) + plane->distance;
+		float radius = math::abs(plane->normal.x) * box.extents.x +
+					   math::abs(plane->normal.y) * box.extents.y +
+					   math::abs(plane->normal.z) * box.extents.z;
+		if (distance + radius < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool math::intersects(Frustum frustum, Sphere sphere) {
+	for (int i = 0; i < 6; ++i) {
+		Plane *plane = &frustum.planes[i];
+		if (math::dot(plane->normal, sphere.center) + plane->distance + sphere.radius < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Culling kernels go over words of the visibility mask instead of volumes, so threads never write
+// to the same word. Volumes are tested 4 at a time against all planes, without early outs.
+
+struct CullData {
+	Frustum frustum;
+	const void *volumes;
+	uint32_t count;
+	uint32_t *visible;
+};
+
+#ifdef CPPLIB_MATHS_SSE
+// Plane elements broadcast to all lanes.
+struct BroadcastFrustum {
+	__m128 normal_x[6];
+	__m128 normal_y[6];
+	__m128 normal_z[6];
+	__m128 abs_normal_x[6];
+	__m128 abs_normal_y[6];
+	__m128 abs_normal_z[6];
+	__m128 distance[6];
+};
+
+inline BroadcastFrustum broadcast_frustum(Frustum *frustum) {
+	BroadcastFrustum result;
+	for (int i = 0; i < 6; ++i) {
+		Plane *plane = &frustum->planes[i];
+		result.normal_x[i] = _mm_set1_ps(plane->normal.x);
+		result.normal_y[i] = _mm_set1_ps(plane->normal.y);
+		result.normal_z[i] = _mm_set1_ps(plane->normal.z);
+		result.abs_normal_x[i] = _mm_set1_ps(math::abs(plane->normal.x));
+		result.abs_normal_y[i] = _mm_set1_ps(math::abs(plane->normal.y));
+		result.abs_normal_z[i] = _mm_set1_ps(math::abs(plane->normal.z));
+		result.distance[i] = _mm_set1_ps(plane->distance);
+	}
+	return result;
+}
+#endif
+
+void cull_aabb_kernel(void *data, uint32_t start, uint32_t end) {
+	CullData *cull = (CullData *)data;
+	const AABB *boxes = (const AABB *)cull->volumes;
+#ifdef CPPLIB_MATHS_SSE
+	BroadcastFrustum frustum = broadcast_frustum(&cull->frustum);
+	__m128 zero = _mm_setzero_ps();
+#endif
+	for (uint32_t word = start; word < end; ++word) {
+		uint32_t first = word * 32;
+		uint32_t last = first + 32 < cull->count ? first + 32 : cull->count;
+		uint32_t mask = 0;
+		uint32_t i = first;
+#ifdef CPPLIB_MATHS_SSE
+		for (; i + 4 <= last; i += 4) {
+			// Boxes are pairs of Vector3s: (c0 e0 c1 e1) and (c2 e2 c3 e3).
+			__m128 a_x, a_y, a_z, b_x, b_y, b_z;
+			load_vector3x4(&boxes[i].center, &a_x, &a_y, &a_z);
+			load_vector3x4(&boxes[i + 2].center, &b_x, &b_y, &b_z);
+			__m128 center_x = _mm_shuffle_ps(a_x, b_x, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 center_y = _mm_shuffle_ps(a_y, b_y, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 center_z = _mm_shuffle_ps(a_z, b_z, _MM_SHUFFLE(2, 0, 2, 0));
+			__m128 extents_x = _mm_shuffle_ps(a_x, b_x, _MM_SHUFFLE(3, 1, 3, 1));
+			__m128 extents_y = _mm_shuffle_ps(a_y, b_y, _MM_SHUFFLE(3, 1, 3, 1));
+			__m128 extents_z = _mm_shuffle_ps(a_z, b_z, _MM_SHUFFLE(3, 1, 3, 1));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p) {
+				__m128 distance = CPPLIB_MATHS_MADD(frustum.normal_x[p], center_x, frustum.distance[p]);
+				distance = CPPLIB_MATHS_MADD(frustum.normal_y[p], center_y, distance);
+				distance = CPPLIB_MATHS_MADD(frustum.normal_z[p], center_z, distance);
+				distance = CPPLIB_MATHS_MADD(frustum.abs_normal_x[p], extents_x, distance);
+				distance = CPPLIB_MATHS_MADD(frustum.abs_normal_y[p], extents_y, distance);
+				distance = CPPLIB_MATHS_MADD(frustum.abs_normal_z[p], extents_z, distance);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+			mask |= (uint32_t)_mm_movemask_ps(inside) << (i - first);
+		}
+#endif
+		for (; i < last; ++i) {
+			if (math::intersects(cull->frustum, boxes[i])) {
+				mask |= 1u << (i - first);
+			}
+		}
+		cull->visible[word] = mask;
+	}
+}
+
+void cull_sphere_kernel(void *data, uint32_t start, uint32_t end) {
+	CullData *cull = (CullData *)data;
+	const Sphere *spheres = (const Sphere *)cull->volumes;
+#ifdef CPPLIB_MATHS_SSE
+	BroadcastFrustum frustum = broadcast_frustum(&cull->frustum);
+	__m128 zero = _mm_setzero_ps();
+#endif
+	for (uint32_t word = start; word < end; ++word) {
+		uint32_t first = word * 32;
+		uint32_t last = first + 32 < cull->count ? first + 32 : cull->count;
+		uint32_t mask = 0;
+		uint32_t i = first;
+#ifdef CPPLIB_MATHS_SSE
+		for (; i + 4 <= last; i += 4) {
+			__m128 center_x = _mm_loadu_ps(&spheres[i].center.x);
+			__m128 center_y = _mm_loadu_ps(&spheres[i + 1].center.x);
+			__m128 center_z = _mm_loadu_ps(&spheres[i + 2].center.x);
+			__m128 radius = _mm_loadu_ps(&spheres[i + 3].center.x);
+			_MM_TRANSPOSE4_PS(center_x, center_y, center_z, radius);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; ++p) {
+				__m128 distance = CPPLIB_MATHS_MADD(frustum.normal_x[p], center_x, _mm_add_ps(frustum.distance[p], radius));
+				distance = CPPLIB_MATHS_MADD(frustum.normal_y[p], center_y, distance);
+				distance = CPPLIB_MATHS_MADD(frustum.normal_z[p], center_z, distance);
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+			}
+			mask |= (uint32_t)_mm_movemask_ps(inside) << (i - first);
+		}
+#endif
+		for (; i < last; ++i) {
+			if (math::intersects(cull->frustum, spheres[i])) {
+				mask |= 1u << (i - first);
+			}
+		}
+		cull->visible[word] = mask;
+	}
+}
+
+void run_cull(void (*kernel)(void *data, uint32_t start, uint32_t end), CullData *data) {
+	uint32_t word_count = (data->count + 31) / 32;
+#ifdef CPPLIB_MATHS_JOBS
+	if (data->count >= BATCH_PARALLEL_MIN_COUNT) {
+		jobs::parallel_for(word_count, kernel, data, BATCH_PARALLEL_CHUNK_SIZE / 32);
+		return;
+	}
+#endif
+	kernel(data, 0, word_count);
+}
+
+void math::cull(Frustum frustum, const AABB *boxes, uint32_t count, uint32_t *visible) {
+	CullData data = {frustum, boxes, count, visible};
+	run_cull(cull_aabb_kernel, &data);
+}
+
+void math::cull(Frustum frustum, const Sphere *spheres, uint32_t count, uint32_t *visible) {
+	CullData data = {frustum, spheres, count, visible};
+	run_cull(cull_sphere_kernel, &data);
+}
+
+
+// Approximations of transcendental functions.
+// Every function is written once against a "lanes" type providing arithmetic on 1 (scalar), 4 (SSE)
+// or 8 (AVX2) floats, so all versions compute the same polynomials. Coefficients are minimax fits,
+// acos uses Abramowitz & Stegun 4.4.45 and 4.4.46.
+
+struct ScalarLanes {
+	typedef float Float;
+	typedef int32_t Int;
+	typedef bool Mask;
+	static const uint32_t WIDTH = 1;
+
+	static Float load(const float *x) { return *x; }
+	static void store(float *out, Float x) { *out = x; }
+	static Float set(float x) { return x; }
+	static Float add(Float a, Float b) { return a + b; }
+	static Float sub(Float a, Float b) { return a - b; }
+	static Float mul(Float a, Float b) { return a * b; }
+	static Float div(Float a, Float b) { return a / b; }
+	static Float madd(Float a, Float b, Float c) { return a * b + c; }
+	static Float min(Float a, Float b) { return a < b ? a : b; }
+	static Float max(Float a, Float b) { return a > b ? a : b; }
+	static Float abs(Float a) { return fabsf(a); }
+	static Float sqrt(Float a) { return sqrtf(a); }
+#ifdef CPPLIB_MATHS_SSE
+	// Same conversions as SSELanes, nearbyintf and floorf are library calls without SSE4.1.
+	static Float round(Float a) { return float(_mm_cvtss_si32(_mm_set_ss(a))); }
+	static Float floor(Float a) {
+		Float truncated = float(int32_t(a));
+		return truncated > a ? truncated - 1.0f : truncated;
+	}
+#else
+	static Float round(Float a) { return nearbyintf(a); }
+	static Float floor(Float a) { return floorf(a); }
+#endif
+	// Copy sign of `b` to `a`.
+	static Float copy_sign(Float a, Float b) { return copysignf(a, b); }
+	static Mask less(Float a, Float b) { return a < b; }
+	static Mask less_equal(Float a, Float b) { return a <= b; }
+	static Mask equal(Float a, Float b) { return a == b; }
+	static Float select(Mask mask, Float a, Float b) { return mask ? a : b; }
+
+	static Int as_int(Float a) { Int result; memcpy(&result, &a, 4); return result; }
+	static Float as_float(Int a) { Float result; memcpy(&result, &a, 4); return result; }
+	static Int to_int(Float a) { return Int(a); }
+	static Float to_float(Int a) { return Float(a); }
+	static Int set_int(int32_t a) { return a; }
+	static Int add_int(Int a, Int b) { return a + b; }
+	static Int and_int(Int a, Int b) { return a & b; }
+	static Int or_int(Int a, Int b) { return a | b; }
+	static Int shift_left(Int a, int bits) { return Int(uint32_t(a) << bits); }
+	static Int shift_right(Int a, int bits) { return Int(uint32_t(a) >> bits); }
+};
+
+#ifdef CPPLIB_MATHS_SSE
+struct SSELanes {
+	typedef __m128 Float;
+	typedef __m128i Int;
+	typedef __m128 Mask;
+	static const uint32_t WIDTH = 4;
+
+	static Float load(const float *x) { return _mm_loadu_ps(x); }
+	static void store(float *out, Float x) { _mm_storeu_ps(out, x); }
+	static Float set(float x) { return _mm_set1_ps(x); }
+	static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static Float div(Float a, Float b) { return _mm_div_ps(a, b); }
+	static Float madd(Float a, Float b, Float c) { return CPPLIB_MATHS_MADD(a, b, c); }
+	static Float min(Float a, Float b) { return _mm_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+	static Float abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	static Float sqrt(Float a) { return _mm_sqrt_ps(a); }
+	// Conversions round to nearest with default rounding mode, valid for |a| < 2^31.
+	static Float round(Float a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+	static Float floor(Float a) {
+		Float truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.0f)));
+	}
+	static Float copy_sign(Float a, Float b) {
+		Float sign_mask = _mm_set1_ps(-0.0f);
+		return _mm_or_ps(_mm_andnot_ps(sign_mask, a), _mm_and_ps(sign_mask, b));
+	}
+	static Mask less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	static Mask less_equal(Float a, Float b) { return _mm_cmple_ps(a, b); }
+	static Mask equal(Float a, Float b) { return _mm_cmpeq_ps(a, b); }
+	static Float select(Mask mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	static Int as_int(Float a) { return _mm_castps_si128(a); }
+	static Float as_float(Int a) { return _mm_castsi128_ps(a); }
+	static Int to_int(Float a) { return _mm_cvttps_epi32(a); }
+	static Float to_float(Int a) { return _mm_cvtepi32_ps(a); }
+	static Int set_int(int32_t a) { return _mm_set1_epi32(a); }
+	static Int add_int(Int a, Int b) { return _mm_add_epi32(a, b); }
+	static Int and_int(Int a, Int b) { return _mm_and_si128(a, b); }
+	static Int or_int(Int a, Int b) { return _mm_or_si128(a, b); }
+	static Int shift_left(Int a, int bits) { return _mm_slli_epi32(a, bits); }
+	static Int shift_right(Int a, int bits) { return _mm_srli_epi32(a, bits); }
+};
+#endif
+
+#if defined(CPPLIB_MATHS_SSE) && defined(__AVX2__)
+struct AVXLanes {
+	typedef __m256 Float;
+	typedef __m256i Int;
+	typedef __m256 Mask;
+	static const uint32_t WIDTH = 8;
+
+	static Float load(const float *x) { return _mm256_loadu_ps(x); }
+	static void store(float *out, Float x) { _mm256_storeu_ps(out, x); }
+	static Float set(float x) { return _mm256_set1_ps(x); }
+	static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static Float div(Float a, Float b) { return _mm256_div_ps(a, b); }
+#if defined(CPPLIB_MATHS_FMA)
+	static Float madd(Float a, Float b, Float c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+	static Float madd(Float a, Float b, Float c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+	static Float min(Float a, Float b) { return _mm256_min_ps(a, b); }
+	static Float max(Float a, Float b) { return _mm256_max_ps(a, b); }
+	static Float abs(Float a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	static Float sqrt(Float a) { return _mm256_sqrt_ps(a); }
+	static Float round(Float a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	static Float floor(Float a) { return _mm256_floor_ps(a); }
+	static Float copy_sign(Float a, Float b) {
+		Float sign_mask = _mm256_set1_ps(-0.0f);
+		return _mm256_or_ps(_mm256_andnot_ps(sign_mask, a), _mm256_and_ps(sign_mask, b));
+	}
+	static Mask less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Mask less_equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+	static Mask equal(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+	static Float select(Mask mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+
+	static Int as_int(Float a) { return _mm256_castps_si256(a); }
+	static Float as_float(Int a) { return _mm256_castsi256_ps(a); }
+	static Int to_int(Float a) { return _mm256_cvttps_epi32(a); }
+	static Float to_float(Int a) { return _mm256_cvtepi32_ps(a); }
+	static Int set_int(int32_t a) { return _mm256_set1_epi32(a); }
+	static Int add_int(Int a, Int b) { return _mm256_add_epi32(a, b); }
+	static Int and_int(Int a, Int b) { return _mm256_and_si256(a, b); }
+	static Int or_int(Int a, Int b) { return _mm256_or_si256(a, b); }
+	static Int shift_left(Int a, int bits) { return _mm256_slli_epi32(a, bits); }
+	static Int shift_right(Int a, int bits) { return _mm256_srli_epi32(a, bits); }
+};
+#endif
+
+// Horner's scheme for `N` coefficients from lowest degree, unrolled at compile time.
+template<typename L, int N>
+struct Horner {
+	static typename L::Float run(typename L::Float x, const float *coefficients) {
+		return L::madd(Horner<L, N - 1>::run(x, coefficients + 1), x, L::set(coefficients[0]));
+	}
+};
+
+template<typename L>
+struct Horner<L, 1> {
+	static typename L::Float run(typename L::Float, const float *coefficients) {
+		return L::set(coefficients[0]);
+	}
+};
+
+template<typename L, int N>
+typename L::Float polynomial(typename L::Float x, const float (&coefficients)[N]) {
+	return Horner<L, N>::run(x, coefficients);
+}
+
+// sin(x) / x on [-pi/2, pi/2], in powers of x^2.
+const float SIN_FAST[] = {9.996967862e-01f, -1.656730973e-01f, 7.514382540e-03f};
+const float SIN_HIGH[] = {9.999999766e-01f, -1.666664764e-01f, 8.332899855e-03f, -1.980089939e-04f, 2.590491315e-06f};
+// atan(x) / x on [0, 1], in powers of x^2.
+const float ATAN_FAST[] = {9.992138204e-01f, -3.211749757e-01f, 1.462644226e-01f, -3.898647255e-02f};
+const float ATAN_HIGH[] = {9.999993352e-01f, -3.332985937e-01f, 1.994654974e-01f, -1.390855192e-01f,
+						   9.642004268e-02f, -5.590976699e-02f, 2.186123446e-02f, -4.054104018e-03f};
+// acos(x) / sqrt(1 - x) on [0, 1].
+const float ACOS_FAST[] = {1.5707288f, -0.2121144f, 0.0742610f, -0.0187293f};
+const float ACOS_HIGH[] = {1.5707963050f, -0.2145988016f, 0.0889789874f, -0.0501743046f,
+						   0.0308918810f, -0.0170881256f, 0.0066700901f, -0.0012624911f};
+// log2(1 + x) / x on [0, 1].
+const float LOG2_FAST[] = {1.439014485e+00f, -6.799428682e-01f, 3.255936374e-01f, -8.476758124e-02f};
+const float LOG2_HIGH[] = {1.442689910e+00f, -7.211665483e-01f, 4.786901065e-01f, -3.473272967e-01f,
+						   2.419221172e-01f, -1.375902837e-01f, 5.210194985e-02f, -9.320001750e-03f};
+// 2^x on [0, 1].
+const float EXP2_FAST[] = {9.999252200e-01f, 6.958335092e-01f, 2.260672467e-01f, 7.802445852e-02f};
+const float EXP2_HIGH[] = {9.999999251e-01f, 6.931530731e-01f, 2.401536176e-01f, 5.582631645e-02f,
+						   8.989342021e-03f, 1.877575870e-03f};
+
+#define APPROX_POLYNOMIAL(L, x, name, accuracy) \
+	((accuracy) == math::ACCURACY_FAST ? polynomial<L>(x, name##_FAST) : polynomial<L>(x, name##_HIGH))
+
+struct SinApprox {
+	// Reduce to [-pi, pi], 2pi split into two parts so k * 2pi is exact for moderate k.
+	template<typename L>
+	static typename L::Float reduce(typename L::Float x) {
+		typedef typename L::Float Float;
+		Float k = L::round(L::mul(x, L::set(0.159154943f)));
+		Float r = L::sub(x, L::mul(k, L::set(6.28125f)));
+		return L::sub(r, L::mul(k, L::set(1.93530717e-3f)));
+	}
+
+	// sin(x) for x in [-pi/2, pi/2].
+	template<typename L>
+	static typename L::Float evaluate(typename L::Float x, math::Accuracy accuracy) {
+		return L::mul(x, APPROX_POLYNOMIAL(L, L::mul(x, x), SIN, accuracy));
+	}
+
+	template<typename L>
+	static typename L::Float run(typename L::Float x, math::Accuracy accuracy) {
+		typedef typename L::Float Float;
+		Float r = reduce<L>(x);
+
+		// sin(pi - x) = sin(x), so fold [pi/2, pi] onto [0, pi/2].
+		Float a = L::abs(r);
+		a = L::min(a, L::sub(L::set(math::PI), a));
+		return evaluate<L>(L::copy_sign(a, r), accuracy);
+	}
+};
+
+struct CosApprox {
+	template<typename L>
+	static typename L::Float run(typename L::Float x, math::Accuracy accuracy) {
+		// cos(x) = sin(pi/2 - |x|), reducing first keeps the precision of the small angles.
+		typename L::Float r = SinApprox::reduce<L>(x);
+		return SinApprox::evaluate<L>(L::sub(L::set(math::PIHALF), L::abs(r)), accuracy);
+	}
+};
+
+struct Atan2Approx {
+	template<typename L>
+	static typename L::Float run(typename L::Float y, typename L::Float x, math::Accuracy accuracy) {
+		typedef typename L::Float Float;
+		Float abs_x = L::abs(x);
+		Float abs_y = L::abs(y);
+		Float max = L::max(abs_x, abs_y);
+		// atan2(0, 0) = 0.
+		Float a = L::div(L::min(abs_x, abs_y), L::select(L::less(max, L::set(1e-30f)), L::set(1.0f), max));
+		Float r = L::mul(a, APPROX_POLYNOMIAL(L, L::mul(a, a), ATAN, accuracy));
+
+		r = L::select(L::less(abs_x, abs_y), L::sub(L::set(math::PIHALF), r), r);
+		r = L::select(L::less(x, L::set(0.0f)), L::sub(L::set(math::PI), r), r);
+		return L::copy_sign(r, y);
+	}
+};
+
+struct AcosApprox {
+	template<typename L>
+	static typename L::Float run(typename L::Float x, math::Accuracy accuracy) {
+		typedef typename L::Float Float;
+		Float a = L::min(L::abs(x), L::set(1.0f));
+		Float r = L::mul(L::sqrt(L::sub(L::set(1.0f), a)), APPROX_POLYNOMIAL(L, a, ACOS, accuracy));
+		return L::select(L::less(x, L::set(0.0f)), L::sub(L::set(math::PI), r), r);
+	}
+};
+
+struct PowApprox {
+	template<typename L>
+	static typename L::Float run(typename L::Float x, typename L::Float e, math::Accuracy accuracy) {
+		typedef typename L::Float Float;
+		typedef typename L::Int Int;
+		// log2(x) = exponent + log2(mantissa), mantissa in [1, 2).
+		Int bits = L::as_int(x);
+		Float exponent = L::to_float(L::add_int(L::shift_right(bits, 23), L::set_int(-127)));
+		Float mantissa = L::as_float(L::or_int(L::and_int(bits, L::set_int(0x007FFFFF)), L::set_int(0x3F800000)));
+		Float u = L::sub(mantissa, L::set(1.0f));
+		Float log2_x = L::madd(u, APPROX_POLYNOMIAL(L, u, LOG2, accuracy), exponent);
+
+		// 2^y = 2^floor(y) * 2^fraction, 2^floor(y) added directly to the exponent bits.
+		Float y = L::min(L::max(L::mul(e, log2_x), L::set(-126.0f)), L::set(127.0f));
+		Float integer = L::floor(y);
+		Float fraction = L::sub(y, integer);
+		Float power = APPROX_POLYNOMIAL(L, fraction, EXP2, accuracy);
+		Float result = L::as_float(L::add_int(L::as_int(power), L::shift_left(L::to_int(integer), 23)));
+
+		result = L::select(L::less_equal(x, L::set(0.0f)), L::set(0.0f), result);
+		// x^0 is 1 for every x, including 0, like powf.
+		return L::select(L::equal(e, L::set(0.0f)), L::set(1.0f), result);
+	}
+};
+
+#undef APPROX_POLYNOMIAL
+
+// Run approximation `F` over arrays, widest lanes first and then the remaining tail.
+template<typename F>
+void approx_array(const float *x, float *out, uint32_t count, math::Accuracy accuracy) {
+	uint32_t i = 0;
+#if defined(CPPLIB_MATHS_SSE) && defined(__AVX2__)
+	for (; i + 8 <= count; i += 8)
+		AVXLanes::store(&out[i], F::template run<AVXLanes>(AVXLanes::load(&x[i]), accuracy));
+#endif
+#ifdef CPPLIB_MATHS_SSE
+	for (; i + 4 <= count; i += 4)
+		SSELanes::store(&out[i], F::template run<SSELanes>(SSELanes::load(&x[i]), accuracy));
+#endif
+	for (; i < count; ++i)
+		out[i] = F::template run<ScalarLanes>(x[i], accuracy);
+}
+
+template<typename F>
+void approx_array(const float *x, const float *y, float *out, uint32_t count, math::Accuracy accuracy) {
+	uint32_t i = 0;
+#if defined(CPPLIB_MATHS_SSE) && defined(__AVX2__)
+	for (; i + 8 <= count; i += 8)
+		AVXLanes::store(&out[i], F::template run<AVXLanes>(AVXLanes::load(&x[i]), AVXLanes::load(&y[i]), accuracy));
+#endif
+#ifdef CPPLIB_MATHS_SSE
+	for (; i + 4 <= count; i += 4)
+		SSELanes::store(&out[i], F::template run<SSELanes>(SSELanes::load(&x[i]), SSELanes::load(&y[i]), accuracy));
+#endif
+	for (; i < count; ++i)
+		out[i] = F::template run<ScalarLanes>(x[i], y[i], accuracy);
+}
+
+float math::sin_approx(float x, Accuracy accuracy) {
+	return SinApprox::run<ScalarLanes>(x, accuracy);
+}
+
+float math::cos_approx(float x, Accuracy accuracy) {
+	return CosApprox::run<ScalarLanes>(x, accuracy);
+}
+
+float math::atan2_approx(float y, float x, Accuracy accuracy) {
+	return Atan2Approx::run<ScalarLanes>(y, x, accuracy);
+}
+
+float math::acos_approx(float x, Accuracy accuracy) {
+	return AcosApprox::run<ScalarLanes>(x, accuracy);
+}
+
+float math::pow_approx(float x, float e, Accuracy accuracy) {
+	return PowApprox::run<ScalarLanes>(x, e, accuracy);
+}
+
+void math::sin_approx(const float *x, float *out, uint32_t count, Accuracy accuracy) {
+	approx_array<SinApprox>(x, out, count, accuracy);
+}
+
+void math::cos_approx(const float *x, float *out, uint32_t count, Accuracy accuracy) {
+	approx_array<CosApprox>(x, out, count, accuracy);
+}
+
+void math::atan2_approx(const float *y, const float *x, float *out, uint32_t count, Accuracy accuracy) {
+	approx_array<Atan2Approx>(y, x, out, count, accuracy);
+}
+
+void math::acos_approx(const float *x, float *out, uint32_t count, Accuracy accuracy) {
+	approx_array<AcosApprox>(x, out, count, accuracy);
+}
+
+void math::pow_approx(const float *x, const float *e, float *out, uint32_t count, Accuracy accuracy) {
+	approx_array<PowApprox>(x, e, out, count, accuracy);
+}
+
+// Random numbers.
+// Scalar functions use xoshiro128** state of the calling thread. Bulk functions seed 4 independent
+// generators from it, one per SIMD lane, and step them together.
+
+struct RandomState {
+	uint32_t s[4];
+};
+
+inline uint32_t rotate_left(uint32_t x, int k) {
+	return (x << k) | (x >> (32 - k));
+}
+
+uint64_t splitmix64(uint64_t *x) {
+	uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+void seed_random_state(RandomState *state, uint64_t seed) {
+	uint64_t a = splitmix64(&seed);
+	uint64_t b = splitmix64(&seed);
+	state->s[0] = uint32_t(a);
+	state->s[1] = uint32_t(a >> 32);
+	state->s[2] = uint32_t(b);
+	state->s[3] = uint32_t(b >> 32);
+}
+
+uint32_t next_random(RandomState *state) {
+	uint32_t *s = state->s;
+	uint32_t result = rotate_left(s[1] * 5, 7) * 9;
+	uint32_t t = s[1] << 9;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotate_left(s[3], 11);
+
+	return result;
+}
+
+// Upper 24 bits mapped to [0, 1).
+inline float random_to_float(uint32_t x) {
+	return float(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Maps to [0, range) by taking the high half of 64-bit product, which avoids the division in %.
+inline uint32_t random_to_range(uint32_t x, uint32_t range) {
+	return uint32_t((uint64_t(x) * range) >> 32);
+}
+
+std::atomic<uint64_t> next_thread_seed(0);
+
+struct ThreadRandomState {
+	RandomState state;
+
+	ThreadRandomState() {
+		seed_random_state(&state, next_thread_seed.fetch_add(1, std::memory_order_relaxed));
+	}
+};
+
+thread_local ThreadRandomState thread_random;
+
+void math::random_seed(uint64_t seed) {
+	seed_random_state(&thread_random.state, seed);
+}
+
+uint32_t math::random_uint32() {
+	return next_random(&thread_random.state);
+}
 
-// TODO: other source of randomness than rand()
-#include <cstdlib>
 float math::random_uniform(float low, float high) {
-	float normalized = (rand() % 10000) / 10000.0f;
+	float normalized = random_to_float(next_random(&thread_random.state));
 	float result = normalized * (high - low) + low;
 
 	return result;
 }
 
 int math::random_uniform_int(int low, int high) {
-	int result = (rand() % (high - low)) + low;
+	int result = int(random_to_range(next_random(&thread_random.state), uint32_t(high - low))) + low;
 	return result;
 }
 
+// Uniform point inside the unit sphere, sampled by rejection from [-1, 1]^3 cube, which
+// accepts ~52% of points and is a lot cheaper than pow, acos, sin and cos.
 Vector3 math::random_uniform_unit_sphere() {
-	float azimuth = math::random_uniform(0, math::PI2);
-	float polar = math::acos(2 * math::random_uniform() - 1);
-	float r = math::pow(math::random_uniform(), 1.0f / 3.0f);
-	
-	Vector3 result;
+	RandomState *state = &thread_random.state;
+	while (true) {
+		Vector3 result;
+		result.x = random_to_float(next_random(state)) * 2.0f - 1.0f;
+		result.y = random_to_float(next_random(state)) * 2.0f - 1.0f;
+		result.z = random_to_float(next_random(state)) * 2.0f - 1.0f;
+		if (math::length_squared(result) <= 1.0f)
+			return result;
+	}
+}
 
-	result.x = r * math::cos(azimuth) * math::sin(polar);
-	result.y = r * math::cos(polar);
-	result.z = r * math::sin(azimuth) * math::sin(polar);
+// Direction uniform on the upper hemisphere (normalized point from the sphere), with
+// square root of uniform number as the radius.
+Vector3 math::random_uniform_unit_hemisphere() {
+	while (true) {
+		Vector3 result = math::random_uniform_unit_sphere();
+		float length_squared = math::length_squared(result);
+		if (length_squared < 1e-6f)
+			continue;
+
+		float radius = math::sqrt(random_to_float(next_random(&thread_random.state)));
+		result = result * (radius / math::sqrt(length_squared));
+		result.y = math::abs(result.y);
+		return result;
+	}
+}
 
+#ifdef CPPLIB_MATHS_SSE
+// 4 xoshiro128** generators, lane i of s[j] is state j of generator i.
+struct RandomStateX4 {
+	__m128i s[4];
+};
+
+RandomStateX4 get_random_state_x4() {
+	RandomStateX4 result;
+	RandomState *state = &thread_random.state;
+	uint32_t lanes[4][4];
+	for (int lane = 0; lane < 4; ++lane) {
+		RandomState lane_state;
+		seed_random_state(&lane_state, (uint64_t(next_random(state)) << 32) | next_random(state));
+		for (int i = 0; i < 4; ++i)
+			lanes[i][lane] = lane_state.s[i];
+	}
+	for (int i = 0; i < 4; ++i)
+		result.s[i] = _mm_loadu_si128((const __m128i *)lanes[i]);
 	return result;
 }
 
-Vector3 math::random_uniform_unit_hemisphere() {
-	float y = math::random_uniform(0.0f, 1.0f);
-	float r = math::sqrt(1.0f - y * y);
-	float phi = math::random_uniform(0.0f, math::PI2);
-
-	float radius = math::random_uniform(0.0f, 1.0f);
-	radius = math::sqrt(radius);
-	
-	Vector3 result;
+inline __m128i rotate_left_x4(__m128i x, int k) {
+	return _mm_or_si128(_mm_slli_epi32(x, k), _mm_srli_epi32(x, 32 - k));
+}
 
-	result.x = r * math::cos(phi) * radius;
-	result.y = y * radius;
-	result.z = r * math::sin(phi) * radius;
+// No 32-bit multiply in SSE2, *5 and *9 are done with shifts and adds.
+inline __m128i next_random_x4(RandomStateX4 *state) {
+	__m128i *s = state->s;
+	__m128i times_5 = _mm_add_epi32(_mm_slli_epi32(s[1], 2), s[1]);
+	__m128i rotated = rotate_left_x4(times_5, 7);
+	__m128i result = _mm_add_epi32(_mm_slli_epi32(rotated, 3), rotated);
+	__m128i t = _mm_slli_epi32(s[1], 9);
+
+	s[2] = _mm_xor_si128(s[2], s[0]);
+	s[3] = _mm_xor_si128(s[3], s[1]);
+	s[1] = _mm_xor_si128(s[1], s[2]);
+	s[0] = _mm_xor_si128(s[0], s[3]);
+	s[2] = _mm_xor_si128(s[2], t);
+	s[3] = rotate_left_x4(s[3], 11);
 
 	return result;
+}
+
+inline __m128 random_to_float_x4(__m128i x) {
+	return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+}
+
+// Random points in [-1, 1]^3 cube and mask of those inside the unit sphere.
+inline int random_sphere_candidates_x4(RandomStateX4 *state, __m128 *x, __m128 *y, __m128 *z, __m128 *length_squared) {
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 one = _mm_set1_ps(1.0f);
+	*x = _mm_sub_ps(_mm_mul_ps(random_to_float_x4(next_random_x4(state)), two), one);
+	*y = _mm_sub_ps(_mm_mul_ps(random_to_float_x4(next_random_x4(state)), two), one);
+	*z = _mm_sub_ps(_mm_mul_ps(random_to_float_x4(next_random_x4(state)), two), one);
+	*length_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(*x, *x), _mm_mul_ps(*y, *y)), _mm_mul_ps(*z, *z));
+	return _mm_movemask_ps(_mm_cmple_ps(*length_squared, one));
+}
+
+// Write lanes selected by `mask` to `out`, returns number of written vectors.
+inline uint32_t store_selected_vector3(Vector3 *out, uint32_t max_count, int mask, __m128 x, __m128 y, __m128 z) {
+	float xs[4], ys[4], zs[4];
+	_mm_storeu_ps(xs, x);
+	_mm_storeu_ps(ys, y);
+	_mm_storeu_ps(zs, z);
+	uint32_t written = 0;
+	for (int lane = 0; lane < 4 && written < max_count; ++lane) {
+		if (mask & (1 << lane)) {
+			out[written++] = Vector3(xs[lane], ys[lane], zs[lane]);
+		}
+	}
+	return written;
+}
+#endif
+
+void math::random_uniform_n(float *out, uint32_t count, float low, float high) {
+	uint32_t i = 0;
+#ifdef CPPLIB_MATHS_SSE
+	if (count >= 16) {
+		RandomStateX4 state = get_random_state_x4();
+		__m128 scale = _mm_set1_ps(high - low);
+		__m128 offset = _mm_set1_ps(low);
+		for (; i + 4 <= count; i += 4) {
+			__m128 normalized = random_to_float_x4(next_random_x4(&state));
+			_mm_storeu_ps(&out[i], _mm_add_ps(_mm_mul_ps(normalized, scale), offset));
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = math::random_uniform(low, high);
+}
+
+void math::random_uniform_int_n(int *out, uint32_t count, int low, int high) {
+	uint32_t i = 0;
+#ifdef CPPLIB_MATHS_SSE
+	if (count >= 16) {
+		RandomStateX4 state = get_random_state_x4();
+		__m128i range = _mm_set1_epi32(high - low);
+		__m128i offset = _mm_set1_epi32(low);
+		__m128i high_halves = _mm_set_epi32(-1, 0, -1, 0);
+		for (; i + 4 <= count; i += 4) {
+			// High 32 bits of x * range, even lanes from one multiply and odd lanes from another.
+			__m128i x = next_random_x4(&state);
+			__m128i even = _mm_srli_epi64(_mm_mul_epu32(x, range), 32);
+			__m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(x, 32), range), high_halves);
+			__m128i result = _mm_add_epi32(_mm_or_si128(even, odd), offset);
+			_mm_storeu_si128((__m128i *)&out[i], result);
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = math::random_uniform_int(low, high);
+}
+
+void math::random_uniform_unit_sphere_n(Vector3 *out, uint32_t count) {
+	uint32_t i = 0;
+#ifdef CPPLIB_MATHS_SSE
+	if (count >= 16) {
+		RandomStateX4 state = get_random_state_x4();
+		while (i < count) {
+			__m128 x, y, z, length_squared;
+			int mask = random_sphere_candidates_x4(&state, &x, &y, &z, &length_squared);
+			i += store_selected_vector3(&out[i], count - i, mask, x, y, z);
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = math::random_uniform_unit_sphere();
+}
+
+void math::random_uniform_unit_hemisphere_n(Vector3 *out, uint32_t count) {
+	uint32_t i = 0;
+#ifdef CPPLIB_MATHS_SSE
+	if (count >= 16) {
+		RandomStateX4 state = get_random_state_x4();
+		__m128 min_length_squared = _mm_set1_ps(1e-6f);
+		__m128 sign_mask = _mm_set1_ps(-0.0f);
+		while (i < count) {
+			__m128 x, y, z, length_squared;
+			int mask = random_sphere_candidates_x4(&state, &x, &y, &z, &length_squared);
+			mask &= _mm_movemask_ps(_mm_cmpge_ps(length_squared, min_length_squared));
+
+			__m128 radius = _mm_sqrt_ps(random_to_float_x4(next_random_x4(&state)));
+			__m128 scale = _mm_div_ps(radius, _mm_sqrt_ps(length_squared));
+			x = _mm_mul_ps(x, scale);
+			y = _mm_andnot_ps(sign_mask, _mm_mul_ps(y, scale));
+			z = _mm_mul_ps(z, scale);
+			i += store_selected_vector3(&out[i], count - i, mask, x, y, z);
+		}
+	}
+#endif
+	for (; i < count; ++i)
+		out[i] = math::random_uniform_unit_hemisphere();
 }
\ No newline at end of file
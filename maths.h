@@ -4,6 +4,46 @@
 
 // TODO: Later split into separate files for Vectors/Matrices
 
+// Vector4, Matrix4x4 and Matrix3x4 operations and batch operations over arrays use SSE when the compiler targets it,
+// with fused multiply-adds when FMA is enabled (-mfma, or /arch:AVX2 on MSVC, which has no __FMA__) and 256-bit
+// registers for Vector4 batches when AVX is enabled. Define CPPLIB_MATHS_NO_SIMD to force the scalar code paths.
+#if !defined(CPPLIB_MATHS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define CPPLIB_MATHS_SSE
+#include <emmintrin.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define CPPLIB_MATHS_FMA
+#define CPPLIB_MATHS_MADD(a, b, c) _mm_fmadd_ps(a, b, c)
+#else
+#define CPPLIB_MATHS_MADD(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+#endif
+#endif
+
+// Constructors, operators and the basic matrix builders are constexpr, so fixed transforms can be folded at
+// compile time. Operators with SSE paths switch to the scalar code during constant evaluation, which needs
+// __builtin_is_constant_evaluated (MSVC 2019 16.5, GCC 9, Clang 9). Older compilers get them as non-constexpr,
+// CPPLIB_MATHS_SIMD_IS_CONSTEXPR tells whether they're constexpr.
+#if defined(CPPLIB_MATHS_SSE)
+#if defined(_MSC_VER) && _MSC_VER >= 1925
+#define CPPLIB_MATHS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#elif defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define CPPLIB_MATHS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#elif defined(__GNUC__) && __GNUC__ >= 9
+#define CPPLIB_MATHS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#endif
+#if !defined(CPPLIB_MATHS_SSE) || defined(CPPLIB_MATHS_CONSTANT_EVALUATED)
+#define CPPLIB_MATHS_SIMD_CONSTEXPR constexpr
+#define CPPLIB_MATHS_SIMD_IS_CONSTEXPR
+#else
+#define CPPLIB_MATHS_SIMD_CONSTEXPR
+#define CPPLIB_MATHS_CONSTANT_EVALUATED() false
+#endif
+
 struct Vector2 {
 	union {
 		float v[2];
@@ -13,17 +53,25 @@ struct Vector2 {
 		};
 	};
 
-	Vector2():
+	constexpr Vector2():
 		x(0), y(0) {
 
 	}
 
-	Vector2(float x, float y) :
+	constexpr Vector2(float x, float y) :
 		x(x), y(y) {
 
 	}
 
-	Vector2 operator-(Vector2 v) {
+	constexpr float& operator[](int index) {
+		return v[index];
+	}
+
+	constexpr float operator[](int index) const {
+		return v[index];
+	}
+
+	constexpr Vector2 operator-(Vector2 v) const {
 		Vector2 result;
 
 		result.x = this->x - v.x;
@@ -32,7 +80,7 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2 operator-(float x) {
+	constexpr Vector2 operator-(float x) const {
 		Vector2 result;
 
 		result.x = this->x - x;
@@ -41,7 +89,7 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2 operator+(Vector2 v) {
+	constexpr Vector2 operator+(Vector2 v) const {
 		Vector2 result;
 
 		result.x = this->x + v.x;
@@ -50,7 +98,7 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2 operator+(float x) {
+	constexpr Vector2 operator+(float x) const {
 		Vector2 result;
 
 		result.x = this->x + x;
@@ -59,7 +107,7 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2 operator/(float x) {
+	constexpr Vector2 operator/(float x) const {
 		Vector2 result;
 
 		result.x = this->x / x;
@@ -68,7 +116,7 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2 operator*(float x) {
+	constexpr Vector2 operator*(float x) const {
 		Vector2 result;
 
 		result.x = this->x * x;
@@ -77,28 +125,28 @@ struct Vector2 {
 		return result;
 	}
 
-	Vector2& operator+=(Vector2 v) {
+	constexpr Vector2& operator+=(Vector2 v) {
 		this->x += v.x;
 		this->y += v.y;
 
 		return *this;
 	}
 
-	Vector2& operator-=(Vector2 v) {
+	constexpr Vector2& operator-=(Vector2 v) {
 		this->x -= v.x;
 		this->y -= v.y;
 
 		return *this;
 	}
 
-	Vector2& operator-=(float x) {
+	constexpr Vector2& operator-=(float x) {
 		this->x -= x;
 		this->y -= x;
 
 		return *this;
 	}
 
-	Vector2& operator*=(float x) {
+	constexpr Vector2& operator*=(float x) {
 		this->x *= x;
 		this->y *= x;
 
@@ -123,22 +171,27 @@ struct Vector3 {
 		};
 	};
 
-	Vector3() :
-		v() {
+	constexpr Vector3() :
+		x(0), y(0), z(0) {
+
 	}
 
-	Vector3(float x, float y, float z) :
+	constexpr Vector3(float x, float y, float z) :
 		x(x), y(y), z(z) {
 
 	}
 
-	Vector3(Vector4 v);
+	constexpr Vector3(Vector4 v);
+
+	constexpr float& operator[](int index) {
+		return v[index];
+	}
 
-	float& operator[](int index) {
+	constexpr float operator[](int index) const {
 		return v[index];
 	}
 
-	Vector3 operator-() {
+	constexpr Vector3 operator-() const {
 		Vector3 result;
 
 		result.x = -this->x;
@@ -149,7 +202,7 @@ struct Vector3 {
 	}
 
 
-	Vector3 operator-(Vector3 v) {
+	constexpr Vector3 operator-(Vector3 v) const {
 		Vector3 result;
 
 		result.x = this->x - v.x;
@@ -159,7 +212,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3 operator+(Vector3 v) {
+	constexpr Vector3 operator+(Vector3 v) const {
 		Vector3 result;
 
 		result.x = this->x + v.x;
@@ -169,7 +222,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3 operator+(float x) {
+	constexpr Vector3 operator+(float x) const {
 		Vector3 result;
 
 		result.x = this->x + x;
@@ -179,7 +232,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3 operator-(float x) {
+	constexpr Vector3 operator-(float x) const {
 		Vector3 result;
 
 		result.x = this->x - x;
@@ -189,7 +242,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3 operator*(float x) {
+	constexpr Vector3 operator*(float x) const {
 		Vector3 result;
 
 		result.x = this->x * x;
@@ -199,7 +252,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3 operator/(float x) {
+	constexpr Vector3 operator/(float x) const {
 		Vector3 result;
 
 		result.x = this->x / x;
@@ -209,7 +262,7 @@ struct Vector3 {
 		return result;
 	}
 
-	Vector3& operator+=(Vector3 v) {
+	constexpr Vector3& operator+=(Vector3 v) {
 		this->x += v.x;
 		this->y += v.y;
 		this->z += v.z;
@@ -217,7 +270,7 @@ struct Vector3 {
 		return *this;
 	}
 
-	Vector3& operator-=(Vector3 v) {
+	constexpr Vector3& operator-=(Vector3 v) {
 		this->x -= v.x;
 		this->y -= v.y;
 		this->z -= v.z;
@@ -247,33 +300,43 @@ struct Vector4 {
 		};
 	};
 
-	float& operator[](int index) {
+	constexpr float& operator[](int index) {
+		return v[index];
+	}
+
+	constexpr float operator[](int index) const {
 		return v[index];
 	}
 
-	Vector4() :
+	constexpr Vector4() :
 		x(0), y(0), z(0), w(0) {
 
 	}
 
-	Vector4(float x, float y, float z, float w) :
+	constexpr Vector4(float x, float y, float z, float w) :
 		x(x), y(y), z(z), w(w) {
 
 	}
 
-	Vector4(Vector2 v, float z, float w):
+	constexpr Vector4(Vector2 v, float z, float w):
 		x(v.x), y(v.y), z(z), w(w) {
 
 	}
 
-	Vector4(Vector3 v, float w):
+	constexpr Vector4(Vector3 v, float w):
 		x(v.x), y(v.y), z(v.z), w(w) {
 
 	}
 
-	Vector4 operator-() {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator-() const {
 		Vector4 result;
 
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(result.v, _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(this->v)));
+			return result;
+		}
+#endif
 		result.x = -this->x;
 		result.y = -this->y;
 		result.z = -this->z;
@@ -282,9 +345,15 @@ struct Vector4 {
 		return result;
 	}
 
-	Vector4 operator+(Vector4 v) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator+(Vector4 v) const {
 		Vector4 result;
 
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(result.v, _mm_add_ps(_mm_loadu_ps(this->v), _mm_loadu_ps(v.v)));
+			return result;
+		}
+#endif
 		result.x = this->x + v.x;
 		result.y = this->y + v.y;
 		result.z = this->z + v.z;
@@ -293,9 +362,15 @@ struct Vector4 {
 		return result;
 	}
 
-	Vector4 operator-(Vector4 v) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator-(Vector4 v) const {
 		Vector4 result;
 
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(result.v, _mm_sub_ps(_mm_loadu_ps(this->v), _mm_loadu_ps(v.v)));
+			return result;
+		}
+#endif
 		result.x = this->x - v.x;
 		result.y = this->y - v.y;
 		result.z = this->z - v.z;
@@ -304,9 +379,15 @@ struct Vector4 {
 		return result;
 	}
 
-	Vector4 operator*(float x) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator*(float x) const {
 		Vector4 result;
 
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(result.v, _mm_mul_ps(_mm_loadu_ps(this->v), _mm_set1_ps(x)));
+			return result;
+		}
+#endif
 		result.x = this->x * x;
 		result.y = this->y * x;
 		result.z = this->z * x;
@@ -315,7 +396,13 @@ struct Vector4 {
 		return result;
 	}
 
-	Vector4 operator*=(float x) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator*=(float x) {
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(this->v, _mm_mul_ps(_mm_loadu_ps(this->v), _mm_set1_ps(x)));
+			return *this;
+		}
+#endif
 		this->x = this->x * x;
 		this->y = this->y * x;
 		this->z = this->z * x;
@@ -324,7 +411,13 @@ struct Vector4 {
 		return *this;
 	}
 
-	Vector4& operator+=(Vector4 v) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4& operator+=(Vector4 v) {
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(this->v, _mm_add_ps(_mm_loadu_ps(this->v), _mm_loadu_ps(v.v)));
+			return *this;
+		}
+#endif
 		this->x += v.x;
 		this->y += v.y;
 		this->z += v.z;
@@ -333,9 +426,15 @@ struct Vector4 {
 		return *this;
 	}
 
-	Vector4 operator/(float x) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator/(float x) const {
 		Vector4 result;
 
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			_mm_storeu_ps(result.v, _mm_div_ps(_mm_loadu_ps(this->v), _mm_set1_ps(x)));
+			return result;
+		}
+#endif
 		result.x = this->x / x;
 		result.y = this->y / x;
 		result.z = this->z / x;
@@ -345,8 +444,15 @@ struct Vector4 {
 	}
 };
 
+constexpr Vector3::Vector3(Vector4 v) :
+	x(v.x), y(v.y), z(v.z) {
+}
+
 typedef Vector4 Quaternion;
-Vector3 operator*(float x, Vector3 v);
+
+constexpr Vector3 operator*(float x, Vector3 v) {
+	return v * x;
+}
 
 // TODO: switch to rows?
 struct Matrix4x4 {
@@ -361,17 +467,39 @@ struct Matrix4x4 {
 		};
 	};
 
-	Matrix4x4() :
+	constexpr Matrix4x4() :
 		x{ 0 } {
 
 	}
 
-	float& operator[](int index) {
+	constexpr float& operator[](int index) {
 		return x[index];
 	}
 
-	Matrix4x4 operator *(Matrix4x4 m) {
+	constexpr float operator[](int index) const {
+		return x[index];
+	}
+
+	CPPLIB_MATHS_SIMD_CONSTEXPR Matrix4x4 operator *(Matrix4x4 m) const {
 		Matrix4x4 result;
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			// Result column i is a combination of this matrix's columns weighted by m's column i.
+			__m128 c0 = _mm_loadu_ps(&x[0]);
+			__m128 c1 = _mm_loadu_ps(&x[4]);
+			__m128 c2 = _mm_loadu_ps(&x[8]);
+			__m128 c3 = _mm_loadu_ps(&x[12]);
+			for(int i = 0; i < 16; i += 4) {
+				__m128 b = _mm_loadu_ps(&m.x[i]);
+				__m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+				r = CPPLIB_MATHS_MADD(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)), r);
+				r = CPPLIB_MATHS_MADD(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), r);
+				r = CPPLIB_MATHS_MADD(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), r);
+				_mm_storeu_ps(&result.x[i], r);
+			}
+			return result;
+		}
+#endif
 		result[0] = x[0] * m[0] + x[4] * m[1] + x[8] * m[2] + x[12] * m[3];
 		result[1] = x[1] * m[0] + x[5] * m[1] + x[9] * m[2] + x[13] * m[3];
 		result[2] = x[2] * m[0] + x[6] * m[1] + x[10] * m[2] + x[14] * m[3];
@@ -394,16 +522,140 @@ struct Matrix4x4 {
 		return result;
 	}
 
-	Vector4 operator *(Vector4 v) {
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator *(Vector4 v) const {
+		Vector4 result;
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			__m128 b = _mm_loadu_ps(v.v);
+			__m128 r = _mm_mul_ps(_mm_loadu_ps(&x[0]), _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+			r = CPPLIB_MATHS_MADD(_mm_loadu_ps(&x[4]), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)), r);
+			r = CPPLIB_MATHS_MADD(_mm_loadu_ps(&x[8]), _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), r);
+			r = CPPLIB_MATHS_MADD(_mm_loadu_ps(&x[12]), _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), r);
+			_mm_storeu_ps(result.v, r);
+			return result;
+		}
+#endif
+		result.x = x[0] * v.x + x[4] * v.y + x[8] * v.z + x[12] * v.w;
+		result.y = x[1] * v.x + x[5] * v.y + x[9] * v.z + x[13] * v.w;
+		result.z = x[2] * v.x + x[6] * v.y + x[10] * v.z + x[14] * v.w;
+		result.w = x[3] * v.x + x[7] * v.y + x[11] * v.z + x[15] * v.w;
+		return result;
+	}
+};
+
+// Affine transform with an implicit (0, 0, 0, 1) bottom row, 48 bytes instead of 64. Unlike Matrix4x4,
+// rows are stored contiguously: x[0..3] is (m00, m01, m02, tx), x[4..7] is (m10, m11, m12, ty) and so on,
+// so arrays can be uploaded as is for shaders reading row-major float3x4 matrices.
+struct Matrix3x4 {
+	float x[12];
+
+	constexpr Matrix3x4() :
+		x{ 0 } {
+
+	}
+
+	constexpr float& operator[](int index) {
+		return x[index];
+	}
+
+	constexpr float operator[](int index) const {
+		return x[index];
+	}
+
+	CPPLIB_MATHS_SIMD_CONSTEXPR Matrix3x4 operator *(Matrix3x4 m) const {
+		Matrix3x4 result;
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			// Result row i is a combination of m's rows weighted by this matrix's row i, plus translation.
+			__m128 r0 = _mm_loadu_ps(&m.x[0]);
+			__m128 r1 = _mm_loadu_ps(&m.x[4]);
+			__m128 r2 = _mm_loadu_ps(&m.x[8]);
+			__m128 w_mask = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+			for(int i = 0; i < 12; i += 4) {
+				__m128 a = _mm_loadu_ps(&x[i]);
+				__m128 r = CPPLIB_MATHS_MADD(r0, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), _mm_and_ps(a, w_mask));
+				r = CPPLIB_MATHS_MADD(r1, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), r);
+				r = CPPLIB_MATHS_MADD(r2, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), r);
+				_mm_storeu_ps(&result.x[i], r);
+			}
+			return result;
+		}
+#endif
+		for(int i = 0; i < 12; i += 4) {
+			result[i + 0] = x[i] * m[0] + x[i + 1] * m[4] + x[i + 2] * m[8];
+			result[i + 1] = x[i] * m[1] + x[i + 1] * m[5] + x[i + 2] * m[9];
+			result[i + 2] = x[i] * m[2] + x[i + 1] * m[6] + x[i + 2] * m[10];
+			result[i + 3] = x[i] * m[3] + x[i + 1] * m[7] + x[i + 2] * m[11] + x[i + 3];
+		}
+		return result;
+	}
+
+	CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 operator *(Vector4 v) const {
 		Vector4 result;
-		result[0] = x[0] * v[0] + x[4] * v[1] + x[8] * v[2] + x[12] * v[3];
-		result[1] = x[1] * v[0] + x[5] * v[1] + x[9] * v[2] + x[13] * v[3];
-		result[2] = x[2] * v[0] + x[6] * v[1] + x[10] * v[2] + x[14] * v[3];
-		result[3] = x[3] * v[0] + x[7] * v[1] + x[11] * v[2] + x[15] * v[3];
+#ifdef CPPLIB_MATHS_SSE
+		if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+			__m128 b = _mm_loadu_ps(v.v);
+			__m128 p0 = _mm_mul_ps(_mm_loadu_ps(&x[0]), b);
+			__m128 p1 = _mm_mul_ps(_mm_loadu_ps(&x[4]), b);
+			__m128 p2 = _mm_mul_ps(_mm_loadu_ps(&x[8]), b);
+			// Bottom row (0, 0, 0, 1) keeps w, then transposing and adding sums each row's products.
+			__m128 p3 = _mm_and_ps(b, _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1)));
+			_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+			_mm_storeu_ps(result.v, _mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)));
+			return result;
+		}
+#endif
+		result.x = x[0] * v.x + x[1] * v.y + x[2] * v.z + x[3] * v.w;
+		result.y = x[4] * v.x + x[5] * v.y + x[6] * v.z + x[7] * v.w;
+		result.z = x[8] * v.x + x[9] * v.y + x[10] * v.z + x[11] * v.w;
+		result.w = v.w;
 		return result;
 	}
 };
 
+// Rigid transform (rotation and translation, no scale) as a unit quaternion pair, 32 bytes. `real` is the
+// rotation, `dual` is 0.5 * translation * real. Unlike matrices, dual quaternions can be blended
+// (math::nlerp) without shearing, which is what skinning with several bones per vertex needs.
+struct DualQuaternion {
+	Quaternion real;
+	Quaternion dual;
+
+	constexpr DualQuaternion() :
+		real(0, 0, 0, 1), dual(0, 0, 0, 0) {
+
+	}
+
+	constexpr DualQuaternion(Quaternion real, Quaternion dual) :
+		real(real), dual(dual) {
+
+	}
+
+	// Same order as matrices, (a * b) applies b first.
+	DualQuaternion operator *(DualQuaternion q) const;
+};
+
+// Axis aligned box, `extents` are half of the box size along each axis.
+struct AABB {
+	Vector3 center;
+	Vector3 extents;
+};
+
+struct Sphere {
+	Vector3 center;
+	float radius;
+};
+
+// Points p with dot(normal, p) + distance >= 0 are in front of the plane, same as in math::ray_plane_intersection.
+struct Plane {
+	Vector3 normal;
+	float distance;
+};
+
+// Planes face inside, in order left, right, bottom, top, near, far.
+struct Frustum {
+	Plane planes[6];
+};
+
 namespace math {
 	const float PIHALF = 1.57079633f;
 	const float PI     = 3.14159265f;
@@ -465,31 +717,116 @@ namespace math {
 
 	Vector3 polar_to_cartesian(float azimuth, float polar, float radius = 1.0f);
 
-	Matrix4x4 get_identity();
-	Matrix4x4 get_translation(Vector3 v);
-	Matrix4x4 get_translation(float x, float y, float z);
-	Matrix4x4 get_scale(float scale);
-	Matrix4x4 get_scale(float s_x, float s_y, float s_z);
-	Matrix4x4 get_scale(Vector3 scale);
+	// constexpr functions are defined at the end of this file, so they can be used in constant expressions.
+	constexpr Matrix4x4 get_identity();
+	constexpr Matrix4x4 get_translation(Vector3 v);
+	constexpr Matrix4x4 get_translation(float x, float y, float z);
+	constexpr Matrix4x4 get_scale(float scale);
+	constexpr Matrix4x4 get_scale(float s_x, float s_y, float s_z);
+	constexpr Matrix4x4 get_scale(Vector3 scale);
 	Matrix4x4 get_rotation(float angle, Vector3 axis);
 	Matrix4x4 get_rotation(Quaternion q);
 
 	Matrix4x4 invert(Matrix4x4 m);
-	Matrix4x4 transpose(Matrix4x4 m);
+	CPPLIB_MATHS_SIMD_CONSTEXPR Matrix4x4 transpose(Matrix4x4 m);
+
+	// Hamilton product, (a * b) rotates by b first.
+	Quaternion quaternion_multiply(Quaternion a, Quaternion b);
+	// Rotation part of a matrix without scale.
+	Quaternion get_quaternion(Matrix3x4 m);
+
+	Matrix3x4 get_matrix3x4(Matrix4x4 m);
+	Matrix3x4 get_matrix3x4(Vector3 translation, Quaternion rotation, Vector3 scale = Vector3(1, 1, 1));
+	// Expects a normalized dual quaternion.
+	Matrix3x4 get_matrix3x4(DualQuaternion q);
+	Matrix4x4 get_matrix4x4(Matrix3x4 m);
+	// Inverse of the 3x3 part and its translation, takes about 2/3 of the time of inverting a Matrix4x4.
+	// Returns identity for singular matrices.
+	Matrix3x4 invert(Matrix3x4 m);
+	Vector3 transform_point(Matrix3x4 m, Vector3 p);
+	Vector3 transform_direction(Matrix3x4 m, Vector3 d);
+
+	DualQuaternion get_dual_quaternion(Quaternion rotation, Vector3 translation);
+	// Only rotation and translation are kept, scale and shear are lost.
+	DualQuaternion get_dual_quaternion(Matrix3x4 m);
+	Vector3 get_translation(DualQuaternion q);
+	DualQuaternion normalize(DualQuaternion q);
+	// Inverse of a normalized dual quaternion.
+	DualQuaternion conjugate(DualQuaternion q);
+	// Blends along the shortest path and renormalizes.
+	DualQuaternion nlerp(DualQuaternion q1, DualQuaternion q2, float x);
+	Vector3 transform_point(DualQuaternion q, Vector3 p);
+
+	// Batch versions of the operations above, processing whole arrays with SIMD. `out` can be the same
+	// array as the input. Vector3 points are transformed as (x, y, z, 1), directions as (x, y, z, 0),
+	// there's no perspective divide. If CPPLIB_MATHS_JOBS is defined when compiling maths.cpp, large arrays
+	// are split over job system threads (see jobs.h).
+	void transform_points(Matrix4x4 m, const Vector4 *in, Vector4 *out, uint32_t count);
+	void transform_points(Matrix4x4 m, const Vector3 *in, Vector3 *out, uint32_t count);
+	void transform_directions(Matrix4x4 m, const Vector3 *in, Vector3 *out, uint32_t count);
+	void normalize(const Vector3 *in, Vector3 *out, uint32_t count);
+	void dot(const Vector3 *a, const Vector3 *b, float *out, uint32_t count);
+	void cross(const Vector3 *a, const Vector3 *b, Vector3 *out, uint32_t count);
 #undef near
 #undef far
 
 	// NOTE: This matrix is for RH systems and near/far are reverted with respect to RH system. E.g. passing -near produces z value of 0;
 	Matrix4x4 get_perspective_projection_dx_rh(float fov, float aspectRatio, float near, float far);
-	Matrix4x4 get_orthographics_projection_dx_rh(float left, float right, float bottom, float top, float near, float far);
-	Matrix4x4 get_orthographics_projection_vk_rh(float left, float right, float bottom, float top, float near, float far);
+	constexpr Matrix4x4 get_orthographics_projection_dx_rh(float left, float right, float bottom, float top, float near, float far);
+	constexpr Matrix4x4 get_orthographics_projection_vk_rh(float left, float right, float bottom, float top, float near, float far);
 
 	Matrix4x4 get_look_at(Vector3 eye, Vector3 target, Vector3 up);
 
 	float ray_plane_intersection(Vector3 ray_origin, Vector3 ray_direction, Vector3 plane_normal, float plane_distance);
 	float ray_box_intersection(Vector3 ray_origin, Vector3 ray_direction, Vector3 box_position,
 							   Vector3 x_axis, Vector3 y_axis, Vector3 z_axis);
-
+	// Distance along the ray (in units of `ray_direction` length) where it enters the box, 0 if the ray
+	// starts inside, -1 if the box is missed.
+	float ray_aabb_intersection(Vector3 ray_origin, Vector3 ray_direction, AABB box);
+	// Distance along the ray to a double-sided triangle, -1 if it's missed.
+	float ray_triangle_intersection(Vector3 ray_origin, Vector3 ray_direction, Vector3 a, Vector3 b, Vector3 c);
+
+	AABB get_aabb(const Vector3 *points, uint32_t count);
+	// Smallest AABB containing the transformed box.
+	AABB transform(Matrix4x4 m, AABB box);
+	// Frustum of a projection * view matrix, e.g. get_perspective_projection_dx_rh(...) * get_look_at(...).
+	// Expects clip space depth in [0, w] like the projections above. Plane normals are normalized.
+	Frustum get_frustum(Matrix4x4 projection_view);
+	// Conservative tests, volumes outside the frustum but not completely behind any of its planes (near
+	// the frustum's edges) are reported as intersecting.
+	bool intersects(Frustum frustum, AABB box);
+	bool intersects(Frustum frustum, Sphere sphere);
+	// Batch versions of the tests above. Bit i % 32 of `visible[i / 32]` is set if volume i intersects the
+	// frustum, `visible` has to hold (count + 31) / 32 words and unused bits of the last word are cleared.
+	void cull(Frustum frustum, const AABB *boxes, uint32_t count, uint32_t *visible);
+	void cull(Frustum frustum, const Sphere *spheres, uint32_t count, uint32_t *visible);
+
+	// Polynomial approximations of the libm based functions above, in two accuracy tiers. Maximum
+	// absolute errors (relative for pow) measured by tests/maths_test.cpp:
+	//             sin/cos    atan2     acos      pow
+	//   FAST      1e-4       1e-4      7e-5      2e-4 * max(1, |e|) * max(1, |log2(x)|)
+	//   HIGH      3e-7       5e-7      5e-7      3e-7 * max(1, |e|) * max(1, |log2(x)|)
+	// sin and cos lose precision for |x| > 1e4, like any float range reduction. pow expects x >= 0, x^0 is 1.
+	// Array versions compute 4 (SSE) or 8 (AVX2) values at once, `out` can be the same as the input.
+	enum Accuracy {
+		ACCURACY_FAST,
+		ACCURACY_HIGH,
+	};
+	float sin_approx(float x, Accuracy accuracy = ACCURACY_HIGH);
+	float cos_approx(float x, Accuracy accuracy = ACCURACY_HIGH);
+	float atan2_approx(float y, float x, Accuracy accuracy = ACCURACY_HIGH);
+	float acos_approx(float x, Accuracy accuracy = ACCURACY_HIGH);
+	float pow_approx(float x, float e, Accuracy accuracy = ACCURACY_HIGH);
+	void sin_approx(const float *x, float *out, uint32_t count, Accuracy accuracy = ACCURACY_HIGH);
+	void cos_approx(const float *x, float *out, uint32_t count, Accuracy accuracy = ACCURACY_HIGH);
+	void atan2_approx(const float *y, const float *x, float *out, uint32_t count, Accuracy accuracy = ACCURACY_HIGH);
+	void acos_approx(const float *x, float *out, uint32_t count, Accuracy accuracy = ACCURACY_HIGH);
+	void pow_approx(const float *x, const float *e, float *out, uint32_t count, Accuracy accuracy = ACCURACY_HIGH);
+
+	// Random numbers come from a xoshiro128** generator owned by the calling thread. Threads are seeded
+	// in the order they first use it, so single threaded programs get the same sequence on every run.
+	void random_seed(uint64_t seed);
+	uint32_t random_uint32();
 	float random_uniform(float low = 0.0f, float high = 1.0f);
 	int random_uniform_int(int low = 0, int high = 2);
 	// Azimuth: 0 at +x axis in right handed system
@@ -497,6 +834,130 @@ namespace math {
 	// Polar: 0 at the top
 	Vector3 random_uniform_unit_sphere();
 	Vector3 random_uniform_unit_hemisphere();
+
+	// Fill arrays with `count` samples from the distributions above, using SIMD where available.
+	void random_uniform_n(float *out, uint32_t count, float low = 0.0f, float high = 1.0f);
+	void random_uniform_int_n(int *out, uint32_t count, int low = 0, int high = 2);
+	void random_uniform_unit_sphere_n(Vector3 *out, uint32_t count);
+	void random_uniform_unit_hemisphere_n(Vector3 *out, uint32_t count);
+}
+
+constexpr Matrix4x4 math::get_identity() {
+	Matrix4x4 result = {};
+
+	result[0] = result[5] = result[10] = result[15] = 1;
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_translation(Vector3 v) {
+	Matrix4x4 result = get_translation(v.x, v.y, v.z);
+	return result;
+}
+
+constexpr Matrix4x4 math::get_translation(float x, float y, float z) {
+	Matrix4x4 result = {};
+
+	result[0] = 1;
+	result[5] = 1;
+	result[10] = 1;
+	result[12] = x;
+	result[13] = y;
+	result[14] = z;
+	result[15] = 1;
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_scale(float scale) {
+	Matrix4x4 result = {};
+
+	result[0] = result[5] = result[10] = scale;
+	result[15] = 1;
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_scale(float s_x, float s_y, float s_z) {
+	Matrix4x4 result = {};
+
+	result[0] = s_x;
+	result[5] = s_y;
+	result[10] = s_z;
+	result[15] = 1;
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_scale(Vector3 scale) {
+	return math::get_scale(scale.x, scale.y, scale.z);
+}
+
+CPPLIB_MATHS_SIMD_CONSTEXPR Matrix4x4 math::transpose(Matrix4x4 m) {
+	Matrix4x4 result = {};
+#ifdef CPPLIB_MATHS_SSE
+	if(!CPPLIB_MATHS_CONSTANT_EVALUATED()) {
+		__m128 c0 = _mm_loadu_ps(&m.x[0]);
+		__m128 c1 = _mm_loadu_ps(&m.x[4]);
+		__m128 c2 = _mm_loadu_ps(&m.x[8]);
+		__m128 c3 = _mm_loadu_ps(&m.x[12]);
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&result.x[0], c0);
+		_mm_storeu_ps(&result.x[4], c1);
+		_mm_storeu_ps(&result.x[8], c2);
+		_mm_storeu_ps(&result.x[12], c3);
+		return result;
+	}
+#endif
+	result[0]  = m[0];
+	result[1]  = m[4];
+	result[2]  = m[8];
+	result[3]  = m[12];
+
+	result[4]  = m[1];
+	result[5]  = m[5];
+	result[6]  = m[9];
+	result[7]  = m[13];
+
+	result[8]  = m[2];
+	result[9]  = m[6];
+	result[10] = m[10];
+	result[11] = m[14];
+
+	result[12] = m[3];
+	result[13] = m[7];
+	result[14] = m[11];
+	result[15] = m[15];
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_orthographics_projection_dx_rh(float left, float right, float bottom, float top, float near, float far) {
+	Matrix4x4 result;
+
+	result[0] = 2.0f / (right - left);
+	result[5] = 2.0f / (top - bottom);
+	result[10] = 1.0f / (far - near);
+	result[12] = -(right + left) / (right - left);
+	result[13] = -(top + bottom) / (top - bottom);
+	result[14] = -(near) / (far - near);
+	result[15] = 1;
+
+	return result;
+}
+
+constexpr Matrix4x4 math::get_orthographics_projection_vk_rh(float left, float right, float bottom, float top, float near, float far) {
+	Matrix4x4 result;
+
+	result[0] = 2.0f / (right - left);
+	result[5] = 2.0f / (bottom - top);
+	result[10] = 2.0f / (far - near);
+	result[12] = -(right + left) / (right - left);
+	result[13] = -(top + bottom) / (bottom - top);
+	result[14] = -(far + near) / (far - near);
+	result[15] = 1;
+
+	return result;
 }
 
 #ifdef CPPLIB_MATHS_IMPL
@@ -1,5 +1,47 @@
 #include "memory.h"
 #include <cstring>
+#include <atomic>
+#ifdef DEBUG
+#include <stdio.h>
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+/*
+
+Platform-specific virtual memory functions used by StackAllocator.
+
+*/
+
+void *reserve_pages(uint32_t size) {
+#ifdef _WIN32
+    void *result = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *result = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(result == MAP_FAILED) result = NULL;
+#endif
+    return result;
+}
+
+bool commit_pages(void *ptr, uint32_t size) {
+#ifdef _WIN32
+    bool result = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    bool result = mprotect(ptr, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+    return result;
+}
+
+void release_pages(void *ptr, uint32_t size) {
+#ifdef _WIN32
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
 
 struct Stack {
     StackAllocatorState *data;
@@ -60,12 +102,121 @@ namespace stack {
     }
 }
 
-StackAllocator allocator_temp = memory::get_stack_allocator(MEGABYTES(10));
-Stack temp_state_stack = stack::get(10);
 
-StackAllocator memory::get_stack_allocator(uint32_t size) {
+/*
+
+Allocation tracking section.
+
+*/
+
+struct MemoryCounters {
+    std::atomic<uint64_t> heap_alloc_count;
+    std::atomic<uint64_t> heap_alloc_bytes;
+    std::atomic<uint64_t> heap_free_count;
+    std::atomic<uint64_t> array_grow_count;
+    std::atomic<uint64_t> hot_alloc_count;
+    std::atomic<uint32_t> stack_high_water;
+};
+
+MemoryCounters memory_counters[MEMORY_TAG_COUNT];
+
+const char *memory_tag_names[] = {
+    "GENERAL",
+    "TEMP",
+    "RESOURCES",
+    "UI",
+    "ANIMATION",
+    "FONT",
+    "BVH",
+    "SENCHA",
+};
+
+thread_local const char *hot_scope_name = NULL;
+thread_local int hot_scope_depth = 0;
+
+void memory::track_heap_alloc(MemoryTag tag, uint64_t bytes) {
+    MemoryCounters *counters = &memory_counters[tag];
+    counters->heap_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    counters->heap_alloc_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    if(hot_scope_depth > 0) {
+        counters->hot_alloc_count.fetch_add(1, std::memory_order_relaxed);
+#ifdef DEBUG
+        printf("Heap allocation of %llu bytes (%s) inside hot scope %s\n",
+               (unsigned long long)bytes, memory_tag_names[tag], hot_scope_name);
+#endif
+    }
+}
+
+void memory::track_heap_free(MemoryTag tag) {
+    memory_counters[tag].heap_free_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void memory::track_array_growth(MemoryTag tag) {
+    memory_counters[tag].array_grow_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void track_stack_high_water(MemoryTag tag, uint32_t high_water) {
+    std::atomic<uint32_t> *tracked = &memory_counters[tag].stack_high_water;
+    uint32_t current = tracked->load(std::memory_order_relaxed);
+    while(current < high_water && !tracked->compare_exchange_weak(current, high_water, std::memory_order_relaxed)) {
+    }
+}
+
+MemoryStats memory::get_stats(MemoryTag tag) {
+    MemoryCounters *counters = &memory_counters[tag];
+    MemoryStats stats = {};
+    stats.heap_alloc_count = counters->heap_alloc_count.load(std::memory_order_relaxed);
+    stats.heap_alloc_bytes = counters->heap_alloc_bytes.load(std::memory_order_relaxed);
+    stats.heap_free_count = counters->heap_free_count.load(std::memory_order_relaxed);
+    stats.array_grow_count = counters->array_grow_count.load(std::memory_order_relaxed);
+    stats.hot_alloc_count = counters->hot_alloc_count.load(std::memory_order_relaxed);
+    stats.stack_high_water = counters->stack_high_water.load(std::memory_order_relaxed);
+    return stats;
+}
+
+const char *memory::get_tag_name(MemoryTag tag) {
+    return memory_tag_names[tag];
+}
+
+void memory::reset_stats() {
+    for(int i = 0; i < MEMORY_TAG_COUNT; ++i) {
+        MemoryCounters *counters = &memory_counters[i];
+        counters->heap_alloc_count = 0;
+        counters->heap_alloc_bytes = 0;
+        counters->heap_free_count = 0;
+        counters->array_grow_count = 0;
+        counters->hot_alloc_count = 0;
+        counters->stack_high_water = 0;
+    }
+}
+
+void memory::begin_hot_scope(const char *name) {
+    // Nested scopes keep the outermost name.
+    if(hot_scope_depth++ == 0) {
+        hot_scope_name = name;
+    }
+}
+
+void memory::end_hot_scope() {
+    if(--hot_scope_depth == 0) {
+        hot_scope_name = NULL;
+    }
+}
+
+bool memory::is_in_hot_scope() {
+    return hot_scope_depth > 0;
+}
+
+/*
+
+StackAllocator section.
+
+*/
+
+StackAllocator memory::get_stack_allocator(uint32_t size, MemoryTag tag) {
     StackAllocator allocator = {};
-    allocator.storage = malloc(size);
+    allocator.tag = tag;
+    allocator.storage = reserve_pages(size);
     if(!allocator.storage) {
         return allocator;
     }
@@ -73,6 +224,49 @@ StackAllocator memory::get_stack_allocator(uint32_t size) {
     return allocator;
 }
 
+void memory::release_stack_allocator(StackAllocator *allocator) {
+    if(allocator->storage) {
+        release_pages(allocator->storage, allocator->size);
+    }
+    *allocator = StackAllocator{};
+}
+
+void *memory::alloc_stack_bytes(StackAllocator *allocator, uint64_t bytes, uint32_t alignment) {
+    // Alignment has to be a power of 2.
+    uintptr_t base = (uintptr_t)allocator->storage;
+    uintptr_t aligned = (base + allocator->top + (alignment - 1)) & ~(uintptr_t)(alignment - 1);
+    uint64_t start = aligned - base;
+    uint64_t new_top = start + bytes;
+    if(new_top > allocator->size) return NULL;
+
+    // Commit more pages if we're past the committed part of the reserved range.
+    if(new_top > allocator->committed) {
+        uint64_t to_commit = new_top + (stack_commit_granularity - 1);
+        to_commit -= to_commit % stack_commit_granularity;
+        if(to_commit > allocator->size) to_commit = allocator->size;
+
+        char *commit_start = (char *)allocator->storage + allocator->committed;
+        uint32_t commit_size = uint32_t(to_commit - allocator->committed);
+        if(!commit_pages(commit_start, commit_size)) return NULL;
+        allocator->committed = uint32_t(to_commit);
+    }
+
+    allocator->top = uint32_t(new_top);
+    if(allocator->top > allocator->high_water) {
+        allocator->high_water = allocator->top;
+        track_stack_high_water(allocator->tag, allocator->high_water);
+    }
+    return (void *)aligned;
+}
+
+uint32_t memory::get_committed_size(StackAllocator *allocator) {
+    return allocator->committed;
+}
+
+uint32_t memory::get_high_water_mark(StackAllocator *allocator) {
+    return allocator->high_water;
+}
+
 StackAllocatorState memory::save_stack_state(StackAllocator *allocator) {
     return allocator->top;
 }
@@ -81,17 +275,43 @@ void memory::load_stack_state(StackAllocator *allocator, StackAllocatorState sta
     allocator->top = state;
 }
 
+/*
+
+Per-thread temp allocator section.
+
+*/
+
+const uint32_t TEMP_STACK_RESERVE_SIZE = GIGABYTES(1);
+
+// Scratch arena and its saved states, one instance per thread.
+struct TempContext {
+    StackAllocator allocator;
+    Stack state_stack;
+
+    TempContext() {
+        allocator = memory::get_stack_allocator(TEMP_STACK_RESERVE_SIZE, MEMORY_TAG_TEMP);
+        state_stack = stack::get(10);
+    }
+
+    ~TempContext() {
+        memory::release_stack_allocator(&allocator);
+        memory::free_heap(state_stack.data);
+    }
+};
+
+thread_local TempContext temp_context;
+
 StackAllocator *memory::get_temp_stack() {
-    return &allocator_temp;
+    return &temp_context.allocator;
 }
 
 void memory::push_temp_state() {
     StackAllocatorState temp_state = memory::save_stack_state(get_temp_stack());
-    stack::push(&temp_state_stack, temp_state);
+    stack::push(&temp_context.state_stack, temp_state);
 }
 
 void memory::pop_temp_state() {
-    StackAllocatorState temp_state = stack::pop(&temp_state_stack);
+    StackAllocatorState temp_state = stack::pop(&temp_context.state_stack);
     memory::load_stack_state(memory::get_temp_stack(), temp_state);
 }
 
@@ -99,6 +319,7 @@ void memory::free_temp() {
     memory::get_temp_stack()->top = 0;
 }
 
-void memory::free_heap(void *ptr) {
+void memory::free_heap(void *ptr, MemoryTag tag) {
+    memory::track_heap_free(tag);
     free(ptr);
 }
@@ -1,41 +1,107 @@
 #pragma once
 #include <stdint.h>
 #include <cstdlib>
+#include <string.h>
 
 #define KILOBYTES(kB) (kB * 1024)
 #define MEGABYTES(mB) (mB * 1024 * 1024)
+#define GIGABYTES(gB) (gB * 1024u * 1024u * 1024u)
 
+// Subsystem tags used to attribute allocations in memory stats.
+enum MemoryTag {
+    MEMORY_TAG_GENERAL,
+    MEMORY_TAG_TEMP,
+    MEMORY_TAG_RESOURCES,
+    MEMORY_TAG_UI,
+    MEMORY_TAG_ANIMATION,
+    MEMORY_TAG_FONT,
+    MEMORY_TAG_BVH,
+    MEMORY_TAG_SENCHA,
+    MEMORY_TAG_COUNT
+};
+
+// Snapshot of allocation counters for a single MemoryTag.
+struct MemoryStats {
+    uint64_t heap_alloc_count;
+    uint64_t heap_alloc_bytes;
+    uint64_t heap_free_count;
+    uint64_t array_grow_count;
+    // Allocations made while inside a HotScope, should stay 0 in steady state.
+    uint64_t hot_alloc_count;
+    uint32_t stack_high_water;
+};
+
+// StackAllocator is a linear arena on top of a reserved virtual address range.
+// Only `committed` bytes are backed by physical memory, more pages get committed
+// on demand as `top` grows, so the arena never moves and pointers stay valid.
 struct StackAllocator {
     void *storage;
     uint32_t size;
     uint32_t top = 0;
+    uint32_t committed = 0;
+    uint32_t high_water = 0;
+    MemoryTag tag = MEMORY_TAG_GENERAL;
 };
 
 typedef uint32_t StackAllocatorState;
 
-extern StackAllocator allocator_temp;
-
 namespace memory {
+    // Granularity in which StackAllocator commits its reserved pages.
+    const uint32_t stack_commit_granularity = KILOBYTES(64);
+
+    // Allocation tracking, counters are kept per MemoryTag and are safe to update from any thread.
+    void track_heap_alloc(MemoryTag tag, uint64_t bytes);
+    void track_heap_free(MemoryTag tag);
+    void track_array_growth(MemoryTag tag);
+    MemoryStats get_stats(MemoryTag tag);
+    const char *get_tag_name(MemoryTag tag);
+    void reset_stats();
+
+    // Hot scopes mark code which is expected to never touch the heap. In DEBUG builds
+    // every heap allocation inside a hot scope is reported.
+    void begin_hot_scope(const char *name);
+    void end_hot_scope();
+    bool is_in_hot_scope();
+
     template <typename T>
-    T *alloc_heap(uint32_t count) {
+    T *alloc_heap(uint32_t count, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        memory::track_heap_alloc(tag, uint64_t(count) * sizeof(T));
         T *mem = (T *)malloc(count * sizeof(T));
         return mem;
     }
 
-    void free_heap(void *ptr);
+    // Resize heap block, possibly in place. Counted as a heap allocation.
+    template <typename T>
+    T *realloc_heap(T *ptr, uint32_t count, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        memory::track_heap_alloc(tag, uint64_t(count) * sizeof(T));
+        T *mem = (T *)realloc(ptr, count * sizeof(T));
+        return mem;
+    }
+
+    void free_heap(void *ptr, MemoryTag tag = MEMORY_TAG_GENERAL);
 
-    StackAllocator get_stack_allocator(uint32_t size);
+    // Reserve `size` bytes of address space, nothing is committed until used.
+    StackAllocator get_stack_allocator(uint32_t size, MemoryTag tag = MEMORY_TAG_GENERAL);
+    void release_stack_allocator(StackAllocator *allocator);
     StackAllocatorState save_stack_state(StackAllocator *allocator);
     void load_stack_state(StackAllocator *allocator, StackAllocatorState state);
 
+    // Returns NULL if the reserved range is exhausted or pages could not be committed. `bytes` is 64-bit,
+    // so element counts multiplied by large types can't wrap into a small allocation.
+    void *alloc_stack_bytes(StackAllocator *allocator, uint64_t bytes, uint32_t alignment);
+
     template <typename T>
-    T *alloc_stack(StackAllocator *allocator, uint32_t count) {
-        T *result = (T *)((char *)allocator->storage + allocator->top);
-        if(allocator->top + count > allocator->size) return NULL; 
-        allocator->top += count * sizeof(T);
-        return result;
+    T *alloc_stack(StackAllocator *allocator, uint32_t count, uint32_t alignment = alignof(T)) {
+        return (T *)memory::alloc_stack_bytes(allocator, uint64_t(count) * sizeof(T), alignment);
     }
 
+    // Bytes currently backed by physical memory.
+    uint32_t get_committed_size(StackAllocator *allocator);
+    // Largest `top` the allocator has reached since creation.
+    uint32_t get_high_water_mark(StackAllocator *allocator);
+
+    // Temp allocator and its push/pop state stack are per-thread, each thread
+    // reserves its own scratch arena on first use.
     StackAllocator *get_temp_stack();
 
     void push_temp_state();
@@ -49,6 +115,169 @@ namespace memory {
     void free_temp();
 }
 
+// Pool is a typed fixed-size allocator. All slots live in one reserved address range
+// (committed `chunk_size` slots at a time), so pointers are stable and live items can be
+// iterated by index. Free slots form an intrusive singly linked list.
+template <typename T>
+union PoolSlot {
+    T item;
+    PoolSlot<T> *next_free;
+
+    PoolSlot() {}
+};
+
+template <typename T>
+struct Pool {
+    StackAllocator slot_memory;
+    StackAllocator live_memory;
+    PoolSlot<T> *slots;
+    uint8_t *live;
+    PoolSlot<T> *free_list;
+
+    uint32_t chunk_size;
+    uint32_t max_count;
+    uint32_t capacity;
+    uint32_t live_count;
+
+    // Lifetime counters to make allocation churn visible.
+    uint32_t alloc_count;
+    uint32_t free_count;
+};
+
+struct PoolStats {
+    uint32_t live_count;
+    uint32_t capacity;
+    uint32_t alloc_count;
+    uint32_t free_count;
+    float occupancy;
+};
+
+// `pool` namespace handles operations on Pool.
+namespace pool {
+    // Initialize pool growing by `chunk_size` slots, up to `max_count` slots in total. The last chunk
+    // is clamped, so all `max_count` slots are usable even if it's not a multiple of `chunk_size`.
+    template <typename T>
+    void init(Pool<T> *pool, uint32_t chunk_size, uint32_t max_count) {
+        *pool = Pool<T>{};
+        pool->slot_memory = memory::get_stack_allocator(max_count * sizeof(PoolSlot<T>));
+        pool->live_memory = memory::get_stack_allocator(max_count);
+        pool->slots = (PoolSlot<T> *)pool->slot_memory.storage;
+        pool->live = (uint8_t *)pool->live_memory.storage;
+        pool->chunk_size = chunk_size;
+        pool->max_count = max_count;
+    }
+
+    //  Returns initialized Pool
+    template <typename T>
+    Pool<T> get(uint32_t chunk_size, uint32_t max_count) {
+        Pool<T> pool;
+        pool::init(&pool, chunk_size, max_count);
+        return pool;
+    }
+
+    // Commit another chunk of slots and thread them onto the free list, lowest index first.
+    template <typename T>
+    bool grow(Pool<T> *pool) {
+        uint32_t count = pool->max_count - pool->capacity;
+        if(count == 0) return false;
+        if(count > pool->chunk_size) count = pool->chunk_size;
+
+        StackAllocatorState slot_state = memory::save_stack_state(&pool->slot_memory);
+        PoolSlot<T> *chunk = memory::alloc_stack<PoolSlot<T>>(&pool->slot_memory, count);
+        if(!chunk) return false;
+        uint8_t *chunk_live = memory::alloc_stack<uint8_t>(&pool->live_memory, count);
+        if(!chunk_live) {
+            // Give the slots back, so the pool stays consistent and a later grow can retry.
+            memory::load_stack_state(&pool->slot_memory, slot_state);
+            return false;
+        }
+
+        memset(chunk_live, 0, count);
+        for(uint32_t i = count; i > 0; --i) {
+            chunk[i - 1].next_free = pool->free_list;
+            pool->free_list = &chunk[i - 1];
+        }
+        pool->capacity += count;
+        return true;
+    }
+
+    // Returns uninitialized slot or NULL if the pool reached its maximum size.
+    template <typename T>
+    T *alloc(Pool<T> *pool) {
+        if(!pool->free_list && !pool::grow(pool)) return NULL;
+
+        PoolSlot<T> *slot = pool->free_list;
+        pool->free_list = slot->next_free;
+        pool->live[slot - pool->slots] = 1;
+        pool->live_count++;
+        pool->alloc_count++;
+        return &slot->item;
+    }
+
+    template <typename T>
+    void free(Pool<T> *pool, T *item) {
+        PoolSlot<T> *slot = (PoolSlot<T> *)item;
+        pool->live[slot - pool->slots] = 0;
+        slot->next_free = pool->free_list;
+        pool->free_list = slot;
+        pool->live_count--;
+        pool->free_count++;
+    }
+
+    // Live items can be iterated with `for(i < pool.capacity) if(item = get_item(pool, i))`.
+    template <typename T>
+    T *get_item(Pool<T> *pool, uint32_t index) {
+        if(index >= pool->capacity || !pool->live[index]) return NULL;
+        return &pool->slots[index].item;
+    }
+
+    template <typename T>
+    uint32_t get_index(Pool<T> *pool, T *item) {
+        return uint32_t((PoolSlot<T> *)item - pool->slots);
+    }
+
+    template <typename T>
+    PoolStats get_stats(Pool<T> *pool) {
+        PoolStats stats = {};
+        stats.live_count = pool->live_count;
+        stats.capacity = pool->capacity;
+        stats.alloc_count = pool->alloc_count;
+        stats.free_count = pool->free_count;
+        stats.occupancy = pool->capacity ? float(pool->live_count) / float(pool->capacity) : 0.0f;
+        return stats;
+    }
+
+    // Completely release the pool, freeing all the memory
+    template <typename T>
+    void release(Pool<T> *pool) {
+        memory::release_stack_allocator(&pool->slot_memory);
+        memory::release_stack_allocator(&pool->live_memory);
+        *pool = Pool<T>{};
+    }
+}
+
+// HotScope marks its lifetime as a hot scope, see `memory::begin_hot_scope`.
+struct HotScope {
+    HotScope(const char *name) {
+        memory::begin_hot_scope(name);
+    }
+
+    ~HotScope() {
+        memory::end_hot_scope();
+    }
+};
+
+// TempScope pushes temp state on construction and pops it when it goes out of scope.
+struct TempScope {
+    TempScope() {
+        memory::push_temp_state();
+    }
+
+    ~TempScope() {
+        memory::pop_temp_state();
+    }
+};
+
 #ifdef CPPLIB_MEMORY_IMPL
 #include "memory.cpp"
 #endif
\ No newline at end of file
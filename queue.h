@@ -0,0 +1,255 @@
+#pragma once
+#include <stdint.h>
+#include <cassert>
+#include <atomic>
+#include <new>
+#include "memory.h"
+
+// Bounded lock-free queues for passing data between threads. Capacity is rounded up
+// to power of 2 and items have to be trivially copyable.
+// Queues hold atomics, so they can't be copied; initialize them in place with `queue::init`.
+//
+// Usage:
+// SPSCQueue<Event> events; queue::init(&events, 1024);
+// Producer thread: queue::push(&events, event);
+// Consumer thread: while(queue::pop(&events, &event)) {...}
+
+#define CPPLIB_CACHE_LINE_SIZE 64
+
+// SPSCQueue is a single-producer single-consumer ring buffer. Each side owns its index
+// on a separate cache line and keeps a cached copy of the other side's index, so it only
+// touches the shared line when the cached value says the queue looks full/empty.
+template <typename T>
+struct SPSCQueue {
+    // Producer side.
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<uint32_t> write_index;
+    uint32_t cached_read_index;
+
+    // Consumer side.
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<uint32_t> read_index;
+    uint32_t cached_write_index;
+
+    // Read-only after init.
+    alignas(CPPLIB_CACHE_LINE_SIZE) T *items;
+    uint32_t capacity;
+    MemoryTag tag;
+};
+
+// MPMCQueue is a multi-producer multi-consumer ring buffer (Vyukov's bounded queue).
+// Every cell has a sequence number telling whether it's ready to be written or read.
+template <typename T>
+struct MPMCQueueCell {
+    std::atomic<uint32_t> sequence;
+    T item;
+};
+
+template <typename T>
+struct MPMCQueue {
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<uint32_t> enqueue_index;
+    alignas(CPPLIB_CACHE_LINE_SIZE) std::atomic<uint32_t> dequeue_index;
+    alignas(CPPLIB_CACHE_LINE_SIZE) MPMCQueueCell<T> *cells;
+    uint32_t capacity;
+    MemoryTag tag;
+};
+
+// `queue` namespace handles operations on SPSCQueue and MPMCQueue.
+namespace queue {
+    inline uint32_t round_capacity(uint32_t capacity) {
+        uint32_t result = 2;
+        while(result < capacity) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    /*
+    
+    SPSCQueue.
+
+    */
+
+    template <typename T>
+    void init(SPSCQueue<T> *queue, uint32_t capacity, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        queue->capacity = queue::round_capacity(capacity);
+        queue->tag = tag;
+        queue->items = memory::alloc_heap<T>(queue->capacity, tag);
+        assert(queue->items);
+        queue->write_index.store(0, std::memory_order_relaxed);
+        queue->read_index.store(0, std::memory_order_relaxed);
+        queue->cached_read_index = 0;
+        queue->cached_write_index = 0;
+    }
+
+    // Push up to `count` items, returns number of items pushed. Producer thread only.
+    template <typename T>
+    uint32_t push_n(SPSCQueue<T> *queue, const T *items, uint32_t count) {
+        uint32_t write_index = queue->write_index.load(std::memory_order_relaxed);
+        uint32_t free_count = queue->capacity - (write_index - queue->cached_read_index);
+        if(free_count < count) {
+            queue->cached_read_index = queue->read_index.load(std::memory_order_acquire);
+            free_count = queue->capacity - (write_index - queue->cached_read_index);
+            if(free_count < count) count = free_count;
+        }
+
+        uint32_t mask = queue->capacity - 1;
+        for(uint32_t i = 0; i < count; ++i) {
+            queue->items[(write_index + i) & mask] = items[i];
+        }
+        queue->write_index.store(write_index + count, std::memory_order_release);
+        return count;
+    }
+
+    template <typename T>
+    bool push(SPSCQueue<T> *queue, const T &item) {
+        return queue::push_n(queue, &item, 1) == 1;
+    }
+
+    // Pop up to `max_count` items into `items`, returns number of items popped. Consumer thread only.
+    template <typename T>
+    uint32_t pop_n(SPSCQueue<T> *queue, T *items, uint32_t max_count) {
+        uint32_t read_index = queue->read_index.load(std::memory_order_relaxed);
+        uint32_t available = queue->cached_write_index - read_index;
+        if(available < max_count) {
+            queue->cached_write_index = queue->write_index.load(std::memory_order_acquire);
+            available = queue->cached_write_index - read_index;
+        }
+        uint32_t count = available < max_count ? available : max_count;
+
+        uint32_t mask = queue->capacity - 1;
+        for(uint32_t i = 0; i < count; ++i) {
+            items[i] = queue->items[(read_index + i) & mask];
+        }
+        queue->read_index.store(read_index + count, std::memory_order_release);
+        return count;
+    }
+
+    template <typename T>
+    bool pop(SPSCQueue<T> *queue, T *item) {
+        return queue::pop_n(queue, item, 1) == 1;
+    }
+
+    template <typename T>
+    void release(SPSCQueue<T> *queue) {
+        memory::free_heap(queue->items, queue->tag);
+        queue->items = NULL;
+        queue->capacity = 0;
+    }
+
+    /*
+    
+    MPMCQueue.
+
+    */
+
+    template <typename T>
+    void init(MPMCQueue<T> *queue, uint32_t capacity, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        queue->capacity = queue::round_capacity(capacity);
+        queue->tag = tag;
+        queue->cells = memory::alloc_heap<MPMCQueueCell<T>>(queue->capacity, tag);
+        assert(queue->cells);
+        for(uint32_t i = 0; i < queue->capacity; ++i) {
+            new (&queue->cells[i].sequence) std::atomic<uint32_t>(i);
+        }
+        queue->enqueue_index.store(0, std::memory_order_relaxed);
+        queue->dequeue_index.store(0, std::memory_order_relaxed);
+    }
+
+    // Push up to `count` items, returns number of items pushed. A run of consecutive cells
+    // is claimed with a single CAS, so batches cost one contended operation.
+    template <typename T>
+    uint32_t push_n(MPMCQueue<T> *queue, const T *items, uint32_t count) {
+        // Nothing would ever be claimed, so the loop below couldn't tell this apart from contention.
+        if(count == 0) return 0;
+        uint32_t mask = queue->capacity - 1;
+        uint32_t position = queue->enqueue_index.load(std::memory_order_relaxed);
+        uint32_t claimed = 0;
+        while(true) {
+            // Count cells ready for writing starting at `position`.
+            claimed = 0;
+            while(claimed < count) {
+                MPMCQueueCell<T> *cell = &queue->cells[(position + claimed) & mask];
+                uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+                if(int32_t(sequence - (position + claimed)) != 0) break;
+                claimed++;
+            }
+
+            if(claimed == 0) {
+                MPMCQueueCell<T> *cell = &queue->cells[position & mask];
+                uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+                // Queue is full.
+                if(int32_t(sequence - position) < 0) return 0;
+                // Another producer got here first.
+                position = queue->enqueue_index.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if(queue->enqueue_index.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for(uint32_t i = 0; i < claimed; ++i) {
+            MPMCQueueCell<T> *cell = &queue->cells[(position + i) & mask];
+            cell->item = items[i];
+            cell->sequence.store(position + i + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    template <typename T>
+    bool push(MPMCQueue<T> *queue, const T &item) {
+        return queue::push_n(queue, &item, 1) == 1;
+    }
+
+    // Pop up to `max_count` items into `items`, returns number of items popped.
+    template <typename T>
+    uint32_t pop_n(MPMCQueue<T> *queue, T *items, uint32_t max_count) {
+        if(max_count == 0) return 0;
+        uint32_t mask = queue->capacity - 1;
+        uint32_t position = queue->dequeue_index.load(std::memory_order_relaxed);
+        uint32_t claimed = 0;
+        while(true) {
+            // Count cells ready for reading starting at `position`.
+            claimed = 0;
+            while(claimed < max_count) {
+                MPMCQueueCell<T> *cell = &queue->cells[(position + claimed) & mask];
+                uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+                if(int32_t(sequence - (position + claimed + 1)) != 0) break;
+                claimed++;
+            }
+
+            if(claimed == 0) {
+                MPMCQueueCell<T> *cell = &queue->cells[position & mask];
+                uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+                // Queue is empty.
+                if(int32_t(sequence - (position + 1)) < 0) return 0;
+                // Another consumer got here first.
+                position = queue->dequeue_index.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if(queue->dequeue_index.compare_exchange_weak(position, position + claimed, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for(uint32_t i = 0; i < claimed; ++i) {
+            MPMCQueueCell<T> *cell = &queue->cells[(position + i) & mask];
+            items[i] = cell->item;
+            cell->sequence.store(position + i + mask + 1, std::memory_order_release);
+        }
+        return claimed;
+    }
+
+    template <typename T>
+    bool pop(MPMCQueue<T> *queue, T *item) {
+        return queue::pop_n(queue, item, 1) == 1;
+    }
+
+    template <typename T>
+    void release(MPMCQueue<T> *queue) {
+        memory::free_heap(queue->cells, queue->tag);
+        queue->cells = NULL;
+        queue->capacity = 0;
+    }
+}
\ No newline at end of file
@@ -5,6 +5,17 @@
 #include <stdarg.h>
 #include "maths.h"
 #include "sencha.h"
+#ifdef CPPLIB_SENCHA_JOBS
+#include "jobs.h"
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+#define SENCHA_NATIVE_X64
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
 
 /*
 
@@ -139,16 +150,52 @@ Section defining functions for handling SenchaTable variables.
 
 */
 
+// FNV-1a.
+uint32_t hash_name(const char *name, int name_length) {
+    uint32_t hash = 2166136261u;
+    for(int i = 0; i < name_length; ++i) {
+        hash = (hash ^ uint8_t(name[i])) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns slot of the variable, -1 if it doesn't exist.
+int find_variable(SenchaTable *var_table, char *name, int name_length) {
+    if(var_table->slots.capacity == 0) {
+        return -1;
+    }
+    SenchaName key = SenchaName{name, uint32_t(name_length), hash_name(name, name_length)};
+    int32_t *slot = hash_map::find(&var_table->slots, key);
+    return slot ? *slot : -1;
+}
+
+// Adds a variable known not to be in the table, its name is copied so `name` doesn't have to outlive the table.
+int add_variable_(SenchaTable *var_table, char *name, int name_length) {
+    if(var_table->slots.capacity == 0) {
+        hash_map::init(&var_table->slots, 64, MEMORY_TAG_SENCHA);
+        array::init(&var_table->variable_names, 32, MEMORY_TAG_SENCHA);
+        array::init(&var_table->variable_values, 32, MEMORY_TAG_SENCHA);
+    }
+
+    char *data = memory::alloc_heap<char>(name_length + 1, MEMORY_TAG_SENCHA);
+    memcpy(data, name, name_length);
+    data[name_length] = 0;
+    SenchaName interned = SenchaName{data, uint32_t(name_length), hash_name(name, name_length)};
+
+    int slot = int(var_table->variable_values.count);
+    array::add(&var_table->variable_names, interned);
+    array::add(&var_table->variable_values, 0.0f);
+    hash_map::set(&var_table->slots, interned, int32_t(slot));
+    return slot;
+}
+
 bool _get_variable(SenchaTable *var_table, char *name, int name_length, float *value) {
-    for(int i = 0; i < var_table->variable_count; ++i) {
-        int variable_length = int(strlen(var_table->variable_names[i]));
-        if(variable_length == name_length &&
-           strncmp(name, var_table->variable_names[i], name_length) == 0) {
-            *value = var_table->variable_values[i];
-            return true;
-        }
+    int slot = find_variable(var_table, name, name_length);
+    if(slot < 0) {
+        return false;
     }
-    return false;
+    *value = var_table->variable_values[slot];
+    return true;
 }
 
 bool get_variable(SenchaTable *var_table, Token token, float *value) {
@@ -159,21 +206,26 @@ bool sencha::get_variable(SenchaTable *var_table, char *name, float *value) {
     return _get_variable(var_table, name, int(strlen(name)), value);
 }
 
-void set_variable_(SenchaTable *var_table, char *name, int name_length, float value) {
-    // Try to find existing variable with the same name.
-    for(int i = 0; i < var_table->variable_count; ++i) {
-        int variable_length = int(strlen(var_table->variable_names[i]));
-        if(variable_length == name_length &&
-           strncmp(name, var_table->variable_names[i], name_length) == 0) {
-            var_table->variable_values[i] = value;
-            return;
-        }
+int sencha::get_slot(SenchaTable *var_table, char *name) {
+    return find_variable(var_table, name, int(strlen(name)));
+}
+
+int sencha::add_variable(SenchaTable *var_table, char *name) {
+    int name_length = int(strlen(name));
+    int slot = find_variable(var_table, name, name_length);
+    if(slot < 0) {
+        slot = add_variable_(var_table, name, name_length);
     }
+    return slot;
+}
 
-    // Create new variable entry.
-    memcpy(var_table->variable_names[var_table->variable_count], name, name_length);
-    var_table->variable_names[var_table->variable_count][name_length] = 0;
-    var_table->variable_values[var_table->variable_count++] = value;
+int set_variable_(SenchaTable *var_table, char *name, int name_length, float value) {
+    int slot = find_variable(var_table, name, name_length);
+    if(slot < 0) {
+        slot = add_variable_(var_table, name, name_length);
+    }
+    var_table->variable_values[slot] = value;
+    return slot;
 }
 
 void add_or_set_variable(SenchaTable *var_table, Token token, float value) {
@@ -184,6 +236,142 @@ void sencha::add_or_set_variable(SenchaTable *var_table, char *name, float value
     set_variable_(var_table, name, int(strlen(name)), value);
 }
 
+void sencha::release(SenchaTable *var_table) {
+    for(uint32_t i = 0; i < var_table->variable_names.count; ++i) {
+        memory::free_heap((void *)var_table->variable_names[i].data, MEMORY_TAG_SENCHA);
+    }
+    if(var_table->slots.capacity > 0) {
+        hash_map::release(&var_table->slots);
+        array::release(&var_table->variable_names);
+        array::release(&var_table->variable_values);
+    }
+    *var_table = SenchaTable{};
+}
+
+/*
+
+Function registry section. Calls are resolved by name when a line is parsed or compiled, compiled lines refer to
+functions by their index in the registry, which only grows.
+
+*/
+
+struct SenchaFunction {
+    char *name;
+    int name_length;
+    // SENCHA_OP_SIN and SENCHA_OP_COS have their own opcodes, everything else is SENCHA_OP_CALL.
+    SenchaOpcode opcode;
+    int argument_count;
+    // Only the one matching `argument_count` is set. Not a union, so the builtin table below can be constant
+    // initialized.
+    SenchaFunction1 function1;
+    SenchaFunction2 function2;
+    SenchaFunction3 function3;
+};
+
+float sencha_smoothstep(float edge0, float edge1, float x) {
+    float t = math::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Gradient in [-1, 1] for lattice point `i`.
+float sencha_noise_gradient(int32_t i) {
+    uint32_t hash = uint32_t(i) * 0x27D4EB2Du;
+    hash = (hash ^ (hash >> 15)) * 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    return float(hash & 0xFFFF) / 32767.5f - 1.0f;
+}
+
+// 1D gradient noise, 0 at integers and within [-0.5, 0.5].
+float sencha_noise(float x) {
+    float cell = math::floor(x);
+    float f = x - cell;
+    int32_t i = int32_t(cell);
+    float t = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+    return math::lerp(sencha_noise_gradient(i) * f, sencha_noise_gradient(i + 1) * (f - 1.0f), t);
+}
+
+// Builtins are constant initialized, so compiling on several threads never writes to the registry. Only
+// sencha::register_function does, which has to happen before lines using the function are compiled.
+SenchaFunction sencha_functions[SENCHA_MAX_FUNCTIONS] = {
+    {"sin", 3, SENCHA_OP_SIN, 1, math::sin, nullptr, nullptr},
+    {"cos", 3, SENCHA_OP_COS, 1, math::cos, nullptr, nullptr},
+    {"abs", 3, SENCHA_OP_CALL, 1, (SenchaFunction1)math::abs, nullptr, nullptr},
+    {"floor", 5, SENCHA_OP_CALL, 1, math::floor, nullptr, nullptr},
+    {"noise", 5, SENCHA_OP_CALL, 1, sencha_noise, nullptr, nullptr},
+    {"min", 3, SENCHA_OP_CALL, 2, nullptr, (SenchaFunction2)math::min, nullptr},
+    {"max", 3, SENCHA_OP_CALL, 2, nullptr, (SenchaFunction2)math::max, nullptr},
+    {"pow", 3, SENCHA_OP_CALL, 2, nullptr, math::pow, nullptr},
+    {"clamp", 5, SENCHA_OP_CALL, 3, nullptr, nullptr, math::clamp<float>},
+    {"lerp", 4, SENCHA_OP_CALL, 3, nullptr, nullptr, (SenchaFunction3)math::lerp},
+    {"smoothstep", 10, SENCHA_OP_CALL, 3, nullptr, nullptr, sencha_smoothstep},
+};
+// Number of builtins in the table above.
+int sencha_function_count = 11;
+
+void add_function_(char *name, int argument_count, SenchaFunction function) {
+    function.name = name;
+    function.name_length = int(strlen(name));
+    function.opcode = SENCHA_OP_CALL;
+    function.argument_count = argument_count;
+    sencha_functions[sencha_function_count++] = function;
+}
+
+// Returns index of the function in the registry, -1 if it doesn't exist.
+int find_function(char *name, int name_length) {
+    for(int i = 0; i < sencha_function_count; ++i) {
+        SenchaFunction *function = &sencha_functions[i];
+        if(function->name_length == name_length && strncmp(function->name, name, name_length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Registered functions are checked for name collisions and space first.
+bool can_register_function(char *name) {
+    if(find_function(name, int(strlen(name))) >= 0) {
+        sencha_log_error("Function %s is already registered.", name);
+        return false;
+    }
+    if(sencha_function_count >= SENCHA_MAX_FUNCTIONS) {
+        sencha_log_error("Can't register function %s, at most %d functions are supported.", name, SENCHA_MAX_FUNCTIONS);
+        return false;
+    }
+    return true;
+}
+
+inline float call_function(SenchaFunction *function, float *arguments) {
+    switch(function->argument_count) {
+        case 1: return function->function1(arguments[0]);
+        case 2: return function->function2(arguments[0], arguments[1]);
+        default: return function->function3(arguments[0], arguments[1], arguments[2]);
+    }
+}
+
+bool sencha::register_function(char *name, SenchaFunction1 function) {
+    if(!can_register_function(name)) return false;
+    SenchaFunction registered = {};
+    registered.function1 = function;
+    add_function_(name, 1, registered);
+    return true;
+}
+
+bool sencha::register_function(char *name, SenchaFunction2 function) {
+    if(!can_register_function(name)) return false;
+    SenchaFunction registered = {};
+    registered.function2 = function;
+    add_function_(name, 2, registered);
+    return true;
+}
+
+bool sencha::register_function(char *name, SenchaFunction3 function) {
+    if(!can_register_function(name)) return false;
+    SenchaFunction registered = {};
+    registered.function3 = function;
+    add_function_(name, 3, registered);
+    return true;
+}
+
 /*
 
 Parser section.
@@ -219,30 +407,58 @@ bool parse_expression(Lexer *lexer, Token first_token, float *value, int precend
         else if (first_token.type == SenchaTokenType::IDENTIFIER) {
             Token token = peek_next_token(lexer);
             if(token.type == SenchaTokenType::LEFT_PAREN) {
-                get_next_token(lexer);
-                Token token = get_next_token(lexer);
-                bool success = parse_expression(lexer, token, &val, 0, var_table);
-                if(!success) {
+                int function_index = find_function(first_token.data, first_token.data_size);
+                if(function_index < 0) {
+                    sencha_log_error(
+                        "Unknown function %.*s at col %d.",
+                        first_token.data_size,
+                        first_token.data,
+                        first_token.col
+                    );
                     return false;
                 }
-                token = get_next_token(lexer);
-                if(token.type != SenchaTokenType::RIGHT_PAREN) {
-                    sencha_log_error("Right parenthesis expected at col %d.", first_token.col);
-                    return false;
+                SenchaFunction *function = &sencha_functions[function_index];
+
+                // Arguments separated by commas.
+                get_next_token(lexer);
+                float arguments[SENCHA_MAX_ARGUMENTS];
+                int argument_count = 0;
+                while(true) {
+                    if(argument_count == function->argument_count) {
+                        sencha_log_error(
+                            "Function %.*s takes %d arguments, col %d.",
+                            first_token.data_size,
+                            first_token.data,
+                            function->argument_count,
+                            first_token.col
+                        );
+                        return false;
+                    }
+                    Token token = get_next_token(lexer);
+                    bool success = parse_expression(lexer, token, &arguments[argument_count++], 0, var_table);
+                    if(!success) {
+                        return false;
+                    }
+                    token = get_next_token(lexer);
+                    if(token.type == SenchaTokenType::RIGHT_PAREN) {
+                        break;
+                    }
+                    if(token.type != SenchaTokenType::COMMA) {
+                        sencha_log_error("Right parenthesis expected at col %d.", first_token.col);
+                        return false;
+                    }
                 }
-                if(strncmp(first_token.data, "sin", first_token.data_size) == 0) {
-                    val = math::sin(val);
-                } else if(strncmp(first_token.data, "cos", first_token.data_size) == 0) {
-                    val = math::cos(val);
-                } else {
+                if(argument_count != function->argument_count) {
                     sencha_log_error(
-                        "Unknown function %.*s at col %d.",
+                        "Function %.*s takes %d arguments, col %d.",
                         first_token.data_size,
                         first_token.data,
+                        function->argument_count,
                         first_token.col
                     );
                     return false;
                 }
+                val = call_function(function, arguments);
             } else {
                 bool success = get_variable(var_table, first_token, &val);
                 if(!success) {
@@ -322,7 +538,7 @@ bool parse_expression(Lexer *lexer, Token first_token, float *value, int precend
                 }
                 break;
             }
-        } else if(token.type == SenchaTokenType::RIGHT_PAREN) {
+        } else if(token.type == SenchaTokenType::RIGHT_PAREN || token.type == SenchaTokenType::COMMA) {
             *value = val;
             return true;
         } else {
@@ -362,7 +578,7 @@ bool sencha::parse_line(char *line, SenchaTable *var_table) {
 
     // Assignment.
     Token token = get_next_token(&lexer);
-    if(token.type != SenchaTokenType::OPERATOR && token.data[0] != '=') {
+    if(token.type != SenchaTokenType::OPERATOR || token.data[0] != '=') {
         sencha_log_error(
             "Missing '=' at col %d. Line has to be in a form of assignment statement.",
             first_token.col
@@ -374,8 +590,1364 @@ bool sencha::parse_line(char *line, SenchaTable *var_table) {
     token = get_next_token(&lexer);
     float v = 0.0f;
     bool success = parse_expression(&lexer, token, &v, 0, var_table);
+
+    // Expressions stop at a right parenthesis or comma without consuming it, anything left over is an error.
+    token = get_next_token(&lexer);
+    if(success && token.type != SenchaTokenType::END_OF_FILE && token.type != SenchaTokenType::END_OF_LINE) {
+        sencha_log_error("Unexpected token %.*s at col %d.", token.data_size, token.data, token.col);
+        success = false;
+    }
     if(success) {
         add_or_set_variable(var_table, first_token, v);
     }
     return success;
 }
+
+/*
+
+Compiler section. Grammar and error messages follow the parser above, but instead of computing values
+the compiler emits instructions, which sencha::eval later runs without touching the text.
+
+*/
+
+struct SenchaCompiler {
+    Lexer lexer;
+    SenchaTable *var_table;
+    SenchaExpression *expression;
+    int stack_depth;
+};
+
+// `stack_change` is how many values the instruction pushes minus how many it pops.
+bool emit_instruction(SenchaCompiler *compiler, SenchaInstruction instruction, int stack_change, int col) {
+    SenchaExpression *expression = compiler->expression;
+    if(expression->instruction_count >= SENCHA_MAX_INSTRUCTIONS) {
+        sencha_log_error("Expression is too long at col %d, at most %d instructions are supported.", col, SENCHA_MAX_INSTRUCTIONS);
+        return false;
+    }
+    compiler->stack_depth += stack_change;
+    if(compiler->stack_depth > SENCHA_MAX_STACK_SIZE) {
+        sencha_log_error("Expression is nested too deep at col %d.", col);
+        return false;
+    }
+    if(compiler->stack_depth > expression->stack_size) {
+        expression->stack_size = compiler->stack_depth;
+    }
+    expression->instructions[expression->instruction_count++] = instruction;
+    return true;
+}
+
+bool emit_instruction(SenchaCompiler *compiler, SenchaOpcode opcode, int stack_change, int col) {
+    SenchaInstruction instruction = {};
+    instruction.opcode = opcode;
+    return emit_instruction(compiler, instruction, stack_change, col);
+}
+
+bool compile_expression(SenchaCompiler *compiler, Token first_token, int precedence_level);
+
+// Number, variable, function call or an expression in parentheses.
+bool compile_operand(SenchaCompiler *compiler, Token first_token) {
+    Lexer *lexer = &compiler->lexer;
+    if(first_token.type == SenchaTokenType::END_OF_FILE || first_token.type == SenchaTokenType::END_OF_LINE) {
+        sencha_log_error("Unexpected end of line, col %d.", first_token.col);
+        return false;
+    }
+    if(first_token.type == SenchaTokenType::OPERATOR) {
+        sencha_log_error("Unexpected operator %.*s, col %d.", first_token.data_size, first_token.data, first_token.col);
+        return false;
+    }
+
+    if(first_token.type == SenchaTokenType::LEFT_PAREN) {
+        Token token = get_next_token(lexer);
+        if(!compile_expression(compiler, token, 0)) {
+            return false;
+        }
+        token = get_next_token(lexer);
+        if(token.type != SenchaTokenType::RIGHT_PAREN) {
+            sencha_log_error("Right parenthesis expected at col %d.", first_token.col);
+            return false;
+        }
+        return true;
+    }
+
+    if(first_token.type == SenchaTokenType::NUMBER) {
+        SenchaInstruction instruction = {};
+        instruction.opcode = SENCHA_OP_CONSTANT;
+        instruction.constant = float(atof(first_token.data));
+        return emit_instruction(compiler, instruction, 1, first_token.col);
+    }
+
+    if(first_token.type == SenchaTokenType::IDENTIFIER) {
+        Token token = peek_next_token(lexer);
+        if(token.type == SenchaTokenType::LEFT_PAREN) {
+            // Function call, resolved to an opcode or registry index here so evaluation doesn't compare names.
+            int function_index = find_function(first_token.data, first_token.data_size);
+            if(function_index < 0) {
+                sencha_log_error(
+                    "Unknown function %.*s at col %d.",
+                    first_token.data_size,
+                    first_token.data,
+                    first_token.col
+                );
+                return false;
+            }
+            SenchaFunction *function = &sencha_functions[function_index];
+
+            get_next_token(lexer);
+            int argument_count = 0;
+            while(true) {
+                if(argument_count == function->argument_count) {
+                    sencha_log_error(
+                        "Function %.*s takes %d arguments, col %d.",
+                        first_token.data_size,
+                        first_token.data,
+                        function->argument_count,
+                        first_token.col
+                    );
+                    return false;
+                }
+                token = get_next_token(lexer);
+                if(!compile_expression(compiler, token, 0)) {
+                    return false;
+                }
+                argument_count++;
+                token = get_next_token(lexer);
+                if(token.type == SenchaTokenType::RIGHT_PAREN) {
+                    break;
+                }
+                if(token.type != SenchaTokenType::COMMA) {
+                    sencha_log_error("Right parenthesis expected at col %d.", first_token.col);
+                    return false;
+                }
+            }
+            if(argument_count != function->argument_count) {
+                sencha_log_error(
+                    "Function %.*s takes %d arguments, col %d.",
+                    first_token.data_size,
+                    first_token.data,
+                    function->argument_count,
+                    first_token.col
+                );
+                return false;
+            }
+
+            SenchaInstruction instruction = {};
+            instruction.opcode = function->opcode;
+            if(function->opcode == SENCHA_OP_CALL) {
+                instruction.function = function_index;
+            }
+            return emit_instruction(compiler, instruction, 1 - argument_count, first_token.col);
+        }
+
+        int slot = find_variable(compiler->var_table, first_token.data, first_token.data_size);
+        if(slot < 0) {
+            sencha_log_error(
+                "Undefined variable %.*s at col %d.",
+                first_token.data_size,
+                first_token.data,
+                first_token.col
+            );
+            return false;
+        }
+        SenchaInstruction instruction = {};
+        instruction.opcode = SENCHA_OP_VARIABLE;
+        instruction.slot = slot;
+        return emit_instruction(compiler, instruction, 1, first_token.col);
+    }
+
+    sencha_log_error("Unexpected token %.*s at col %d.", first_token.data_size, first_token.data, first_token.col);
+    return false;
+}
+
+// Compiles operators with precedence higher than `precedence_level` (0 for the whole expression, 1 after
+// + and -, 2 after * and /), operands are emitted before their operator.
+bool compile_expression(SenchaCompiler *compiler, Token first_token, int precedence_level) {
+    Lexer *lexer = &compiler->lexer;
+    if(!compile_operand(compiler, first_token)) {
+        return false;
+    }
+
+    Token token = peek_next_token(lexer);
+    while(token.type != SenchaTokenType::END_OF_FILE && token.type != SenchaTokenType::END_OF_LINE) {
+        if(token.type == SenchaTokenType::RIGHT_PAREN || token.type == SenchaTokenType::COMMA) {
+            return true;
+        }
+        if(token.type != SenchaTokenType::OPERATOR) {
+            sencha_log_error("Unexpected token %.*s at col %d.", token.data_size, token.data, token.col);
+            return false;
+        }
+
+        SenchaOpcode opcode;
+        int operator_precedence;
+        switch(token.data[0]) {
+            case '+': opcode = SENCHA_OP_ADD; operator_precedence = 1; break;
+            case '-': opcode = SENCHA_OP_SUBTRACT; operator_precedence = 1; break;
+            case '*': opcode = SENCHA_OP_MULTIPLY; operator_precedence = 2; break;
+            case '/': opcode = SENCHA_OP_DIVIDE; operator_precedence = 2; break;
+            default:
+                sencha_log_error("Unexpected operator %.*s, col %d.", token.data_size, token.data, token.col);
+                return false;
+        }
+        if(operator_precedence <= precedence_level) {
+            return true;
+        }
+
+        get_next_token(lexer);
+        Token next_token = get_next_token(lexer);
+        if(!compile_expression(compiler, next_token, operator_precedence)) {
+            return false;
+        }
+        if(!emit_instruction(compiler, opcode, -1, token.col)) {
+            return false;
+        }
+        token = peek_next_token(lexer);
+    }
+    return true;
+}
+
+// `line` doesn't have to be NUL terminated, so programs can compile lines in place.
+bool compile_line_(char *line, int length, SenchaTable *var_table, SenchaExpression *expression) {
+    SenchaCompiler compiler = SenchaCompiler{
+        Lexer{line, line, length},
+        var_table,
+        expression,
+        0
+    };
+    expression->instruction_count = 0;
+    expression->stack_size = 0;
+    expression->target_slot = -1;
+
+    // Left hand side.
+    Token first_token = get_next_token(&compiler.lexer);
+    if(first_token.type != SenchaTokenType::IDENTIFIER) {
+        sencha_log_error(
+            "Unexpected token: %.*s, col %d. Line has to start with a variable name.",
+            first_token.data_size,
+            first_token.data,
+            first_token.col
+        );
+        return false;
+    }
+
+    // Assignment.
+    Token token = get_next_token(&compiler.lexer);
+    if(token.type != SenchaTokenType::OPERATOR || token.data[0] != '=') {
+        sencha_log_error(
+            "Missing '=' at col %d. Line has to be in a form of assignment statement.",
+            first_token.col
+        );
+        return false;
+    }
+
+    // Right hand side.
+    token = get_next_token(&compiler.lexer);
+    if(!compile_expression(&compiler, token, 0)) {
+        return false;
+    }
+
+    // A right parenthesis or comma stops the expression without being consumed, anything left over is an error.
+    token = get_next_token(&compiler.lexer);
+    if(token.type != SenchaTokenType::END_OF_FILE && token.type != SenchaTokenType::END_OF_LINE) {
+        sencha_log_error("Unexpected token %.*s at col %d.", token.data_size, token.data, token.col);
+        return false;
+    }
+
+    // Assigned variable is created only for valid lines, same as in parse_line.
+    int slot = find_variable(var_table, first_token.data, first_token.data_size);
+    if(slot < 0) {
+        slot = add_variable_(var_table, first_token.data, first_token.data_size);
+    }
+    expression->target_slot = slot;
+    return true;
+}
+
+bool sencha::compile_line(char *line, SenchaTable *var_table, SenchaExpression *expression) {
+    return compile_line_(line, int(strlen(line)), var_table, expression);
+}
+
+float sencha::eval(SenchaExpression *expression, SenchaTable *var_table) {
+    float stack[SENCHA_MAX_STACK_SIZE];
+    int top = 0;
+    float *values = var_table->variable_values.data;
+    for(int i = 0; i < expression->instruction_count; ++i) {
+        SenchaInstruction instruction = expression->instructions[i];
+        switch(instruction.opcode) {
+            case SENCHA_OP_CONSTANT:
+                stack[top++] = instruction.constant;
+                break;
+            case SENCHA_OP_VARIABLE:
+                stack[top++] = values[instruction.slot];
+                break;
+            case SENCHA_OP_ADD:
+                --top;
+                stack[top - 1] += stack[top];
+                break;
+            case SENCHA_OP_SUBTRACT:
+                --top;
+                stack[top - 1] -= stack[top];
+                break;
+            case SENCHA_OP_MULTIPLY:
+                --top;
+                stack[top - 1] *= stack[top];
+                break;
+            case SENCHA_OP_DIVIDE:
+                --top;
+                stack[top - 1] /= stack[top];
+                break;
+            case SENCHA_OP_SIN:
+                stack[top - 1] = math::sin(stack[top - 1]);
+                break;
+            case SENCHA_OP_COS:
+                stack[top - 1] = math::cos(stack[top - 1]);
+                break;
+            case SENCHA_OP_CALL: {
+                SenchaFunction *function = &sencha_functions[instruction.function];
+                top -= function->argument_count - 1;
+                stack[top - 1] = call_function(function, &stack[top - 1]);
+                break;
+            }
+        }
+    }
+    values[expression->target_slot] = stack[0];
+    return stack[0];
+}
+
+/*
+
+Optimization section. Passes rewrite compiled lines without changing results, operations are done the same way
+sencha::eval does them, just ahead of time.
+
+*/
+
+// Number of values the instruction pops, it then pushes one.
+inline int get_argument_count(SenchaInstruction instruction) {
+    switch(instruction.opcode) {
+        case SENCHA_OP_CONSTANT:
+        case SENCHA_OP_VARIABLE:
+            return 0;
+        case SENCHA_OP_SIN:
+        case SENCHA_OP_COS:
+            return 1;
+        case SENCHA_OP_CALL:
+            return sencha_functions[instruction.function].argument_count;
+        default:
+            return 2;
+    }
+}
+
+int get_stack_size(SenchaExpression *expression) {
+    int depth = 0;
+    int stack_size = 0;
+    for(int i = 0; i < expression->instruction_count; ++i) {
+        depth += 1 - get_argument_count(expression->instructions[i]);
+        stack_size = depth > stack_size ? depth : stack_size;
+    }
+    return stack_size;
+}
+
+// Replaces operations on constants with their result. Every constant subexpression ends up as a single instruction,
+// so when an operation's arguments are constant, they are the last instructions emitted. Rewrites in place, since
+// the output is never longer than the input read so far.
+void fold_constants(SenchaExpression *expression) {
+    SenchaInstruction *instructions = expression->instructions;
+    bool is_constant[SENCHA_MAX_STACK_SIZE];
+    int top = 0;
+    int count = 0;
+    for(int i = 0; i < expression->instruction_count; ++i) {
+        SenchaInstruction instruction = instructions[i];
+        int argument_count = get_argument_count(instruction);
+        if(argument_count == 0) {
+            is_constant[top++] = instruction.opcode == SENCHA_OP_CONSTANT;
+            instructions[count++] = instruction;
+            continue;
+        }
+
+        top -= argument_count - 1;
+        bool are_arguments_constant = true;
+        for(int j = 0; j < argument_count; ++j) {
+            are_arguments_constant = are_arguments_constant && is_constant[top - 1 + j];
+        }
+        if(!are_arguments_constant) {
+            is_constant[top - 1] = false;
+            instructions[count++] = instruction;
+            continue;
+        }
+
+        count -= argument_count - 1;
+        float *a = &instructions[count - 1].constant;
+        float arguments[SENCHA_MAX_ARGUMENTS] = {};
+        for(int j = 0; j < argument_count; ++j) {
+            arguments[j] = instructions[count - 1 + j].constant;
+        }
+        switch(instruction.opcode) {
+            case SENCHA_OP_ADD: *a += arguments[1]; break;
+            case SENCHA_OP_SUBTRACT: *a -= arguments[1]; break;
+            case SENCHA_OP_MULTIPLY: *a *= arguments[1]; break;
+            case SENCHA_OP_DIVIDE: *a /= arguments[1]; break;
+            case SENCHA_OP_SIN: *a = math::sin(*a); break;
+            case SENCHA_OP_COS: *a = math::cos(*a); break;
+            case SENCHA_OP_CALL: *a = call_function(&sencha_functions[instruction.function], arguments); break;
+            default: break;
+        }
+    }
+    expression->instruction_count = count;
+    expression->stack_size = get_stack_size(expression);
+}
+
+SenchaOptimizationStats sencha::optimize(SenchaExpression *expression) {
+    SenchaOptimizationStats stats = {};
+    stats.instruction_count_before = expression->instruction_count;
+    fold_constants(expression);
+    stats.instruction_count_after = expression->instruction_count;
+    return stats;
+}
+
+/*
+
+Batch evaluation section. Each instruction runs over a block of elements at once, so its dispatch is paid once
+per block and the arithmetic is done 4 elements per SSE instruction.
+
+*/
+
+// Elements per block, every stack entry holds a block of values.
+const uint32_t SENCHA_BATCH_BLOCK_SIZE = 64;
+const uint32_t SENCHA_BATCH_PARALLEL_MIN_COUNT = 16384;
+const uint32_t SENCHA_BATCH_CHUNK_SIZE = 4096;
+
+struct SenchaBatch {
+    // Line with variables other than inputs replaced by their values and folded, so parts of it which are the same
+    // for every element are computed once per call instead of once per block.
+    SenchaExpression expression;
+    const SenchaBatchInput *inputs;
+    float *out;
+};
+
+inline void batch_fill(float *out, float value, uint32_t width) {
+#ifdef CPPLIB_MATHS_SSE
+    __m128 v = _mm_set1_ps(value);
+    for(uint32_t i = 0; i < width; i += 4) {
+        _mm_store_ps(out + i, v);
+    }
+#else
+    for(uint32_t i = 0; i < width; ++i) {
+        out[i] = value;
+    }
+#endif
+}
+
+// `width` is a multiple of 4, `a` and `b` are 16 byte aligned.
+inline void batch_binary_operation(SenchaOpcode opcode, float *a, const float *b, uint32_t width) {
+#ifdef CPPLIB_MATHS_SSE
+    switch(opcode) {
+        case SENCHA_OP_ADD:
+            for(uint32_t i = 0; i < width; i += 4) _mm_store_ps(a + i, _mm_add_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+            break;
+        case SENCHA_OP_SUBTRACT:
+            for(uint32_t i = 0; i < width; i += 4) _mm_store_ps(a + i, _mm_sub_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+            break;
+        case SENCHA_OP_MULTIPLY:
+            for(uint32_t i = 0; i < width; i += 4) _mm_store_ps(a + i, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+            break;
+        case SENCHA_OP_DIVIDE:
+            for(uint32_t i = 0; i < width; i += 4) _mm_store_ps(a + i, _mm_div_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+            break;
+        default:
+            break;
+    }
+#else
+    switch(opcode) {
+        case SENCHA_OP_ADD:      for(uint32_t i = 0; i < width; ++i) a[i] += b[i]; break;
+        case SENCHA_OP_SUBTRACT: for(uint32_t i = 0; i < width; ++i) a[i] -= b[i]; break;
+        case SENCHA_OP_MULTIPLY: for(uint32_t i = 0; i < width; ++i) a[i] *= b[i]; break;
+        case SENCHA_OP_DIVIDE:   for(uint32_t i = 0; i < width; ++i) a[i] /= b[i]; break;
+        default: break;
+    }
+#endif
+}
+
+void eval_batch_kernel(void *data, uint32_t start, uint32_t end) {
+    SenchaBatch *batch = (SenchaBatch *)data;
+    SenchaExpression *expression = &batch->expression;
+    alignas(16) float stack[SENCHA_MAX_STACK_SIZE][SENCHA_BATCH_BLOCK_SIZE];
+
+    for(uint32_t block_start = start; block_start < end; block_start += SENCHA_BATCH_BLOCK_SIZE) {
+        uint32_t lanes = end - block_start < SENCHA_BATCH_BLOCK_SIZE ? end - block_start : SENCHA_BATCH_BLOCK_SIZE;
+        // Last block is rounded up to whole SIMD registers, padding lanes are computed and thrown away.
+        uint32_t width = (lanes + 3) & ~3u;
+
+        int top = 0;
+        for(int i = 0; i < expression->instruction_count; ++i) {
+            SenchaInstruction instruction = expression->instructions[i];
+            switch(instruction.opcode) {
+                case SENCHA_OP_CONSTANT:
+                    batch_fill(stack[top++], instruction.constant, width);
+                    break;
+                case SENCHA_OP_VARIABLE: {
+                    const float *input = batch->inputs[instruction.slot].values;
+                    memcpy(stack[top], input + block_start, lanes * sizeof(float));
+                    for(uint32_t j = lanes; j < width; ++j) stack[top][j] = 0.0f;
+                    ++top;
+                    break;
+                }
+                case SENCHA_OP_ADD:
+                case SENCHA_OP_SUBTRACT:
+                case SENCHA_OP_MULTIPLY:
+                case SENCHA_OP_DIVIDE:
+                    --top;
+                    batch_binary_operation(instruction.opcode, stack[top - 1], stack[top], width);
+                    break;
+                case SENCHA_OP_SIN:
+                    math::sin_approx(stack[top - 1], stack[top - 1], width);
+                    break;
+                case SENCHA_OP_COS:
+                    math::cos_approx(stack[top - 1], stack[top - 1], width);
+                    break;
+                case SENCHA_OP_CALL: {
+                    // Called per element, registered functions only take scalars.
+                    SenchaFunction *function = &sencha_functions[instruction.function];
+                    top -= function->argument_count - 1;
+                    for(uint32_t j = 0; j < width; ++j) {
+                        float arguments[SENCHA_MAX_ARGUMENTS];
+                        for(int k = 0; k < function->argument_count; ++k) {
+                            arguments[k] = stack[top - 1 + k][j];
+                        }
+                        stack[top - 1][j] = call_function(function, arguments);
+                    }
+                    break;
+                }
+            }
+        }
+        memcpy(batch->out + block_start, stack[0], lanes * sizeof(float));
+    }
+}
+
+bool sencha::eval(SenchaExpression *expression, SenchaTable *var_table, const SenchaBatchInput *inputs, int input_count,
+                  float *out, uint32_t count) {
+    SenchaBatch batch;
+    batch.expression = *expression;
+    batch.inputs = inputs;
+    batch.out = out;
+
+    // Variables with an input read it by its index in `inputs` instead of slot, others are replaced by their values.
+    bool is_input[SENCHA_MAX_INSTRUCTIONS] = {};
+    for(int i = 0; i < input_count; ++i) {
+        int slot = find_variable(var_table, inputs[i].name, int(strlen(inputs[i].name)));
+        if(slot < 0) {
+            sencha_log_error("Undefined batch input variable %s.", inputs[i].name);
+            return false;
+        }
+        for(int j = 0; j < expression->instruction_count; ++j) {
+            if(expression->instructions[j].opcode == SENCHA_OP_VARIABLE && expression->instructions[j].slot == slot) {
+                batch.expression.instructions[j].slot = i;
+                is_input[j] = true;
+            }
+        }
+    }
+    for(int i = 0; i < expression->instruction_count; ++i) {
+        if(expression->instructions[i].opcode != SENCHA_OP_VARIABLE || is_input[i]) continue;
+        batch.expression.instructions[i].opcode = SENCHA_OP_CONSTANT;
+        batch.expression.instructions[i].constant = var_table->variable_values[expression->instructions[i].slot];
+    }
+    fold_constants(&batch.expression);
+
+#ifdef CPPLIB_SENCHA_JOBS
+    if(count >= SENCHA_BATCH_PARALLEL_MIN_COUNT) {
+        jobs::parallel_for(count, eval_batch_kernel, &batch, SENCHA_BATCH_CHUNK_SIZE);
+        return true;
+    }
+#endif
+    eval_batch_kernel(&batch, 0, count);
+    return true;
+}
+
+/*
+
+Program section.
+
+*/
+
+// Values are compared bitwise, so NaN inputs count as unchanged when they stay NaN.
+inline bool is_same_value(float a, float b) {
+    uint32_t a_bits, b_bits;
+    memcpy(&a_bits, &a, sizeof(float));
+    memcpy(&b_bits, &b, sizeof(float));
+    return a_bits == b_bits;
+}
+
+// Edges are (source, target) pairs, turned into per-source lists of targets.
+void build_adjacency(Array<uint32_t> *edges, uint32_t source_count, Array<uint32_t> *offsets, Array<uint32_t> *targets) {
+    uint32_t edge_count = edges->count / 2;
+    array::resize(offsets, source_count + 1);
+    array::resize(targets, edge_count);
+    for(uint32_t i = 0; i <= source_count; ++i) {
+        (*offsets)[i] = 0;
+    }
+    for(uint32_t i = 0; i < edge_count; ++i) {
+        (*offsets)[(*edges)[i * 2] + 1]++;
+    }
+    for(uint32_t i = 0; i < source_count; ++i) {
+        (*offsets)[i + 1] += (*offsets)[i];
+    }
+    // Fill using offsets as cursors, then shift them back.
+    for(uint32_t i = 0; i < edge_count; ++i) {
+        uint32_t source = (*edges)[i * 2];
+        (*targets)[(*offsets)[source]++] = (*edges)[i * 2 + 1];
+    }
+    for(uint32_t i = source_count; i > 0; --i) {
+        (*offsets)[i] = (*offsets)[i - 1];
+    }
+    (*offsets)[0] = 0;
+}
+
+void queue_line(SenchaProgram *program, uint32_t line) {
+    if(program->queued[line]) {
+        return;
+    }
+    program->queued[line] = 1;
+
+    Array<uint32_t> *queue = &program->queue;
+    uint32_t index = queue->count;
+    array::add(queue, line);
+    while(index > 0) {
+        uint32_t parent = (index - 1) / 2;
+        if(program->ranks[(*queue)[parent]] <= program->ranks[line]) break;
+        (*queue)[index] = (*queue)[parent];
+        index = parent;
+    }
+    (*queue)[index] = line;
+}
+
+uint32_t pop_line(SenchaProgram *program) {
+    Array<uint32_t> *queue = &program->queue;
+    uint32_t result = (*queue)[0];
+    uint32_t last = (*queue)[--queue->count];
+    uint32_t index = 0;
+    while(true) {
+        uint32_t child = index * 2 + 1;
+        if(child >= queue->count) break;
+        if(child + 1 < queue->count && program->ranks[(*queue)[child + 1]] < program->ranks[(*queue)[child]]) {
+            child++;
+        }
+        if(program->ranks[last] <= program->ranks[(*queue)[child]]) break;
+        (*queue)[index] = (*queue)[child];
+        index = child;
+    }
+    if(queue->count > 0) {
+        (*queue)[index] = last;
+    }
+    program->queued[result] = 0;
+    return result;
+}
+
+// Length of the line starting at `line`, without the line break.
+int get_line_length(char *line) {
+    int length = 0;
+    while(line[length] && line[length] != '\n') {
+        length++;
+    }
+    return length;
+}
+
+bool is_blank_line(char *line, int length) {
+    for(int i = 0; i < length; ++i) {
+        if(line[i] != ' ' && line[i] != '\t' && line[i] != '\r') return false;
+    }
+    return true;
+}
+
+// Prefixes the error logged by the compiler with the script line number.
+void log_line_error(int line_number) {
+    char message[SENCHA_ERROR_BUFFER_SIZE];
+    memcpy(message, sencha_error_buffer, SENCHA_ERROR_BUFFER_SIZE);
+    sencha_log_error("Line %d: %s", line_number, message);
+}
+
+// Builds edges from lines assigning a variable to lines reading it and from inputs to lines reading them, and ranks
+// lines in dependency order. Returns false if lines form a cycle, `line_numbers` are only used in the error message
+// and can be NULL if the lines are known to be acyclic.
+bool build_program_graph(SenchaProgram *program, SenchaTable *var_table, Array<int32_t> *line_numbers) {
+    uint32_t line_count = program->lines.count;
+    uint32_t variable_count = var_table->variable_values.count;
+    Array<int32_t> assigning_line = array::get<int32_t>(variable_count + 1, MEMORY_TAG_SENCHA);
+    Array<int32_t> input_index = array::get<int32_t>(variable_count + 1, MEMORY_TAG_SENCHA);
+    array::resize(&assigning_line, variable_count);
+    array::resize(&input_index, variable_count);
+    for(uint32_t i = 0; i < variable_count; ++i) {
+        assigning_line[i] = -1;
+        input_index[i] = -1;
+    }
+    for(uint32_t i = 0; i < line_count; ++i) {
+        assigning_line[program->lines[i].target_slot] = int32_t(i);
+    }
+
+    array::reset(&program->input_slots);
+    array::reset(&program->input_values);
+    Array<uint32_t> line_edges = array::get<uint32_t>(16, MEMORY_TAG_SENCHA);
+    Array<uint32_t> input_edges = array::get<uint32_t>(16, MEMORY_TAG_SENCHA);
+    for(uint32_t i = 0; i < line_count; ++i) {
+        SenchaExpression *expression = &program->lines[i];
+        for(int j = 0; j < expression->instruction_count; ++j) {
+            if(expression->instructions[j].opcode != SENCHA_OP_VARIABLE) continue;
+            int slot = expression->instructions[j].slot;
+
+            // Variables used more than once in a line only need one edge.
+            bool seen = false;
+            for(int k = 0; k < j; ++k) {
+                seen = seen || (expression->instructions[k].opcode == SENCHA_OP_VARIABLE && expression->instructions[k].slot == slot);
+            }
+            if(seen) continue;
+
+            if(assigning_line[slot] >= 0) {
+                array::add(&line_edges, uint32_t(assigning_line[slot]));
+                array::add(&line_edges, i);
+            } else {
+                if(input_index[slot] < 0) {
+                    input_index[slot] = int32_t(program->input_slots.count);
+                    array::add(&program->input_slots, int32_t(slot));
+                    array::add(&program->input_values, var_table->variable_values[slot]);
+                }
+                array::add(&input_edges, uint32_t(input_index[slot]));
+                array::add(&input_edges, i);
+            }
+        }
+    }
+    build_adjacency(&line_edges, line_count, &program->dependent_offsets, &program->dependents);
+    build_adjacency(&input_edges, program->input_slots.count, &program->input_line_offsets, &program->input_lines);
+
+    // Kahn's algorithm, ranks are positions in the resulting order. Lines left over are part of a cycle.
+    bool success = true;
+    Array<uint32_t> in_degree = array::get<uint32_t>(line_count + 1, MEMORY_TAG_SENCHA);
+    Array<uint32_t> order = array::get<uint32_t>(line_count + 1, MEMORY_TAG_SENCHA);
+    array::resize(&in_degree, line_count);
+    for(uint32_t i = 0; i < line_count; ++i) {
+        in_degree[i] = 0;
+    }
+    for(uint32_t i = 0; i < program->dependents.count; ++i) {
+        in_degree[program->dependents[i]]++;
+    }
+    for(uint32_t i = 0; i < line_count; ++i) {
+        if(in_degree[i] == 0) array::add(&order, i);
+    }
+    for(uint32_t i = 0; i < order.count; ++i) {
+        uint32_t line = order[i];
+        for(uint32_t j = program->dependent_offsets[line]; j < program->dependent_offsets[line + 1]; ++j) {
+            if(--in_degree[program->dependents[j]] == 0) array::add(&order, program->dependents[j]);
+        }
+    }
+
+    if(order.count < line_count) {
+        // Left over lines can also just read a cycle. Each of them reads another left over line, so walking those
+        // backwards ends up repeating a line, which is on the cycle.
+        uint32_t line = 0;
+        while(in_degree[line] == 0) {
+            line++;
+        }
+        Array<uint8_t> visited = array::get<uint8_t>(line_count, MEMORY_TAG_SENCHA);
+        array::resize(&visited, line_count);
+        memset(visited.data, 0, line_count);
+        while(!visited[line]) {
+            visited[line] = 1;
+            for(uint32_t i = 0; i < line_edges.count; i += 2) {
+                if(line_edges[i + 1] == line && in_degree[line_edges[i]] > 0) {
+                    line = line_edges[i];
+                    break;
+                }
+            }
+        }
+        array::release(&visited);
+
+        SenchaName name = var_table->variable_names[program->lines[line].target_slot];
+        int line_number = line_numbers ? (*line_numbers)[line] : int(line + 1);
+        sencha_log_error("Line %d: Variable %s depends on itself.", line_number, name.data);
+        success = false;
+    } else {
+        array::resize(&program->ranks, line_count);
+        for(uint32_t i = 0; i < line_count; ++i) {
+            program->ranks[order[i]] = i;
+        }
+        array::resize(&program->queued, line_count);
+        memset(program->queued.data, 0, line_count);
+        array::reset(&program->queue);
+        program->updated = false;
+    }
+
+    array::release(&assigning_line);
+    array::release(&input_index);
+    array::release(&line_edges);
+    array::release(&input_edges);
+    array::release(&in_degree);
+    array::release(&order);
+    return success;
+}
+
+bool sencha::compile_program(char *script, SenchaTable *var_table, SenchaProgram *program) {
+    *program = SenchaProgram{};
+    array::init(&program->lines, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->dependent_offsets, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->dependents, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->ranks, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->input_slots, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->input_values, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->input_line_offsets, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->input_lines, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->queue, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->queued, 16, MEMORY_TAG_SENCHA);
+    array::init(&program->native_offsets, 16, MEMORY_TAG_SENCHA);
+
+    // Add all assigned variables first, so lines can use variables assigned further down.
+    Array<int32_t> assigning_line = array::get<int32_t>(var_table->variable_values.count + 16, MEMORY_TAG_SENCHA);
+    Array<int32_t> line_numbers = array::get<int32_t>(16, MEMORY_TAG_SENCHA);
+    bool success = true;
+    int line_number = 1;
+    for(char *line = script; success; ++line_number) {
+        int length = get_line_length(line);
+        if(!is_blank_line(line, length)) {
+            Lexer lexer = Lexer{line, line, length};
+            Token token = get_next_token(&lexer);
+            if(token.type == SenchaTokenType::IDENTIFIER) {
+                int slot = find_variable(var_table, token.data, token.data_size);
+                if(slot < 0) {
+                    slot = add_variable_(var_table, token.data, token.data_size);
+                }
+                while(assigning_line.count < var_table->variable_values.count) {
+                    array::add(&assigning_line, -1);
+                }
+                if(assigning_line[slot] >= 0) {
+                    sencha_log_error(
+                        "Line %d: Variable %.*s is already assigned on line %d.",
+                        line_number,
+                        token.data_size,
+                        token.data,
+                        line_numbers[assigning_line[slot]]
+                    );
+                    success = false;
+                }
+                assigning_line[slot] = int32_t(line_numbers.count);
+            }
+            array::add(&line_numbers, line_number);
+        }
+        if(!line[length]) break;
+        line += length + 1;
+    }
+    while(assigning_line.count < var_table->variable_values.count) {
+        array::add(&assigning_line, -1);
+    }
+
+    // Compile lines, compile_line reports syntax errors (and lines not starting with a variable name).
+    line_number = 1;
+    for(char *line = script; success; ++line_number) {
+        int length = get_line_length(line);
+        if(!is_blank_line(line, length)) {
+            SenchaExpression *expression = array::emplace(&program->lines);
+            if(!compile_line_(line, length, var_table, expression)) {
+                log_line_error(line_number);
+                success = false;
+            }
+        }
+        if(!line[length]) break;
+        line += length + 1;
+    }
+
+    if(success) {
+        success = build_program_graph(program, var_table, &line_numbers);
+    }
+
+    array::release(&assigning_line);
+    array::release(&line_numbers);
+    if(!success) {
+        sencha::release(program);
+    }
+    return success;
+}
+
+// Subexpression of a program line, instructions[start] up to instructions[start + count].
+struct SenchaSubexpression {
+    uint32_t line;
+    int start;
+    int count;
+    uint32_t hash;
+};
+
+// Largest first, so when a subexpression repeats, repeats inside it are left for after it's shared. Equal ones end up
+// next to each other, ordered by position.
+int compare_subexpressions(const void *a, const void *b) {
+    SenchaSubexpression *x = (SenchaSubexpression *)a;
+    SenchaSubexpression *y = (SenchaSubexpression *)b;
+    if(x->count != y->count) return x->count > y->count ? -1 : 1;
+    if(x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    if(x->line != y->line) return x->line < y->line ? -1 : 1;
+    return x->start < y->start ? -1 : (x->start > y->start ? 1 : 0);
+}
+
+inline SenchaInstruction *get_instructions(SenchaProgram *program, SenchaSubexpression *subexpression) {
+    return program->lines[subexpression->line].instructions + subexpression->start;
+}
+
+// Collects every operation of the program with the subexpression it computes. Arguments are emitted before their
+// operation, so walking a line with a stack of subexpression starts gives each operation's first instruction.
+void collect_subexpressions(SenchaProgram *program, Array<SenchaSubexpression> *subexpressions) {
+    array::reset(subexpressions);
+    for(uint32_t i = 0; i < program->lines.count; ++i) {
+        SenchaExpression *expression = &program->lines[i];
+        int starts[SENCHA_MAX_STACK_SIZE];
+        int top = 0;
+        for(int j = 0; j < expression->instruction_count; ++j) {
+            int argument_count = get_argument_count(expression->instructions[j]);
+            if(argument_count == 0) {
+                starts[top++] = j;
+                continue;
+            }
+            top -= argument_count - 1;
+            SenchaSubexpression subexpression = SenchaSubexpression{i, starts[top - 1], j - starts[top - 1] + 1, 0};
+            subexpression.hash = hash_name((char *)get_instructions(program, &subexpression),
+                                           int(subexpression.count * sizeof(SenchaInstruction)));
+            array::add(subexpressions, subexpression);
+        }
+    }
+}
+
+// Finds the largest subexpression occurring more than once and replaces all its occurrences with a variable read.
+// If one occurrence is a whole line, others read that line's variable, otherwise a new line assigns a hidden
+// variable. Returns false if nothing repeats.
+bool share_subexpression(SenchaProgram *program, SenchaTable *var_table, Array<SenchaSubexpression> *subexpressions) {
+    collect_subexpressions(program, subexpressions);
+    qsort(subexpressions->data, subexpressions->count, sizeof(SenchaSubexpression), compare_subexpressions);
+
+    for(uint32_t first = 0; first < subexpressions->count; ++first) {
+        SenchaSubexpression *shared = &(*subexpressions)[first];
+        size_t size = shared->count * sizeof(SenchaInstruction);
+
+        // Occurrences never overlap, a subexpression can't contain another one of the same length.
+        uint32_t end = first + 1;
+        while(end < subexpressions->count && (*subexpressions)[end].count == shared->count && (*subexpressions)[end].hash == shared->hash) {
+            end++;
+        }
+        uint32_t occurrence_count = 0;
+        int32_t source_line = -1;
+        for(uint32_t i = first; i < end; ++i) {
+            SenchaSubexpression *subexpression = &(*subexpressions)[i];
+            if(memcmp(get_instructions(program, subexpression), get_instructions(program, shared), size) != 0) {
+                subexpression->count = 0;
+                continue;
+            }
+            occurrence_count++;
+            if(subexpression->start == 0 && subexpression->count == program->lines[subexpression->line].instruction_count) {
+                source_line = int32_t(subexpression->line);
+            }
+        }
+        if(occurrence_count < 2) {
+            first = end - 1;
+            continue;
+        }
+
+        int slot;
+        if(source_line >= 0) {
+            slot = program->lines[source_line].target_slot;
+        } else {
+            // Hidden variables have names the lexer doesn't accept, so they can't collide with script variables.
+            char name[16];
+            int name_length;
+            for(int i = 0; ; ++i) {
+                name_length = snprintf(name, sizeof(name), "#%d", i);
+                if(find_variable(var_table, name, name_length) < 0) break;
+            }
+            slot = add_variable_(var_table, name, name_length);
+
+            SenchaExpression *line = array::emplace(&program->lines);
+            memcpy(line->instructions, get_instructions(program, shared), size);
+            line->instruction_count = shared->count;
+            line->stack_size = get_stack_size(line);
+            line->target_slot = slot;
+        }
+
+        // Occurrences later in a line go first, so earlier starts stay valid.
+        for(uint32_t i = end; i > first; --i) {
+            SenchaSubexpression *subexpression = &(*subexpressions)[i - 1];
+            if(subexpression->count == 0 || int32_t(subexpression->line) == source_line) continue;
+            SenchaExpression *expression = &program->lines[subexpression->line];
+            SenchaInstruction *instructions = get_instructions(program, subexpression);
+            int tail_count = expression->instruction_count - subexpression->start - subexpression->count;
+            memmove(instructions + 1, instructions + subexpression->count, tail_count * sizeof(SenchaInstruction));
+            instructions[0] = SenchaInstruction{};
+            instructions[0].opcode = SENCHA_OP_VARIABLE;
+            instructions[0].slot = slot;
+            expression->instruction_count -= subexpression->count - 1;
+            expression->stack_size = get_stack_size(expression);
+        }
+        return true;
+    }
+    return false;
+}
+
+SenchaOptimizationStats sencha::optimize(SenchaProgram *program, SenchaTable *var_table) {
+    SenchaOptimizationStats stats = {};
+    uint32_t line_count = program->lines.count;
+    for(uint32_t i = 0; i < line_count; ++i) {
+        stats.instruction_count_before += program->lines[i].instruction_count;
+    }
+
+    // Lines in dependency order, so constants are known before lines reading them are folded. Lines which don't
+    // depend on any input fold to a constant, which is then substituted into lines reading it.
+    Array<uint32_t> order = array::get<uint32_t>(line_count + 1, MEMORY_TAG_SENCHA);
+    Array<uint8_t> is_constant = array::get<uint8_t>(var_table->variable_values.count + 1, MEMORY_TAG_SENCHA);
+    Array<float> constants = array::get<float>(var_table->variable_values.count + 1, MEMORY_TAG_SENCHA);
+    array::resize(&order, line_count);
+    array::resize(&is_constant, var_table->variable_values.count);
+    array::resize(&constants, var_table->variable_values.count);
+    memset(is_constant.data, 0, is_constant.count);
+    for(uint32_t i = 0; i < line_count; ++i) {
+        order[program->ranks[i]] = i;
+    }
+    for(uint32_t i = 0; i < line_count; ++i) {
+        SenchaExpression *expression = &program->lines[order[i]];
+        for(int j = 0; j < expression->instruction_count; ++j) {
+            SenchaInstruction *instruction = &expression->instructions[j];
+            if(instruction->opcode == SENCHA_OP_VARIABLE && is_constant[instruction->slot]) {
+                float value = constants[instruction->slot];
+                instruction->opcode = SENCHA_OP_CONSTANT;
+                instruction->constant = value;
+            }
+        }
+        fold_constants(expression);
+        if(expression->instruction_count == 1 && expression->instructions[0].opcode == SENCHA_OP_CONSTANT) {
+            is_constant[expression->target_slot] = 1;
+            constants[expression->target_slot] = expression->instructions[0].constant;
+        }
+    }
+
+    Array<SenchaSubexpression> subexpressions = array::get<SenchaSubexpression>(64, MEMORY_TAG_SENCHA);
+    while(share_subexpression(program, var_table, &subexpressions)) {
+        stats.shared_subexpression_count++;
+    }
+
+    for(uint32_t i = 0; i < program->lines.count; ++i) {
+        stats.instruction_count_after += program->lines[i].instruction_count;
+    }
+    build_program_graph(program, var_table, NULL);
+    sencha::release(&program->native_code);
+    array::reset(&program->native_offsets);
+
+    array::release(&order);
+    array::release(&is_constant);
+    array::release(&constants);
+    array::release(&subexpressions);
+    return stats;
+}
+
+uint32_t sencha::update(SenchaProgram *program, SenchaTable *var_table) {
+    float *values = var_table->variable_values.data;
+    if(!program->updated) {
+        program->updated = true;
+        for(uint32_t i = 0; i < program->lines.count; ++i) {
+            queue_line(program, i);
+        }
+    }
+    for(uint32_t i = 0; i < program->input_slots.count; ++i) {
+        float value = values[program->input_slots[i]];
+        if(is_same_value(value, program->input_values[i])) continue;
+        program->input_values[i] = value;
+        for(uint32_t j = program->input_line_offsets[i]; j < program->input_line_offsets[i + 1]; ++j) {
+            queue_line(program, program->input_lines[j]);
+        }
+    }
+
+    uint32_t recomputed_count = 0;
+    while(program->queue.count > 0) {
+        uint32_t line = pop_line(program);
+        SenchaExpression *expression = &program->lines[line];
+        float old_value = values[expression->target_slot];
+        float new_value;
+        if(program->native_code.memory) {
+            uint8_t *function = (uint8_t *)program->native_code.memory + program->native_offsets[line];
+            new_value = ((SenchaNativeFunction)function)(values);
+        } else {
+            new_value = sencha::eval(expression, var_table);
+        }
+        recomputed_count++;
+        if(is_same_value(old_value, new_value)) continue;
+        for(uint32_t j = program->dependent_offsets[line]; j < program->dependent_offsets[line + 1]; ++j) {
+            queue_line(program, program->dependents[j]);
+        }
+    }
+    return recomputed_count;
+}
+
+void sencha::release(SenchaProgram *program) {
+    array::release(&program->lines);
+    array::release(&program->dependent_offsets);
+    array::release(&program->dependents);
+    array::release(&program->ranks);
+    array::release(&program->input_slots);
+    array::release(&program->input_values);
+    array::release(&program->input_line_offsets);
+    array::release(&program->input_lines);
+    array::release(&program->queue);
+    array::release(&program->queued);
+    sencha::release(&program->native_code);
+    array::release(&program->native_offsets);
+    *program = SenchaProgram{};
+}
+
+/*
+
+Native code section. Lines are compiled to x86-64 functions `float line(float *values)`. Value stack entry i lives
+in register xmm<i>, so most instructions become a single SSE instruction, and variables are read and written
+directly in `values`.
+
+*/
+
+#ifdef SENCHA_NATIVE_X64
+
+enum SenchaRegister {
+    SENCHA_RAX = 0,
+    SENCHA_RCX = 1,
+    SENCHA_RBX = 3,
+    SENCHA_RSP = 4,
+};
+
+const int SENCHA_NATIVE_REGISTER_COUNT = 16;
+// Stack frame has shadow space required by Windows x64 calls, spill slots for registers live across sin and cos
+// calls, and on Windows also xmm6-xmm15, which are callee saved there.
+const int32_t SENCHA_NATIVE_SPILL_OFFSET = 32;
+const int32_t SENCHA_NATIVE_SAVED_OFFSET = SENCHA_NATIVE_SPILL_OFFSET + SENCHA_NATIVE_REGISTER_COUNT * 4;
+const int32_t SENCHA_NATIVE_FRAME_SIZE = SENCHA_NATIVE_SAVED_OFFSET + 10 * 16;
+
+// Second opcode bytes of SSE instructions, after 0x0F.
+const uint8_t SENCHA_SSE_LOAD = 0x10;
+const uint8_t SENCHA_SSE_STORE = 0x11;
+const uint8_t SENCHA_SSE_MOVAPS = 0x28;
+const uint8_t SENCHA_SSE_ADD = 0x58;
+const uint8_t SENCHA_SSE_MULTIPLY = 0x59;
+const uint8_t SENCHA_SSE_SUBTRACT = 0x5C;
+const uint8_t SENCHA_SSE_DIVIDE = 0x5E;
+const uint8_t SENCHA_SSE_MOVD = 0x6E;
+// Prefixes selecting the scalar single (movss, addss, ...) and movd forms, 0 for packed (movups, movaps).
+const uint8_t SENCHA_SSE_SCALAR = 0xF3;
+const uint8_t SENCHA_SSE_MOVD_PREFIX = 0x66;
+
+inline void emit_byte(Array<uint8_t> *code, uint8_t byte) {
+    array::add(code, byte);
+}
+
+void emit_u32(Array<uint8_t> *code, uint32_t value) {
+    for(int i = 0; i < 4; ++i) {
+        emit_byte(code, uint8_t(value >> (i * 8)));
+    }
+}
+
+void emit_u64(Array<uint8_t> *code, uint64_t value) {
+    for(int i = 0; i < 8; ++i) {
+        emit_byte(code, uint8_t(value >> (i * 8)));
+    }
+}
+
+// SSE instruction on two registers, `reg` is the destination except for stores.
+void emit_sse(Array<uint8_t> *code, uint8_t prefix, uint8_t opcode, int reg, int rm) {
+    if(prefix) emit_byte(code, prefix);
+    if(reg >= 8 || rm >= 8) emit_byte(code, uint8_t(0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0)));
+    emit_byte(code, 0x0F);
+    emit_byte(code, opcode);
+    emit_byte(code, uint8_t(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+// SSE instruction on a register and memory at `base` + `offset`.
+void emit_sse_memory(Array<uint8_t> *code, uint8_t prefix, uint8_t opcode, int reg, SenchaRegister base, int32_t offset) {
+    if(prefix) emit_byte(code, prefix);
+    if(reg >= 8) emit_byte(code, 0x44);
+    emit_byte(code, 0x0F);
+    emit_byte(code, opcode);
+    emit_byte(code, uint8_t(0x80 | (reg & 7) << 3 | base));
+    if(base == SENCHA_RSP) emit_byte(code, 0x24);
+    emit_u32(code, uint32_t(offset));
+}
+
+bool emit_native_line(Array<uint8_t> *code, SenchaExpression *expression) {
+    if(expression->stack_size > SENCHA_NATIVE_REGISTER_COUNT) {
+        sencha_log_error("Expression is nested too deep for native code, at most %d values are supported.", SENCHA_NATIVE_REGISTER_COUNT);
+        return false;
+    }
+
+    // Prologue, `values` is kept in rbx, which calls preserve.
+    emit_byte(code, 0x53);
+    emit_byte(code, 0x48);
+    emit_byte(code, 0x89);
+#ifdef _WIN32
+    emit_byte(code, 0xCB);
+#else
+    emit_byte(code, 0xFB);
+#endif
+    emit_byte(code, 0x48);
+    emit_byte(code, 0x81);
+    emit_byte(code, 0xEC);
+    emit_u32(code, SENCHA_NATIVE_FRAME_SIZE);
+#ifdef _WIN32
+    for(int i = 6; i < expression->stack_size; ++i) {
+        emit_sse_memory(code, 0, SENCHA_SSE_STORE, i, SENCHA_RSP, SENCHA_NATIVE_SAVED_OFFSET + (i - 6) * 16);
+    }
+#endif
+
+    int top = 0;
+    for(int i = 0; i < expression->instruction_count; ++i) {
+        SenchaInstruction instruction = expression->instructions[i];
+        switch(instruction.opcode) {
+            case SENCHA_OP_CONSTANT: {
+                uint32_t bits;
+                memcpy(&bits, &instruction.constant, sizeof(float));
+                emit_byte(code, 0xB8);
+                emit_u32(code, bits);
+                emit_sse(code, SENCHA_SSE_MOVD_PREFIX, SENCHA_SSE_MOVD, top++, SENCHA_RAX);
+                break;
+            }
+            case SENCHA_OP_VARIABLE:
+                emit_sse_memory(code, SENCHA_SSE_SCALAR, SENCHA_SSE_LOAD, top++, SENCHA_RBX, instruction.slot * 4);
+                break;
+            case SENCHA_OP_ADD:
+            case SENCHA_OP_SUBTRACT:
+            case SENCHA_OP_MULTIPLY:
+            case SENCHA_OP_DIVIDE: {
+                uint8_t opcode = instruction.opcode == SENCHA_OP_ADD ? SENCHA_SSE_ADD :
+                                 instruction.opcode == SENCHA_OP_SUBTRACT ? SENCHA_SSE_SUBTRACT :
+                                 instruction.opcode == SENCHA_OP_MULTIPLY ? SENCHA_SSE_MULTIPLY : SENCHA_SSE_DIVIDE;
+                --top;
+                emit_sse(code, SENCHA_SSE_SCALAR, opcode, top - 1, top);
+                break;
+            }
+            case SENCHA_OP_SIN:
+            case SENCHA_OP_COS:
+            case SENCHA_OP_CALL: {
+                // Calls can overwrite any xmm register, entries below the arguments are spilled around the call.
+                // Arguments go to xmm0, xmm1, ... in both calling conventions, the result comes back in xmm0.
+                int argument_count = get_argument_count(instruction);
+                int base = top - argument_count;
+                for(int j = 0; j < base; ++j) {
+                    emit_sse_memory(code, SENCHA_SSE_SCALAR, SENCHA_SSE_STORE, j, SENCHA_RSP, SENCHA_NATIVE_SPILL_OFFSET + j * 4);
+                }
+                for(int j = 0; base != 0 && j < argument_count; ++j) {
+                    emit_sse(code, 0, SENCHA_SSE_MOVAPS, j, base + j);
+                }
+                uint64_t address;
+                if(instruction.opcode == SENCHA_OP_CALL) {
+                    SenchaFunction *function = &sencha_functions[instruction.function];
+                    switch(argument_count) {
+                        case 1: address = uint64_t(uintptr_t(function->function1)); break;
+                        case 2: address = uint64_t(uintptr_t(function->function2)); break;
+                        default: address = uint64_t(uintptr_t(function->function3)); break;
+                    }
+                } else {
+                    float (*function)(float) = instruction.opcode == SENCHA_OP_SIN ? math::sin : math::cos;
+                    address = uint64_t(uintptr_t(function));
+                }
+                emit_byte(code, 0x48);
+                emit_byte(code, 0xB8);
+                emit_u64(code, address);
+                emit_byte(code, 0xFF);
+                emit_byte(code, 0xD0);
+                if(base != 0) emit_sse(code, 0, SENCHA_SSE_MOVAPS, base, 0);
+                for(int j = 0; j < base; ++j) {
+                    emit_sse_memory(code, SENCHA_SSE_SCALAR, SENCHA_SSE_LOAD, j, SENCHA_RSP, SENCHA_NATIVE_SPILL_OFFSET + j * 4);
+                }
+                top = base + 1;
+                break;
+            }
+        }
+    }
+
+    // Epilogue, the result is already in xmm0 where it's returned.
+    emit_sse_memory(code, SENCHA_SSE_SCALAR, SENCHA_SSE_STORE, 0, SENCHA_RBX, expression->target_slot * 4);
+#ifdef _WIN32
+    for(int i = 6; i < expression->stack_size; ++i) {
+        emit_sse_memory(code, 0, SENCHA_SSE_LOAD, i, SENCHA_RSP, SENCHA_NATIVE_SAVED_OFFSET + (i - 6) * 16);
+    }
+#endif
+    emit_byte(code, 0x48);
+    emit_byte(code, 0x81);
+    emit_byte(code, 0xC4);
+    emit_u32(code, SENCHA_NATIVE_FRAME_SIZE);
+    emit_byte(code, 0x5B);
+    emit_byte(code, 0xC3);
+    return true;
+}
+
+// Copies code to new pages, which are then made executable and no longer writable.
+bool make_native_code(Array<uint8_t> *code, SenchaNativeCode *native_code) {
+#ifdef _WIN32
+    void *memory = VirtualAlloc(NULL, code->count, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    DWORD old_protection;
+    bool success = memory != NULL;
+    if(success) {
+        memcpy(memory, code->data, code->count);
+        success = VirtualProtect(memory, code->count, PAGE_EXECUTE_READ, &old_protection) != 0;
+        if(!success) VirtualFree(memory, 0, MEM_RELEASE);
+    }
+#else
+    void *memory = mmap(NULL, code->count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    bool success = memory != MAP_FAILED;
+    if(success) {
+        memcpy(memory, code->data, code->count);
+        success = mprotect(memory, code->count, PROT_READ | PROT_EXEC) == 0;
+        if(!success) munmap(memory, code->count);
+    }
+#endif
+    if(!success) {
+        sencha_log_error("Failed to allocate executable memory for native code.");
+        return false;
+    }
+    native_code->memory = memory;
+    native_code->size = code->count;
+    return true;
+}
+
+bool sencha::compile_native(SenchaExpression *expression, SenchaNativeCode *native_code) {
+    *native_code = SenchaNativeCode{};
+    Array<uint8_t> code = array::get<uint8_t>(256, MEMORY_TAG_SENCHA);
+    bool success = emit_native_line(&code, expression) && make_native_code(&code, native_code);
+    array::release(&code);
+    return success;
+}
+
+bool sencha::compile_native(SenchaProgram *program) {
+    sencha::release(&program->native_code);
+    array::reset(&program->native_offsets);
+    Array<uint8_t> code = array::get<uint8_t>(program->lines.count * 64 + 16, MEMORY_TAG_SENCHA);
+    bool success = true;
+    for(uint32_t i = 0; i < program->lines.count && success; ++i) {
+        // Functions start at 16 bytes, padded with int3.
+        while(code.count % 16 != 0) {
+            emit_byte(&code, 0xCC);
+        }
+        array::add(&program->native_offsets, code.count);
+        success = emit_native_line(&code, &program->lines[i]);
+    }
+    success = success && make_native_code(&code, &program->native_code);
+    array::release(&code);
+    return success;
+}
+
+void sencha::release(SenchaNativeCode *native_code) {
+    if(native_code->memory) {
+#ifdef _WIN32
+        VirtualFree(native_code->memory, 0, MEM_RELEASE);
+#else
+        munmap(native_code->memory, native_code->size);
+#endif
+    }
+    *native_code = SenchaNativeCode{};
+}
+
+#else
+
+bool sencha::compile_native(SenchaExpression *expression, SenchaNativeCode *native_code) {
+    *native_code = SenchaNativeCode{};
+    sencha_log_error("Native code is only supported on x86-64.");
+    return false;
+}
+
+bool sencha::compile_native(SenchaProgram *program) {
+    sencha_log_error("Native code is only supported on x86-64.");
+    return false;
+}
+
+void sencha::release(SenchaNativeCode *native_code) {
+    *native_code = SenchaNativeCode{};
+}
+
+#endif
\ No newline at end of file
@@ -1,15 +1,202 @@
 #pragma once
+#include <stdint.h>
+#include <string.h>
+#include "array.h"
+#include "hash_map.h"
 
+// Interned variable name, `data` is NUL terminated and owned by the table. Lookup keys point into source text
+// instead, which is why the length is stored.
+struct SenchaName {
+    const char *data;
+    uint32_t length;
+    uint32_t hash;
+};
+
+inline bool operator==(SenchaName a, SenchaName b) {
+    return a.hash == b.hash && a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+inline uint32_t hash_key(SenchaName name) {
+    return name.hash;
+}
+
+// Variables are identified by slots, indices into `variable_values` assigned in order of creation. Slots never
+// change, so callers can resolve a name once and then read and write the value without any string work.
+// Memory is allocated on first use and has to be freed with `sencha::release`.
 struct SenchaTable {
-    char variable_names[100][100];
-    float variable_values[100];
-    int variable_count = 0;
+    HashMap<SenchaName, int32_t> slots = {};
+    Array<SenchaName> variable_names = {};
+    Array<float> variable_values = {};
+};
+
+// Compiled right hand side of an assignment line, so it can be evaluated repeatedly without parsing. Instructions
+// run on a small value stack in order, variables are referenced by their index in the table the line was
+// compiled against.
+enum SenchaOpcode {
+    SENCHA_OP_CONSTANT,
+    SENCHA_OP_VARIABLE,
+    SENCHA_OP_ADD,
+    SENCHA_OP_SUBTRACT,
+    SENCHA_OP_MULTIPLY,
+    SENCHA_OP_DIVIDE,
+    SENCHA_OP_SIN,
+    SENCHA_OP_COS,
+    // Call of any other function, see sencha::register_function.
+    SENCHA_OP_CALL,
+};
+
+struct SenchaInstruction {
+    SenchaOpcode opcode;
+    union {
+        float constant;
+        int slot;
+        // Index of the function in the registry.
+        int function;
+    };
+};
+
+// Functions callable from scripts, with 1 to 3 arguments.
+typedef float (*SenchaFunction1)(float);
+typedef float (*SenchaFunction2)(float, float);
+typedef float (*SenchaFunction3)(float, float, float);
+
+const int SENCHA_MAX_ARGUMENTS = 3;
+const int SENCHA_MAX_FUNCTIONS = 64;
+
+const int SENCHA_MAX_INSTRUCTIONS = 128;
+const int SENCHA_MAX_STACK_SIZE = 32;
+
+struct SenchaExpression {
+    SenchaInstruction instructions[SENCHA_MAX_INSTRUCTIONS];
+    int instruction_count;
+    // Deepest the value stack gets during evaluation.
+    int stack_size;
+    // Slot of the variable the line assigns to.
+    int target_slot;
+};
+
+// Per-element values of a variable for batch evaluation.
+struct SenchaBatchInput {
+    char *name;
+    const float *values;
+};
+
+// Machine code of compiled lines, see sencha::compile_native. Each line is a function taking the table's values,
+// which assigns the result and returns it.
+typedef float (*SenchaNativeFunction)(float *values);
+
+struct SenchaNativeCode {
+    void *memory;
+    uint32_t size;
+};
+
+// Script of assignment lines evaluated incrementally. Lines form a dependency graph through the variables they
+// assign, `sencha::update` recomputes only lines downstream of inputs which changed, in dependency order.
+struct SenchaProgram {
+    Array<SenchaExpression> lines;
+    // Lines reading line i's result are dependents[dependent_offsets[i]] up to dependents[dependent_offsets[i + 1]].
+    Array<uint32_t> dependent_offsets;
+    Array<uint32_t> dependents;
+    // Position of each line in dependency order.
+    Array<uint32_t> ranks;
+
+    // Variables the program reads but doesn't assign, with values seen by the last update and lines reading
+    // them, stored the same way as dependents.
+    Array<int32_t> input_slots;
+    Array<float> input_values;
+    Array<uint32_t> input_line_offsets;
+    Array<uint32_t> input_lines;
+
+    // Lines waiting to be recomputed, a binary heap ordered by rank.
+    Array<uint32_t> queue;
+    Array<uint8_t> queued;
+    bool updated;
+
+    // Lines compiled by sencha::compile_native, line i's function starts at byte native_offsets[i].
+    SenchaNativeCode native_code;
+    Array<uint32_t> native_offsets;
+};
+
+struct SenchaOptimizationStats {
+    int instruction_count_before;
+    int instruction_count_after;
+    // Subexpressions repeated in a program, which are now computed once.
+    int shared_subexpression_count;
 };
 
 namespace sencha {
     void add_or_set_variable(SenchaTable *var_table, char *name, float value);
     bool get_variable(SenchaTable *var_table, char *name, float *value);
+    // Returns slot of the variable, -1 if it doesn't exist.
+    int get_slot(SenchaTable *var_table, char *name);
+    // Returns slot of the variable, it's added with value 0 if it doesn't exist.
+    int add_variable(SenchaTable *var_table, char *name);
+    inline float get_value(SenchaTable *var_table, int slot) {
+        return var_table->variable_values[slot];
+    }
+    inline void set_value(SenchaTable *var_table, int slot, float value) {
+        var_table->variable_values[slot] = value;
+    }
+    void release(SenchaTable *var_table);
     bool parse_line(char *line, SenchaTable *var_table);
+
+    // Builtin functions are sin(x), cos(x), abs(x), floor(x), noise(x), min(a, b), max(a, b), pow(x, e),
+    // clamp(x, min, max), lerp(a, b, t) and smoothstep(edge0, edge1, x). Registered functions are called with
+    // exactly the number of arguments they take, calls with other counts fail to parse or compile. Calls are
+    // resolved once when compiling, so functions have to be registered before lines using them are compiled, and
+    // they have to return the same result for the same arguments, since optimization can compute calls ahead of
+    // time or share them. Names have to be identifiers the script lexer accepts (letters and underscores) and have
+    // to outlive the registration. Returns false if the name is taken or the registry is full. Not thread-safe.
+    bool register_function(char *name, SenchaFunction1 function);
+    bool register_function(char *name, SenchaFunction2 function);
+    bool register_function(char *name, SenchaFunction3 function);
+
+    // Same syntax and error reporting as parse_line. Variables used on the right hand side have to exist in
+    // `var_table`, the assigned variable is added to it if it doesn't exist yet.
+    bool compile_line(char *line, SenchaTable *var_table, SenchaExpression *expression);
+    // Evaluates a compiled line, assigns the result and returns it. Doesn't allocate or touch variable names.
+    // `var_table` has to be the table the line was compiled against.
+    float eval(SenchaExpression *expression, SenchaTable *var_table);
+    // Evaluates a compiled line for `count` elements, writing result i to `out[i]`. Variables named in `inputs` read
+    // element i of their array, others read their current value. `var_table` isn't modified. Returns false if an
+    // input isn't a variable of the table. Parts of the line not depending on inputs are computed once per call.
+    // Elements are processed in blocks with SIMD, sin and cos use math::sin_approx/cos_approx, so results can differ
+    // from `eval` by ~3e-7. If CPPLIB_SENCHA_JOBS is defined
+    // when compiling sencha.cpp, large batches are split over job system threads (see jobs.h).
+    bool eval(SenchaExpression *expression, SenchaTable *var_table, const SenchaBatchInput *inputs, int input_count,
+              float *out, uint32_t count);
+
+    // Compiles a script with one assignment per line. Lines can be in any order, but every variable can be assigned
+    // only once and there can't be circular dependencies. Variables which are read but not assigned are inputs and
+    // have to exist in `var_table`. Assigned variables are added to the table, also when compilation fails.
+    bool compile_program(char *script, SenchaTable *var_table, SenchaProgram *program);
+    // Recomputes lines affected by inputs changed since the last update (all lines on the first update), and
+    // returns how many were recomputed. Lines whose result didn't change don't dirty their dependents.
+    uint32_t update(SenchaProgram *program, SenchaTable *var_table);
+    void release(SenchaProgram *program);
+
+    // Optimizations rewrite compiled code without changing results, they're done the same way evaluation does them.
+    // Single lines get constant subexpressions (e.g. `3.1415 / 2.0f`) computed ahead of time.
+    SenchaOptimizationStats optimize(SenchaExpression *expression);
+    // Programs also get lines not depending on any input folded into constants for the lines reading them, and
+    // subexpressions repeated across lines (e.g. `sin(t)`) computed once, by lines assigning hidden variables #0,
+    // #1, ... which are added to `var_table`. Next update recomputes all lines. Native code is dropped, so it has
+    // to be compiled after optimizing.
+    SenchaOptimizationStats optimize(SenchaProgram *program, SenchaTable *var_table);
+
+    // Compiles a line to x86-64 machine code, so evaluation doesn't pay instruction dispatch. Values on the stack
+    // are kept in SSE registers and variables are read from and written to the table's values directly, results
+    // are the same as from the interpreter. Returns false on other architectures and for lines nested deeper than
+    // 16 values, callers then keep using the interpreter.
+    bool compile_native(SenchaExpression *expression, SenchaNativeCode *native_code);
+    // `var_table` has to be the table the line was compiled against.
+    inline float eval(SenchaNativeCode *native_code, SenchaTable *var_table) {
+        return ((SenchaNativeFunction)native_code->memory)(var_table->variable_values.data);
+    }
+    // Compiles all lines of a program, which `sencha::update` then runs instead of interpreting them. If this
+    // fails, update keeps interpreting.
+    bool compile_native(SenchaProgram *program);
+    void release(SenchaNativeCode *native_code);
 };
 
 #ifdef CPPLIB_SENCHA_IMPL
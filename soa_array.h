@@ -0,0 +1,126 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <cassert>
+#include "memory.h"
+
+// SoAArray stores every field in its own contiguous stream, so loops touching
+// only a few fields don't drag the rest through the cache. Streams are aligned
+// to `soa_stream_alignment` bytes for SIMD loads. Fields have to be trivially copyable.
+// e.g. SoAArray<Quaternion, Vector3, Vector3> transforms;
+template <typename... Fields>
+struct SoAArray {
+    uint8_t *block;
+    uint8_t *streams[sizeof...(Fields)];
+    uint32_t count;
+    uint32_t size;
+    MemoryTag tag;
+};
+
+// SoAFieldType<I, Fields...>::type is the type of I-th field.
+template <uint32_t I, typename First, typename... Rest>
+struct SoAFieldType {
+    typedef typename SoAFieldType<I - 1, Rest...>::type type;
+};
+
+template <typename First, typename... Rest>
+struct SoAFieldType<0, First, Rest...> {
+    typedef First type;
+};
+
+// `soa_array` namespace handles operations on SoAArray.
+namespace soa_array {
+    const uint32_t soa_stream_alignment = 64;
+    // soa_expansion_ratio defines the ratio of new array size to old array size when reallocating.
+    const uint32_t soa_expansion_ratio = 2;
+
+    inline uint64_t align_up(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Move streams into a new block big enough for `size` items.
+    template <typename... Fields>
+    void reserve(SoAArray<Fields...> *array, uint32_t size) {
+        if(size <= array->size && array->block) return;
+
+        const uint32_t field_count = sizeof...(Fields);
+        const uint64_t field_sizes[] = {sizeof(Fields)...};
+
+        uint64_t block_size = soa_stream_alignment;
+        for(uint32_t i = 0; i < field_count; ++i) {
+            block_size += align_up(field_sizes[i] * size, soa_stream_alignment);
+        }
+        // Heap allocations take 32-bit sizes.
+        assert(block_size <= UINT32_MAX);
+        uint8_t *block = memory::alloc_heap<uint8_t>(uint32_t(block_size), array->tag);
+        assert(block);
+
+        uint8_t *stream = (uint8_t *)align_up(uint64_t(uintptr_t(block)), soa_stream_alignment);
+        for(uint32_t i = 0; i < field_count; ++i) {
+            if(array->block) {
+                memcpy(stream, array->streams[i], field_sizes[i] * array->count);
+            }
+            array->streams[i] = stream;
+            stream += align_up(field_sizes[i] * size, soa_stream_alignment);
+        }
+
+        if(array->block) {
+            memory::track_array_growth(array->tag);
+            memory::free_heap(array->block, array->tag);
+        }
+        array->block = block;
+        array->size = size;
+    }
+
+    //  Initialize SoAArray
+    template <typename... Fields>
+    void init(SoAArray<Fields...> *array, uint32_t size, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        *array = SoAArray<Fields...>{};
+        array->tag = tag;
+        soa_array::reserve(array, size > 0 ? size : 1);
+    }
+
+    //  Returns initialized SoAArray
+    template <typename... Fields>
+    SoAArray<Fields...> get(uint32_t size, MemoryTag tag = MEMORY_TAG_GENERAL) {
+        SoAArray<Fields...> array;
+        soa_array::init(&array, size, tag);
+        return array;
+    }
+
+    // Reset the array, does not deallocate allocated memory
+    template <typename... Fields>
+    void reset(SoAArray<Fields...> *array) {
+        array->count = 0;
+    }
+
+    // Returns pointer to the start of I-th field's stream.
+    template <uint32_t I, typename... Fields>
+    typename SoAFieldType<I, Fields...>::type *get_stream(SoAArray<Fields...> *array) {
+        return (typename SoAFieldType<I, Fields...>::type *)array->streams[I];
+    }
+
+    // Add an element into array, each field goes into its own stream.
+    template <typename... Fields>
+    void add(SoAArray<Fields...> *array, Fields... values) {
+        if(array->size == array->count) {
+            // Released or zero-initialized arrays have no room yet.
+            soa_array::reserve(array, array->size > 0 ? array->size * soa_expansion_ratio : 1);
+        }
+
+        const uint32_t field_count = sizeof...(Fields);
+        const uint64_t field_sizes[] = {sizeof(Fields)...};
+        const void *field_values[] = {&values...};
+        for(uint32_t i = 0; i < field_count; ++i) {
+            memcpy(array->streams[i] + field_sizes[i] * array->count, field_values[i], field_sizes[i]);
+        }
+        array->count++;
+    }
+
+    // Completely release the array, freeing all the memory
+    template <typename... Fields>
+    void release(SoAArray<Fields...> *array) {
+        memory::free_heap(array->block, array->tag);
+        *array = SoAArray<Fields...>{};
+    }
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#include "array.h"
+#include "soa_array.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+struct Item {
+    float value;
+    int id;
+    char text[100];
+};
+
+int main(int argc, char *argv[]) {
+    printf("ARRAY:\n");
+    {
+        Array<int> numbers = array::get<int>(4);
+        for(int i = 0; i < 100; ++i) array::add(&numbers, i);
+        bool ok = numbers.count == 100 && numbers.size == 128;
+        for(int i = 0; i < 100; ++i) ok = ok && numbers[i] == i;
+        CHECK("add grows and keeps contents", ok);
+
+        array::add(&numbers, numbers[0]);
+        array::reset(&numbers);
+        for(uint32_t i = 0; i < numbers.size; ++i) array::add(&numbers, int(i));
+        array::add(&numbers, numbers[5]);
+        CHECK("add of own element while growing", numbers[numbers.count - 1] == 5);
+
+        array::reserve(&numbers, 1000);
+        CHECK("reserve", numbers.size == 1000 && numbers.count == 129);
+
+        array::resize(&numbers, 10);
+        CHECK("resize shrinks count only", numbers.count == 10 && numbers.size == 1000);
+
+        int bulk[2000];
+        for(int i = 0; i < 2000; ++i) bulk[i] = i * 2;
+        uint64_t grow_count = memory::get_stats(MEMORY_TAG_GENERAL).array_grow_count;
+        array::add_n(&numbers, bulk, 2000);
+        CHECK("add_n grows once", memory::get_stats(MEMORY_TAG_GENERAL).array_grow_count == grow_count + 1);
+        CHECK("add_n copies items", numbers.count == 2010 && numbers[2009] == 3998);
+
+        array::release(&numbers);
+        array::add(&numbers, 7);
+        CHECK("add after release", numbers.count == 1 && numbers[0] == 7);
+        array::release(&numbers);
+    }
+
+    printf("EMPLACE:\n");
+    {
+        Array<Item> items = array::get<Item>(1);
+        Item *item = array::emplace(&items, 1.5f, 3);
+        snprintf(item->text, 100, "item %d", item->id);
+        array::emplace(&items, 2.5f, 4);
+        CHECK("emplace constructs in place", items.count == 2 && items[0].id == 3 && items[1].value == 2.5f);
+        CHECK("emplace zero-fills remaining fields", items[1].text[0] == 0 && strcmp(items[0].text, "item 3") == 0);
+        array::release(&items);
+    }
+
+    printf("INLINE ARRAY:\n");
+    {
+        memory::reset_stats();
+        InlineArray<int, 16> numbers;
+        array::init(&numbers);
+        for(int i = 0; i < 16; ++i) array::add(&numbers, i);
+        CHECK("inline storage does not allocate", memory::get_stats(MEMORY_TAG_GENERAL).heap_alloc_count == 0);
+        CHECK("inline storage used", numbers.data == numbers.inline_data);
+
+        array::add(&numbers, 16);
+        bool ok = numbers.data != numbers.inline_data && numbers.storage == ARRAY_STORAGE_HEAP;
+        for(int i = 0; i < 17; ++i) ok = ok && numbers[i] == i;
+        CHECK("moves to heap when full", ok);
+        array::release(&numbers);
+    }
+
+    printf("ARENA ARRAY:\n");
+    {
+        StackAllocator frame_allocator = memory::get_stack_allocator(MEGABYTES(64), MEMORY_TAG_UI);
+        memory::reset_stats();
+        Array<int> first = array::get<int>(4, &frame_allocator);
+        for(int i = 0; i < 100; ++i) array::add(&first, i);
+        CHECK("array on top of arena grows in place", first.data == frame_allocator.storage);
+        CHECK("arena array does not touch heap", memory::get_stats(MEMORY_TAG_UI).heap_alloc_count == 0);
+
+        Array<int> second = array::get<int>(4, &frame_allocator);
+        while(first.count < first.size) array::add(&first, int(first.count));
+        array::add(&first, int(first.count));
+        bool ok = first.data != frame_allocator.storage;
+        for(uint32_t i = 0; i < first.count; ++i) ok = ok && first[i] == int(i);
+        CHECK("array below arena top moves", ok);
+
+        uint32_t first_size = first.size;
+        memory::load_stack_state(&frame_allocator, 0);
+        array::init(&first, first_size, &frame_allocator);
+        array::init(&second, second.size, &frame_allocator);
+        CHECK("reset as a whole", first.data == frame_allocator.storage && first.count == 0);
+        memory::release_stack_allocator(&frame_allocator);
+    }
+
+    printf("SOA ARRAY:\n");
+    {
+        struct Quat {
+            float x, y, z, w;
+        };
+        SoAArray<Quat, float, uint8_t> transforms = soa_array::get<Quat, float, uint8_t>(2);
+        for(int i = 0; i < 1000; ++i) {
+            soa_array::add(&transforms, Quat{float(i), 0.0f, 0.0f, 1.0f}, float(i) * 0.5f, uint8_t(i));
+        }
+        Quat *rotations = soa_array::get_stream<0>(&transforms);
+        float *scales = soa_array::get_stream<1>(&transforms);
+        uint8_t *flags = soa_array::get_stream<2>(&transforms);
+
+        bool ok = transforms.count == 1000;
+        for(int i = 0; i < 1000; ++i) {
+            ok = ok && rotations[i].x == float(i) && rotations[i].w == 1.0f;
+            ok = ok && scales[i] == float(i) * 0.5f && flags[i] == uint8_t(i);
+        }
+        CHECK("fields survive growth", ok);
+        CHECK("streams are aligned", ((uintptr_t)rotations % 64) == 0 && ((uintptr_t)scales % 64) == 0 &&
+                                     ((uintptr_t)flags % 64) == 0);
+
+        soa_array::reset(&transforms);
+        CHECK("reset", transforms.count == 0 && transforms.size == 1024);
+        soa_array::release(&transforms);
+
+        for(int i = 0; i < 3; ++i) {
+            soa_array::add(&transforms, Quat{float(i), 0.0f, 0.0f, 1.0f}, float(i), uint8_t(i));
+        }
+        scales = soa_array::get_stream<1>(&transforms);
+        CHECK("add after release", transforms.count == 3 && transforms.size >= 3 && scales[0] == 0.0f &&
+                                   scales[2] == 2.0f);
+        soa_array::release(&transforms);
+    }
+
+    return 0;
+}
\ No newline at end of file
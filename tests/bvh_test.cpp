@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#define CPPLIB_JOBS_IMPL
+#include "jobs.h"
+#define CPPLIB_MATHS_IMPL
+#include "maths.h"
+#define CPPLIB_BVH_IMPL
+#include "bvh.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+
+Test scenes and brute force reference.
+
+*/
+
+const uint32_t BOX_COUNT = 20000;
+const uint32_t TRIANGLE_COUNT = 200000;
+const uint32_t RAY_COUNT = 4096;
+// Brute force over all triangles is slow, only every n-th ray is checked against it.
+const uint32_t TRIANGLE_RAY_STRIDE = 32;
+
+AABB boxes[BOX_COUNT];
+Vector3 vertices[TRIANGLE_COUNT * 3];
+Vector3 origins[RAY_COUNT];
+Vector3 directions[RAY_COUNT];
+RayHit hits[RAY_COUNT];
+RayHit reference_hits[RAY_COUNT];
+
+// Prevents the compiler from throwing the benchmark loops away.
+volatile uint32_t sink;
+
+// Small triangles scattered around the origin, like a scene full of little meshes.
+void generate_triangles(uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        Vector3 center = Vector3(math::random_uniform(-50.0f, 50.0f), math::random_uniform(-50.0f, 50.0f), math::random_uniform(-50.0f, 50.0f));
+        for(uint32_t j = 0; j < 3; ++j) {
+            vertices[i * 3 + j] = center + Vector3(math::random_uniform(-1.0f, 1.0f), math::random_uniform(-1.0f, 1.0f), math::random_uniform(-1.0f, 1.0f));
+        }
+    }
+}
+
+void generate_boxes(uint32_t count) {
+    for(uint32_t i = 0; i < count; ++i) {
+        Vector3 center = Vector3(math::random_uniform(-50.0f, 50.0f), math::random_uniform(-50.0f, 50.0f), math::random_uniform(-50.0f, 50.0f));
+        boxes[i] = AABB{center, Vector3(math::random_uniform(0.1f, 1.0f), math::random_uniform(0.1f, 1.0f), math::random_uniform(0.1f, 1.0f))};
+    }
+}
+
+// Rays from a camera outside the scene, neighbouring rays are coherent like pixels of an image.
+void generate_rays(uint32_t count) {
+    Vector3 eye = Vector3(0.0f, 10.0f, 120.0f);
+    uint32_t width = 64;
+    for(uint32_t i = 0; i < count; ++i) {
+        float x = (float)(i % width) / width - 0.5f;
+        float y = (float)(i / width) / (count / width) - 0.5f;
+        origins[i] = eye;
+        directions[i] = math::normalize(Vector3(x, y - 0.1f, -1.0f));
+    }
+}
+
+RayHit brute_force_boxes(Vector3 origin, Vector3 direction, uint32_t count) {
+    RayHit result = {FLT_MAX, BVH_NO_HIT};
+    for(uint32_t i = 0; i < count; ++i) {
+        float distance = math::ray_aabb_intersection(origin, direction, boxes[i]);
+        if(distance >= 0.0f && distance < result.distance) result = RayHit{distance, i};
+    }
+    return result;
+}
+
+RayHit brute_force_triangles(Vector3 origin, Vector3 direction, uint32_t count) {
+    RayHit result = {FLT_MAX, BVH_NO_HIT};
+    for(uint32_t i = 0; i < count; ++i) {
+        float distance = math::ray_triangle_intersection(origin, direction, vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+        if(distance >= 0.0f && distance < result.distance) result = RayHit{distance, i};
+    }
+    return result;
+}
+
+// Primitives can differ when two of them are hit at the same distance.
+bool equal(RayHit a, RayHit b) {
+    if(a.primitive == BVH_NO_HIT || b.primitive == BVH_NO_HIT) return a.primitive == b.primitive;
+    return fabsf(a.distance - b.distance) <= 1e-4f * fmaxf(1.0f, b.distance);
+}
+
+bool is_tree_valid(BVH *bvh) {
+    // Every primitive is referenced once and every node contains its children and primitives.
+    uint32_t *references = memory::alloc_heap<uint32_t>(bvh->primitive_count);
+    memset(references, 0, bvh->primitive_count * sizeof(uint32_t));
+    bool valid = true;
+    for(uint32_t i = 0; i < bvh->node_count; ++i) {
+        BVHNode *node = &bvh->nodes[i];
+        if(node->count) {
+            for(uint32_t j = node->first; j < node->first + node->count; ++j) {
+                uint32_t primitive = bvh->primitive_indices[j];
+                references[primitive]++;
+                if(bvh->type != BVH_BOXES) continue;
+                Vector3 lower = boxes[primitive].center - boxes[primitive].extents;
+                Vector3 upper = boxes[primitive].center + boxes[primitive].extents;
+                for(int axis = 0; axis < 3; ++axis) {
+                    valid = valid && lower[axis] >= node->lower[axis] && upper[axis] <= node->upper[axis];
+                }
+            }
+        } else {
+            valid = valid && node->first > i && node->first + 1 < bvh->node_count;
+            for(uint32_t child = node->first; child < node->first + 2 && valid; ++child) {
+                for(int axis = 0; axis < 3; ++axis) {
+                    valid = valid && bvh->nodes[child].lower[axis] >= node->lower[axis] && bvh->nodes[child].upper[axis] <= node->upper[axis];
+                }
+            }
+        }
+    }
+    for(uint32_t i = 0; i < bvh->primitive_count; ++i) valid = valid && references[i] == 1;
+    memory::free_heap(references);
+    return valid;
+}
+
+int main() {
+    math::random_seed(1);
+    generate_boxes(BOX_COUNT);
+    generate_triangles(TRIANGLE_COUNT);
+    generate_rays(RAY_COUNT);
+
+    // Box scene.
+    {
+        BVH bvh = bvh::build(boxes, BOX_COUNT);
+        CHECK("box tree is valid", is_tree_valid(&bvh));
+
+        bool closest_correct = true;
+        bool any_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT; ++i) {
+            RayHit hit = {FLT_MAX, BVH_NO_HIT};
+            bvh::intersect(&bvh, origins[i], directions[i], &hit);
+            reference_hits[i] = brute_force_boxes(origins[i], directions[i], BOX_COUNT);
+            closest_correct = closest_correct && equal(hit, reference_hits[i]);
+            bool any = bvh::intersect_any(&bvh, origins[i], directions[i]);
+            any_correct = any_correct && any == (reference_hits[i].primitive != BVH_NO_HIT);
+            if(reference_hits[i].primitive != BVH_NO_HIT) {
+                // Nothing is hit before the closest hit.
+                any_correct = any_correct && !bvh::intersect_any(&bvh, origins[i], directions[i], reference_hits[i].distance * 0.999f);
+            }
+        }
+        CHECK("box closest hit matches brute force", closest_correct);
+        CHECK("box any hit matches brute force", any_correct);
+
+        bvh::intersect(&bvh, origins, directions, RAY_COUNT - 3, hits);
+        bool packets_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT - 3; ++i) packets_correct = packets_correct && equal(hits[i], reference_hits[i]);
+        CHECK("box packets match brute force", packets_correct);
+
+        RayHit hit;
+        CHECK("ray starting inside a box hits it at 0",
+              bvh::intersect(&bvh, boxes[7].center, Vector3(0.0f, 1.0f, 0.0f), &hit) && hit.distance == 0.0f);
+
+        // Move every box and refit.
+        for(uint32_t i = 0; i < BOX_COUNT; ++i) {
+            boxes[i].center = boxes[i].center + Vector3(math::random_uniform(-5.0f, 5.0f), math::random_uniform(-5.0f, 5.0f), math::random_uniform(-5.0f, 5.0f));
+        }
+        bvh::refit(&bvh);
+        CHECK("refit tree is valid", is_tree_valid(&bvh));
+        bool refit_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT; ++i) {
+            RayHit hit = {FLT_MAX, BVH_NO_HIT};
+            bvh::intersect(&bvh, origins[i], directions[i], &hit);
+            refit_correct = refit_correct && equal(hit, brute_force_boxes(origins[i], directions[i], BOX_COUNT));
+        }
+        CHECK("refit closest hit matches brute force", refit_correct);
+        bvh::release(&bvh);
+    }
+
+    // Triangle scene, with and without index buffer.
+    {
+        BVH bvh = bvh::build(vertices, NULL, TRIANGLE_COUNT);
+        CHECK("triangle tree is valid", is_tree_valid(&bvh));
+
+        bool closest_correct = true;
+        bool any_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT; i += TRIANGLE_RAY_STRIDE) {
+            RayHit hit = {FLT_MAX, BVH_NO_HIT};
+            bvh::intersect(&bvh, origins[i], directions[i], &hit);
+            reference_hits[i] = brute_force_triangles(origins[i], directions[i], TRIANGLE_COUNT);
+            closest_correct = closest_correct && equal(hit, reference_hits[i]);
+            any_correct = any_correct && bvh::intersect_any(&bvh, origins[i], directions[i]) == (reference_hits[i].primitive != BVH_NO_HIT);
+        }
+        CHECK("triangle closest hit matches brute force", closest_correct);
+        CHECK("triangle any hit matches brute force", any_correct);
+
+        bvh::intersect(&bvh, origins, directions, RAY_COUNT, hits);
+        bool packets_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT; i += TRIANGLE_RAY_STRIDE) packets_correct = packets_correct && equal(hits[i], reference_hits[i]);
+        CHECK("triangle packets match brute force", packets_correct);
+        bvh::release(&bvh);
+
+        uint32_t *indices = memory::alloc_heap<uint32_t>(TRIANGLE_COUNT * 3);
+        for(uint32_t i = 0; i < TRIANGLE_COUNT * 3; ++i) indices[i] = TRIANGLE_COUNT * 3 - 1 - i;
+        bvh = bvh::build(vertices, indices, TRIANGLE_COUNT);
+        bool indexed_correct = true;
+        for(uint32_t i = 0; i < RAY_COUNT; i += TRIANGLE_RAY_STRIDE) {
+            RayHit hit = {FLT_MAX, BVH_NO_HIT};
+            bvh::intersect(&bvh, origins[i], directions[i], &hit);
+            indexed_correct = indexed_correct && equal(hit, reference_hits[i]);
+        }
+        CHECK("indexed triangles", indexed_correct);
+        bvh::release(&bvh);
+        memory::free_heap(indices);
+    }
+
+    {
+        BVH bvh = bvh::build(boxes, 0);
+        RayHit hit;
+        bvh::intersect(&bvh, origins, directions, 5, hits);
+        CHECK("empty tree has no hits", !bvh::intersect(&bvh, origins[0], directions[0], &hit) &&
+                                        !bvh::intersect_any(&bvh, origins[0], directions[0]) && hits[4].primitive == BVH_NO_HIT);
+        bvh::release(&bvh);
+
+        bvh = bvh::build(boxes, 1);
+        CHECK("single box tree", bvh::intersect(&bvh, boxes[0].center + Vector3(0.0f, 0.0f, 10.0f), Vector3(0.0f, 0.0f, -1.0f), &hit) &&
+                                 hit.primitive == 0 && fabsf(hit.distance - (10.0f - boxes[0].extents.z)) < 1e-4f);
+        bvh::release(&bvh);
+    }
+
+    /*
+
+    Benchmarks.
+
+    */
+
+    {
+        double start = get_time_ms();
+        BVH bvh = bvh::build(vertices, NULL, TRIANGLE_COUNT);
+        double build_time = get_time_ms() - start;
+
+        uint32_t sum = 0;
+        start = get_time_ms();
+        for(uint32_t i = 0; i < RAY_COUNT; i += 64) sum += brute_force_triangles(origins[i], directions[i], TRIANGLE_COUNT).primitive;
+        double brute_force_time = (get_time_ms() - start) * 64;
+
+        start = get_time_ms();
+        for(uint32_t i = 0; i < RAY_COUNT; ++i) bvh::intersect(&bvh, origins[i], directions[i], &hits[i]);
+        double single_time = get_time_ms() - start;
+
+        start = get_time_ms();
+        for(uint32_t i = 0; i < RAY_COUNT; ++i) sum += bvh::intersect_any(&bvh, origins[i], directions[i]);
+        double any_time = get_time_ms() - start;
+        sink = sum;
+
+        start = get_time_ms();
+        bvh::intersect(&bvh, origins, directions, RAY_COUNT, hits);
+        double packet_time = get_time_ms() - start;
+
+        start = get_time_ms();
+        bvh::refit(&bvh);
+        double refit_time = get_time_ms() - start;
+        bvh::release(&bvh);
+
+        jobs::init();
+        uint32_t thread_count = jobs::get_thread_count();
+        start = get_time_ms();
+        bvh = bvh::build(vertices, NULL, TRIANGLE_COUNT);
+        double threaded_build_time = get_time_ms() - start;
+        bool threaded_correct = is_tree_valid(&bvh);
+        start = get_time_ms();
+        bvh::intersect(&bvh, origins, directions, RAY_COUNT, hits);
+        double threaded_packet_time = get_time_ms() - start;
+        for(uint32_t i = 0; i < RAY_COUNT; i += TRIANGLE_RAY_STRIDE) threaded_correct = threaded_correct && equal(hits[i], reference_hits[i]);
+        bvh::release(&bvh);
+        jobs::release();
+        CHECK("threaded build and packets", threaded_correct);
+
+        printf("%u triangles, %u rays (threads: %u)\n", TRIANGLE_COUNT, RAY_COUNT, thread_count);
+        printf("build:                %8.2f ms, threaded: %8.2f ms, refit: %8.2f ms\n", build_time, threaded_build_time, refit_time);
+        printf("brute force:          %8.2f ms (estimated from every 64th ray)\n", brute_force_time);
+        printf("closest hit:          %8.2f ms, any hit: %8.2f ms\n", single_time, any_time);
+        printf("packets:              %8.2f ms, threaded: %8.2f ms\n", packet_time, threaded_packet_time);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <chrono>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#include "hash_map.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+/*
+
+Baseline for benchmarks: fixed-size table as used in freezer/resources.cpp.
+
+*/
+
+typedef uint32_t sid;
+
+template <typename T, uint32_t N>
+struct Table {
+    sid sids[N];
+    T items[N];
+};
+
+template <uint32_t N>
+uint32_t hash_to_n(uint32_t num) {
+    return (uint32_t)num % N;
+}
+
+namespace table {
+    template<typename T, uint32_t N>
+    uint32_t get_slot(Table<T, N> *table, sid id) {
+        uint32_t hash = hash_to_n<N>(id);
+        while (id != table->sids[hash]) {
+            hash = hash_to_n<N>(hash + 1);
+        }
+        return hash;
+    }
+
+    template<typename T, uint32_t N>
+    uint32_t get_free_slot(Table<T, N> *table, sid id) {
+        uint32_t hash = hash_to_n<N>(id);
+        while (table->sids[hash] && id != table->sids[hash]) {
+            hash = hash_to_n<N>(hash + 1);
+        }
+        return hash;
+    }
+
+    template <typename T, uint32_t N>
+    void add(Table<T, N> *table, sid id, T item) {
+        uint32_t hash = table::get_free_slot(table, id);
+        table->sids[hash] = id;
+        table->items[hash] = item;
+    }
+
+    template <typename T, uint32_t N>
+    T *get(Table<T, N> *table, sid id) {
+        uint32_t hash = table::get_slot(table, id);
+        return &(table->items[hash]);
+    }
+}
+
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Keys look like asset sids - 32-bit hashes of names.
+uint32_t get_sid(uint32_t i) {
+    return hash_map::hash_key(i * 2654435761u) | 1;
+}
+
+// Insert `item_count` sids into Table and HashMap and look them up, returns whether the results agree.
+bool benchmark(uint32_t item_count) {
+    const uint32_t LOOKUP_COUNT = 1 << 20;
+    static Table<uint32_t, 2048> table;
+    memset(&table, 0, sizeof(table));
+    HashMap<uint32_t, uint32_t> map = hash_map::get<uint32_t, uint32_t>();
+
+    double start = get_time_ms();
+    for(uint32_t i = 0; i < item_count; ++i) table::add(&table, get_sid(i), i);
+    double table_insert = get_time_ms() - start;
+
+    start = get_time_ms();
+    for(uint32_t i = 0; i < item_count; ++i) hash_map::set(&map, get_sid(i), i);
+    double map_insert = get_time_ms() - start;
+
+    uint32_t sum_table = 0;
+    start = get_time_ms();
+    for(uint32_t i = 0; i < LOOKUP_COUNT; ++i) sum_table += *table::get(&table, get_sid(i % item_count));
+    double table_lookup = get_time_ms() - start;
+
+    uint32_t sum_map = 0;
+    start = get_time_ms();
+    for(uint32_t i = 0; i < LOOKUP_COUNT; ++i) sum_map += *hash_map::find(&map, get_sid(i % item_count));
+    double map_lookup = get_time_ms() - start;
+
+    printf("%4u items %-16s insert %8.3f ms, lookup %8.3f ms\n", item_count, "Table<T, 2048>", table_insert, table_lookup);
+    printf("%4u items %-16s insert %8.3f ms, lookup %8.3f ms\n", item_count, "HashMap<K, V>", map_insert, map_lookup);
+    hash_map::release(&map);
+    return sum_table == sum_map;
+}
+
+int main(int argc, char *argv[]) {
+    printf("HASH MAP:\n");
+    {
+        HashMap<uint32_t, int> map = hash_map::get<uint32_t, int>();
+        for(int i = 0; i < 10000; ++i) hash_map::set(&map, uint32_t(i), i * 3);
+        CHECK("set grows with load factor", map.count == 10000 && map.count <= map.capacity * hash_map::max_load_factor);
+
+        bool ok = true;
+        for(int i = 0; i < 10000; ++i) {
+            int *value = hash_map::find(&map, uint32_t(i));
+            ok = ok && value && *value == i * 3;
+        }
+        CHECK("find all", ok);
+        CHECK("missing key returns NULL", hash_map::find(&map, 123456u) == NULL);
+
+        hash_map::set(&map, 5u, -1);
+        CHECK("set overwrites", *hash_map::find(&map, 5u) == -1 && map.count == 10000);
+
+        for(int i = 0; i < 10000; i += 2) hash_map::remove(&map, uint32_t(i));
+        ok = map.count == 5000;
+        for(int i = 0; i < 10000; ++i) {
+            ok = ok && (hash_map::contains(&map, uint32_t(i)) == (i % 2 == 1));
+        }
+        CHECK("remove with backward shift", ok);
+        CHECK("remove missing key", !hash_map::remove(&map, 0u));
+
+        hash_map::reset(&map);
+        CHECK("reset", map.count == 0 && !hash_map::contains(&map, 1u));
+        hash_map::release(&map);
+    }
+
+    printf("BENCHMARK (1M lookups):\n");
+    {
+        // Table is fixed at 2048 slots, so it gets slower as it fills up.
+        bool half_full = benchmark(1024);
+        bool nearly_full = benchmark(1940);
+        CHECK("same results", half_full && nearly_full);
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#define CPPLIB_JOBS_IMPL
+#include "jobs.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+
+Job functions used by tests.
+
+*/
+
+void increment(void *data) {
+    std::atomic<uint32_t> *value = (std::atomic<uint32_t> *)data;
+    value->fetch_add(1);
+}
+
+void square_range(void *data, uint32_t start, uint32_t end) {
+    uint32_t *values = (uint32_t *)data;
+    for(uint32_t i = start; i < end; ++i) {
+        values[i] = i * i;
+    }
+}
+
+// Every job spawns more jobs and waits on them from inside a worker.
+struct NestedData {
+    std::atomic<uint32_t> *leaf_count;
+    uint32_t depth;
+};
+
+void nested(void *data) {
+    NestedData *nested_data = (NestedData *)data;
+    if(nested_data->depth == 0) {
+        nested_data->leaf_count->fetch_add(1);
+        return;
+    }
+
+    NestedData children[4];
+    JobCounter counter = {};
+    for(uint32_t i = 0; i < 4; ++i) {
+        children[i] = NestedData{nested_data->leaf_count, nested_data->depth - 1};
+        jobs::run(nested, &children[i], &counter);
+    }
+    jobs::wait(&counter);
+}
+
+const uint32_t WORK_COUNT = 1 << 20;
+
+void heavy_range(void *data, uint32_t start, uint32_t end) {
+    float *values = (float *)data;
+    for(uint32_t i = start; i < end; ++i) {
+        float x = float(i);
+        for(uint32_t j = 0; j < 32; ++j) {
+            x = sqrtf(x + 1.0f);
+        }
+        values[i] = x;
+    }
+}
+
+int main() {
+    // Without init everything runs inline.
+    {
+        std::atomic<uint32_t> value(0);
+        JobCounter counter = {};
+        jobs::run(increment, &value, &counter);
+        jobs::wait(&counter);
+        CHECK("run without init executes inline", value == 1 && counter.pending == 0);
+    }
+
+    jobs::init();
+    printf("Job system threads: %u\n", jobs::get_thread_count());
+
+    {
+        std::atomic<uint32_t> value(0);
+        JobCounter counter = {};
+        for(uint32_t i = 0; i < 10000; ++i) {
+            jobs::run(increment, &value, &counter);
+        }
+        jobs::wait(&counter);
+        CHECK("counter waits for all jobs", value == 10000 && counter.pending == 0);
+    }
+
+    {
+        // More jobs than deque can hold, overflow runs inline.
+        std::atomic<uint32_t> value(0);
+        JobCounter counter = {};
+        for(uint32_t i = 0; i < 20000; ++i) {
+            jobs::run(increment, &value, &counter);
+        }
+        jobs::wait(&counter);
+        CHECK("deque overflow", value == 20000);
+    }
+
+    {
+        std::atomic<uint32_t> value(0);
+        JobCounter counter = {};
+        std::thread outside([&]() {
+            for(uint32_t i = 0; i < 1000; ++i) {
+                jobs::run(increment, &value, &counter);
+            }
+        });
+        outside.join();
+        jobs::wait(&counter);
+        CHECK("jobs from non-worker thread", value == 1000);
+    }
+
+    {
+        std::atomic<uint32_t> leaf_count(0);
+        NestedData root = {&leaf_count, 5};
+        JobCounter counter = {};
+        jobs::run(nested, &root, &counter);
+        jobs::wait(&counter);
+        CHECK("nested jobs", leaf_count == 4 * 4 * 4 * 4 * 4);
+    }
+
+    {
+        uint32_t *values = memory::alloc_heap<uint32_t>(100003);
+        jobs::parallel_for(100003, square_range, values, 64);
+        bool correct = true;
+        for(uint32_t i = 0; i < 100003; ++i) {
+            correct = correct && values[i] == i * i;
+        }
+        memory::free_heap(values);
+        CHECK("parallel_for covers whole range", correct);
+    }
+
+    {
+        float *serial = memory::alloc_heap<float>(WORK_COUNT);
+        float *parallel = memory::alloc_heap<float>(WORK_COUNT);
+
+        double start = get_time_ms();
+        heavy_range(serial, 0, WORK_COUNT);
+        double serial_time = get_time_ms() - start;
+
+        start = get_time_ms();
+        jobs::parallel_for(WORK_COUNT, heavy_range, parallel, 1024);
+        double parallel_time = get_time_ms() - start;
+
+        bool same = memcmp(serial, parallel, WORK_COUNT * sizeof(float)) == 0;
+        printf("Serial: %.2f ms, parallel_for: %.2f ms\n", serial_time, parallel_time);
+        memory::free_heap(serial);
+        memory::free_heap(parallel);
+        CHECK("parallel_for matches serial result", same);
+    }
+
+    jobs::release();
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,822 @@
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <stdlib.h>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#define CPPLIB_JOBS_IMPL
+#include "jobs.h"
+#define CPPLIB_MATHS_JOBS
+#define CPPLIB_MATHS_IMPL
+#include "maths.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+
+Scalar code maths.h used before the SIMD paths, used to check results and as benchmark baseline.
+
+*/
+
+Matrix4x4 scalar_multiply(Matrix4x4 a, Matrix4x4 m) {
+    Matrix4x4 result;
+    result[0] = a[0] * m[0] + a[4] * m[1] + a[8] * m[2] + a[12] * m[3];
+    result[1] = a[1] * m[0] + a[5] * m[1] + a[9] * m[2] + a[13] * m[3];
+    result[2] = a[2] * m[0] + a[6] * m[1] + a[10] * m[2] + a[14] * m[3];
+    result[3] = a[3] * m[0] + a[7] * m[1] + a[11] * m[2] + a[15] * m[3];
+
+    result[4] = a[0] * m[4] + a[4] * m[5] + a[8] * m[6] + a[12] * m[7];
+    result[5] = a[1] * m[4] + a[5] * m[5] + a[9] * m[6] + a[13] * m[7];
+    result[6] = a[2] * m[4] + a[6] * m[5] + a[10] * m[6] + a[14] * m[7];
+    result[7] = a[3] * m[4] + a[7] * m[5] + a[11] * m[6] + a[15] * m[7];
+
+    result[8] = a[0] * m[8] + a[4] * m[9] + a[8] * m[10] + a[12] * m[11];
+    result[9] = a[1] * m[8] + a[5] * m[9] + a[9] * m[10] + a[13] * m[11];
+    result[10] = a[2] * m[8] + a[6] * m[9] + a[10] * m[10] + a[14] * m[11];
+    result[11] = a[3] * m[8] + a[7] * m[9] + a[11] * m[10] + a[15] * m[11];
+
+    result[12] = a[0] * m[12] + a[4] * m[13] + a[8] * m[14] + a[12] * m[15];
+    result[13] = a[1] * m[12] + a[5] * m[13] + a[9] * m[14] + a[13] * m[15];
+    result[14] = a[2] * m[12] + a[6] * m[13] + a[10] * m[14] + a[14] * m[15];
+    result[15] = a[3] * m[12] + a[7] * m[13] + a[11] * m[14] + a[15] * m[15];
+    return result;
+}
+
+Vector4 scalar_multiply(Matrix4x4 a, Vector4 v) {
+    Vector4 result;
+    result[0] = a[0] * v[0] + a[4] * v[1] + a[8] * v[2] + a[12] * v[3];
+    result[1] = a[1] * v[0] + a[5] * v[1] + a[9] * v[2] + a[13] * v[3];
+    result[2] = a[2] * v[0] + a[6] * v[1] + a[10] * v[2] + a[14] * v[3];
+    result[3] = a[3] * v[0] + a[7] * v[1] + a[11] * v[2] + a[15] * v[3];
+    return result;
+}
+
+Matrix4x4 scalar_transpose(Matrix4x4 m) {
+    Matrix4x4 result = {};
+    result[0]  = m[0];
+    result[1]  = m[4];
+    result[2]  = m[8];
+    result[3]  = m[12];
+
+    result[4]  = m[1];
+    result[5]  = m[5];
+    result[6]  = m[9];
+    result[7]  = m[13];
+
+    result[8]  = m[2];
+    result[9]  = m[6];
+    result[10] = m[10];
+    result[11] = m[14];
+
+    result[12] = m[3];
+    result[13] = m[7];
+    result[14] = m[11];
+    result[15] = m[15];
+
+    return result;
+}
+
+Matrix4x4 scalar_invert(Matrix4x4 m) {
+    Matrix4x4 inv;
+    float det;
+
+    inv[0] = m[5] * m[10] * m[15] -
+        m[5] * m[11] * m[14] -
+        m[9] * m[6] * m[15] +
+        m[9] * m[7] * m[14] +
+        m[13] * m[6] * m[11] -
+        m[13] * m[7] * m[10];
+
+    inv[4] = -m[4] * m[10] * m[15] +
+        m[4] * m[11] * m[14] +
+        m[8] * m[6] * m[15] -
+        m[8] * m[7] * m[14] -
+        m[12] * m[6] * m[11] +
+        m[12] * m[7] * m[10];
+
+    inv[8] = m[4] * m[9] * m[15] -
+        m[4] * m[11] * m[13] -
+        m[8] * m[5] * m[15] +
+        m[8] * m[7] * m[13] +
+        m[12] * m[5] * m[11] -
+        m[12] * m[7] * m[9];
+
+    inv[12] = -m[4] * m[9] * m[14] +
+        m[4] * m[10] * m[13] +
+        m[8] * m[5] * m[14] -
+        m[8] * m[6] * m[13] -
+        m[12] * m[5] * m[10] +
+        m[12] * m[6] * m[9];
+
+    inv[1] = -m[1] * m[10] * m[15] +
+        m[1] * m[11] * m[14] +
+        m[9] * m[2] * m[15] -
+        m[9] * m[3] * m[14] -
+        m[13] * m[2] * m[11] +
+        m[13] * m[3] * m[10];
+
+    inv[5] = m[0] * m[10] * m[15] -
+        m[0] * m[11] * m[14] -
+        m[8] * m[2] * m[15] +
+        m[8] * m[3] * m[14] +
+        m[12] * m[2] * m[11] -
+        m[12] * m[3] * m[10];
+
+    inv[9] = -m[0] * m[9] * m[15] +
+        m[0] * m[11] * m[13] +
+        m[8] * m[1] * m[15] -
+        m[8] * m[3] * m[13] -
+        m[12] * m[1] * m[11] +
+        m[12] * m[3] * m[9];
+
+    inv[13] = m[0] * m[9] * m[14] -
+        m[0] * m[10] * m[13] -
+        m[8] * m[1] * m[14] +
+        m[8] * m[2] * m[13] +
+        m[12] * m[1] * m[10] -
+        m[12] * m[2] * m[9];
+
+    inv[2] = m[1] * m[6] * m[15] -
+        m[1] * m[7] * m[14] -
+        m[5] * m[2] * m[15] +
+        m[5] * m[3] * m[14] +
+        m[13] * m[2] * m[7] -
+        m[13] * m[3] * m[6];
+
+    inv[6] = -m[0] * m[6] * m[15] +
+        m[0] * m[7] * m[14] +
+        m[4] * m[2] * m[15] -
+        m[4] * m[3] * m[14] -
+        m[12] * m[2] * m[7] +
+        m[12] * m[3] * m[6];
+
+    inv[10] = m[0] * m[5] * m[15] -
+        m[0] * m[7] * m[13] -
+        m[4] * m[1] * m[15] +
+        m[4] * m[3] * m[13] +
+        m[12] * m[1] * m[7] -
+        m[12] * m[3] * m[5];
+
+    inv[14] = -m[0] * m[5] * m[14] +
+        m[0] * m[6] * m[13] +
+        m[4] * m[1] * m[14] -
+        m[4] * m[2] * m[13] -
+        m[12] * m[1] * m[6] +
+        m[12] * m[2] * m[5];
+
+    inv[3] = -m[1] * m[6] * m[11] +
+        m[1] * m[7] * m[10] +
+        m[5] * m[2] * m[11] -
+        m[5] * m[3] * m[10] -
+        m[9] * m[2] * m[7] +
+        m[9] * m[3] * m[6];
+
+    inv[7] = m[0] * m[6] * m[11] -
+        m[0] * m[7] * m[10] -
+        m[4] * m[2] * m[11] +
+        m[4] * m[3] * m[10] +
+        m[8] * m[2] * m[7] -
+        m[8] * m[3] * m[6];
+
+    inv[11] = -m[0] * m[5] * m[11] +
+        m[0] * m[7] * m[9] +
+        m[4] * m[1] * m[11] -
+        m[4] * m[3] * m[9] -
+        m[8] * m[1] * m[7] +
+        m[8] * m[3] * m[5];
+
+    inv[15] = m[0] * m[5] * m[10] -
+        m[0] * m[6] * m[9] -
+        m[4] * m[1] * m[10] +
+        m[4] * m[2] * m[9] +
+        m[8] * m[1] * m[6] -
+        m[8] * m[2] * m[5];
+
+    det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+
+    if (det == 0)
+        return math::get_identity();
+
+    det = 1.0f / det;
+
+    Matrix4x4 result;
+    for (int i = 0; i < 16; i++)
+        result[i] = inv[i] * det;
+
+    return result;
+}
+
+Matrix4x4 scalar_rotation(Quaternion q) {
+    q = math::normalize(q);
+
+    Matrix4x4 result = {};
+    result[0] = 1 - 2 * q.y * q.y - 2 * q.z * q.z;
+    result[1] = 2 * q.x * q.y + 2 * q.w * q.z;
+    result[2] = 2 * q.x * q.z - 2 * q.w * q.y;
+
+    result[4] = 2 * q.x * q.y - 2 * q.w * q.z;
+    result[5] = 1 - 2 * q.x * q.x - 2 * q.z * q.z;
+    result[6] = 2 * q.y * q.z + 2 * q.w * q.x;
+
+    result[8] = 2 * q.x * q.z + 2 * q.w * q.y;
+    result[9] = 2 * q.y * q.z - 2 * q.w * q.x;
+    result[10] = 1 - 2 * q.x * q.x - 2 * q.y * q.y;
+
+    result[15] = 1;
+    return result;
+}
+
+bool equal(Matrix4x4 a, Matrix4x4 b, float epsilon = 1e-4f) {
+    for(int i = 0; i < 16; ++i) {
+        if(fabsf(a[i] - b[i]) > epsilon * fmaxf(1.0f, fabsf(b[i]))) return false;
+    }
+    return true;
+}
+
+bool equal(Vector4 a, Vector4 b, float epsilon = 1e-4f) {
+    for(int i = 0; i < 4; ++i) {
+        if(fabsf(a[i] - b[i]) > epsilon * fmaxf(1.0f, fabsf(b[i]))) return false;
+    }
+    return true;
+}
+
+bool equal(Matrix3x4 a, Matrix3x4 b, float epsilon = 1e-4f) {
+    return equal(math::get_matrix4x4(a), math::get_matrix4x4(b), epsilon);
+}
+
+Matrix4x4 get_test_matrix(float t) {
+    Quaternion q = Quaternion(math::sin(t), math::cos(t * 0.7f), 0.3f, 1.0f);
+    return math::get_translation(t, -2.0f * t, 3.0f) * math::get_rotation(q) * math::get_scale(1.0f + t, 2.0f, 0.5f);
+}
+
+/*
+
+Benchmarks.
+
+*/
+
+const int MATRIX_COUNT = 1024;
+const int ITERATION_COUNT = 1000;
+Matrix4x4 matrices[MATRIX_COUNT];
+Matrix3x4 affine_matrices[MATRIX_COUNT];
+Quaternion quaternions[MATRIX_COUNT];
+
+// Prevents the compiler from throwing the benchmark loops away.
+volatile float sink;
+
+// Each loop runs in its own function. Inlined into main, which compilers treat as code that runs once, the
+// loops got by-value copies with `rep movs` or not depending on unrelated code around them. Results are
+// sampled one lane at a time, the lane wraps around instead of using %, which is a division for Matrix3x4.
+#if defined(_MSC_VER)
+#define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+template <typename F>
+BENCHMARK_NOINLINE float run_benchmark_loop(F function) {
+    float sum = 0.0f;
+    uint32_t lane = 0;
+    for(int it = 0; it < ITERATION_COUNT; ++it) {
+        for(int i = 0; i < MATRIX_COUNT; ++i) {
+            auto r = function(i);
+            sum += r[lane];
+            lane = lane + 1 < sizeof(r) / sizeof(float) ? lane + 1 : 0;
+        }
+    }
+    return sum;
+}
+
+#define BENCHMARK_PAIR(name, label_a, expression_a, label_b, expression_b) {  \
+    double start = get_time_ms();                                               \
+    float sum = run_benchmark_loop([&](int i) { return expression_a; });       \
+    double a_time = get_time_ms() - start;                                      \
+    start = get_time_ms();                                                      \
+    sum += run_benchmark_loop([&](int i) { return expression_b; });            \
+    double b_time = get_time_ms() - start;                                      \
+    sink = sum;                                                                 \
+    printf("%-20s %s: %7.2f ms, %s: %7.2f ms\n", name, label_a, a_time, label_b, b_time); \
+}
+#define BENCHMARK(name, scalar_expression, simd_expression) \
+    BENCHMARK_PAIR(name, "scalar", scalar_expression, "maths.h", simd_expression)
+
+// rand() based generator maths.h used before, benchmark baseline.
+float rand_uniform(float low = 0.0f, float high = 1.0f) {
+    float normalized = (rand() % 10000) / 10000.0f;
+    return normalized * (high - low) + low;
+}
+
+Vector3 rand_uniform_unit_sphere() {
+    float azimuth = rand_uniform(0, math::PI2);
+    float polar = math::acos(2 * rand_uniform() - 1);
+    float r = math::pow(rand_uniform(), 1.0f / 3.0f);
+
+    Vector3 result;
+    result.x = r * math::cos(azimuth) * math::sin(polar);
+    result.y = r * math::cos(polar);
+    result.z = r * math::sin(azimuth) * math::sin(polar);
+    return result;
+}
+
+bool equal(Vector3 a, Vector3 b, float epsilon = 1e-4f) {
+    for(int i = 0; i < 3; ++i) {
+        if(fabsf(a[i] - b[i]) > epsilon * fmaxf(1.0f, fabsf(b[i]))) return false;
+    }
+    return true;
+}
+
+const uint32_t BATCH_COUNT = 1 << 20;
+Vector3 batch_a[BATCH_COUNT];
+Vector3 batch_b[BATCH_COUNT];
+Vector3 batch_out[BATCH_COUNT];
+Vector4 batch_a4[BATCH_COUNT];
+Vector4 batch_out4[BATCH_COUNT];
+float batch_dots[BATCH_COUNT];
+AABB cull_boxes[BATCH_COUNT];
+Sphere cull_spheres[BATCH_COUNT];
+uint32_t cull_visible[BATCH_COUNT / 32];
+
+#define BENCHMARK_BATCH(name, loop_statement, batch_statement) {                \
+    double start = get_time_ms();                                               \
+    for(uint32_t i = 0; i < BATCH_COUNT; ++i) {                                 \
+        loop_statement;                                                         \
+    }                                                                           \
+    double loop_time = get_time_ms() - start;                                   \
+    start = get_time_ms();                                                      \
+    batch_statement;                                                            \
+    double batch_time = get_time_ms() - start;                                  \
+    printf("%-20s loop: %7.2f ms, batch: %7.2f ms\n", name, loop_time, batch_time); \
+}
+
+int main() {
+#if defined(CPPLIB_MATHS_AVX)
+    printf("Maths code path: AVX\n");
+#elif defined(CPPLIB_MATHS_SSE)
+    printf("Maths code path: SSE\n");
+#else
+    printf("Maths code path: scalar\n");
+#endif
+
+    {
+        Vector4 a = Vector4(1.0f, -2.0f, 3.0f, 4.0f);
+        Vector4 b = Vector4(0.5f, 0.25f, -1.0f, 2.0f);
+        Vector4 c = a;
+        c += b;
+        Vector4 d = a;
+        d *= 2.0f;
+        CHECK("Vector4 operators",
+              equal(a + b, Vector4(1.5f, -1.75f, 2.0f, 6.0f)) &&
+              equal(a - b, Vector4(0.5f, -2.25f, 4.0f, 2.0f)) &&
+              equal(-a, Vector4(-1.0f, 2.0f, -3.0f, -4.0f)) &&
+              equal(a * 2.0f, Vector4(2.0f, -4.0f, 6.0f, 8.0f)) &&
+              equal(a / 2.0f, Vector4(0.5f, -1.0f, 1.5f, 2.0f)) &&
+              equal(c, a + b) && equal(d, a * 2.0f));
+    }
+
+    {
+        // static_asserts fail the build if the builders and operators can't be evaluated at compile time. Operators
+        // with SIMD paths are only constexpr on compilers with __builtin_is_constant_evaluated.
+        CPPLIB_MATHS_SIMD_CONSTEXPR Matrix4x4 quad = math::get_translation(Vector3(0.5f, -0.5f, 0.0f)) * math::get_scale(0.5f);
+        CPPLIB_MATHS_SIMD_CONSTEXPR Matrix4x4 quad_transposed = math::transpose(quad);
+        constexpr Matrix4x4 projection = math::get_orthographics_projection_dx_rh(0.0f, 800.0f, 0.0f, 600.0f, -1.0f, -10.0f);
+        CPPLIB_MATHS_SIMD_CONSTEXPR Vector4 corner = projection * (quad * Vector4(1.0f, 1.0f, 0.0f, 1.0f));
+        constexpr Vector3 offset = 2.0f * Vector3(1.0f, 2.0f, 3.0f) - Vector3(Vector4(1.0f, 1.0f, 1.0f, 0.0f));
+#ifdef CPPLIB_MATHS_SIMD_IS_CONSTEXPR
+        static_assert(quad[0] == 0.5f && quad[5] == 0.5f && quad[12] == 0.5f && quad[13] == -0.5f, "");
+        static_assert(quad_transposed[3] == 0.5f && quad_transposed[7] == -0.5f, "");
+        static_assert(corner.y == -1.0f && corner.w == 1.0f, "");
+#endif
+        static_assert(offset.x == 1.0f && offset.z == 5.0f, "");
+
+        // Same expressions at run time, going through the SIMD paths.
+        volatile float half = 0.5f;
+        Matrix4x4 runtime_quad = math::get_translation(Vector3(half, -half, 0.0f)) * math::get_scale(half);
+        Matrix4x4 runtime_projection = math::get_orthographics_projection_dx_rh(0.0f, 800.0f, 0.0f, 600.0f, -1.0f, -10.0f);
+        Vector4 runtime_corner = runtime_projection * (runtime_quad * Vector4(2.0f * half, 1.0f, 0.0f, 1.0f));
+        CHECK("constexpr builders and operators",
+              equal(quad, runtime_quad, 0.0f) &&
+              equal(quad_transposed, math::transpose(runtime_quad), 0.0f) &&
+              equal(corner, runtime_corner, 1e-6f) &&
+              equal(offset, Vector3(1.0f, 3.0f, 5.0f), 0.0f));
+    }
+
+    bool multiply_correct = true;
+    bool vector_correct = true;
+    bool transpose_correct = true;
+    bool invert_correct = true;
+    bool rotation_correct = true;
+    for(int i = 0; i < 100; ++i) {
+        Matrix4x4 a = get_test_matrix(i * 0.1f);
+        Matrix4x4 b = get_test_matrix(i * 0.37f + 1.0f);
+        Vector4 v = Vector4(i * 0.5f, 1.0f, -2.0f, 1.0f);
+        Quaternion q = Quaternion(i * 0.1f - 3.0f, 0.5f, -i * 0.05f, 1.0f);
+
+        multiply_correct = multiply_correct && equal(a * b, scalar_multiply(a, b), 1e-3f);
+        vector_correct = vector_correct && equal(a * v, scalar_multiply(a, v), 1e-3f);
+        transpose_correct = transpose_correct && equal(math::transpose(a), scalar_transpose(a), 0.0f);
+        invert_correct = invert_correct && equal(math::invert(a), scalar_invert(a), 1e-3f) && equal(a * math::invert(a), math::get_identity(), 1e-3f);
+        rotation_correct = rotation_correct && equal(math::get_rotation(q), scalar_rotation(q), 1e-5f);
+    }
+    CHECK("Matrix4x4 * Matrix4x4", multiply_correct);
+    CHECK("Matrix4x4 * Vector4", vector_correct);
+    CHECK("transpose", transpose_correct);
+    CHECK("invert", invert_correct);
+    CHECK("invert of singular matrix is identity", equal(math::invert(Matrix4x4()), math::get_identity(), 0.0f));
+    CHECK("quaternion to matrix", rotation_correct);
+
+    bool affine_conversion_correct = true;
+    bool affine_multiply_correct = true;
+    bool affine_vector_correct = true;
+    bool affine_invert_correct = true;
+    bool affine_trs_correct = true;
+    bool quaternion_multiply_correct = true;
+    bool dual_quaternion_correct = true;
+    bool dual_quaternion_multiply_correct = true;
+    bool dual_quaternion_inverse_correct = true;
+    for(int i = 0; i < 100; ++i) {
+        Matrix4x4 a = get_test_matrix(i * 0.1f);
+        Matrix4x4 b = get_test_matrix(i * 0.37f + 1.0f);
+        Matrix3x4 a_affine = math::get_matrix3x4(a);
+        Matrix3x4 b_affine = math::get_matrix3x4(b);
+        Vector4 v = Vector4(i * 0.5f, 1.0f, -2.0f, (float)(i & 1));
+        Vector3 t = Vector3(i * 0.2f, -1.0f, 3.0f - i * 0.1f);
+        Vector3 s = Vector3(1.0f + i * 0.01f, 2.0f, 0.5f);
+        // Covers every branch of the matrix to quaternion conversion.
+        Quaternion q = Quaternion(i * 0.1f - 3.0f, 0.5f, -i * 0.05f, (i % 4) * 0.5f - 0.5f);
+        Quaternion p = Quaternion(0.3f, -i * 0.02f, 1.0f, 0.5f);
+
+        affine_conversion_correct = affine_conversion_correct && equal(math::get_matrix4x4(a_affine), a, 1e-6f);
+        affine_multiply_correct = affine_multiply_correct && equal(a_affine * b_affine, math::get_matrix3x4(a * b), 1e-3f);
+        affine_vector_correct = affine_vector_correct && equal(a_affine * v, a * v, 1e-3f) &&
+            equal(math::transform_point(a_affine, Vector3(v)), Vector3(a * Vector4(Vector3(v), 1.0f)), 1e-3f) &&
+            equal(math::transform_direction(a_affine, Vector3(v)), Vector3(a * Vector4(Vector3(v), 0.0f)), 1e-3f);
+        affine_invert_correct = affine_invert_correct && equal(math::invert(a_affine), math::get_matrix3x4(math::invert(a)), 1e-3f);
+        affine_trs_correct = affine_trs_correct &&
+            equal(math::get_matrix3x4(t, q, s), math::get_matrix3x4(math::get_translation(t) * math::get_rotation(q) * math::get_scale(s)), 1e-5f);
+
+        Quaternion qp = math::quaternion_multiply(q, p);
+        quaternion_multiply_correct = quaternion_multiply_correct && equal(math::get_rotation(qp), math::get_rotation(q) * math::get_rotation(p), 1e-5f);
+
+        Matrix3x4 rigid_q = math::get_matrix3x4(t, q);
+        Matrix3x4 rigid_p = math::get_matrix3x4(-t, p);
+        DualQuaternion dq = math::get_dual_quaternion(q, t);
+        DualQuaternion dp = math::get_dual_quaternion(p, -t);
+        dual_quaternion_correct = dual_quaternion_correct && equal(math::get_matrix3x4(dq), rigid_q, 1e-5f) &&
+            equal(math::get_translation(dq), t, 1e-5f) &&
+            equal(math::get_matrix3x4(math::get_dual_quaternion(rigid_q)), rigid_q, 1e-5f) &&
+            equal(math::transform_point(dq, s), math::transform_point(rigid_q, s), 1e-5f);
+        dual_quaternion_multiply_correct = dual_quaternion_multiply_correct && equal(math::get_matrix3x4(dq * dp), rigid_q * rigid_p, 1e-5f);
+        dual_quaternion_inverse_correct = dual_quaternion_inverse_correct &&
+            equal(math::get_matrix3x4(math::conjugate(dq)), math::invert(rigid_q), 1e-5f) &&
+            equal(math::get_matrix3x4(math::conjugate(dq) * dq), math::get_matrix3x4(DualQuaternion()), 1e-5f);
+    }
+    CHECK("Matrix4x4 to Matrix3x4 and back", affine_conversion_correct);
+    CHECK("Matrix3x4 * Matrix3x4", affine_multiply_correct);
+    CHECK("Matrix3x4 * Vector4", affine_vector_correct);
+    CHECK("Matrix3x4 invert", affine_invert_correct);
+    CHECK("Matrix3x4 invert of singular matrix is identity", equal(math::invert(Matrix3x4()), math::get_matrix3x4(math::get_identity()), 0.0f));
+    CHECK("Matrix3x4 from translation, rotation and scale", affine_trs_correct);
+    CHECK("quaternion multiply", quaternion_multiply_correct);
+    CHECK("dual quaternion to matrix and back", dual_quaternion_correct);
+    CHECK("dual quaternion multiply", dual_quaternion_multiply_correct);
+    CHECK("dual quaternion conjugate is inverse", dual_quaternion_inverse_correct);
+
+    {
+        // Rotations of +-60 degrees around y with the same translation blend to just the translation.
+        DualQuaternion a = math::get_dual_quaternion(Quaternion(0.0f, 0.5f, 0.0f, 0.866025f), Vector3(1.0f, 2.0f, 3.0f));
+        DualQuaternion b = math::get_dual_quaternion(Quaternion(0.0f, -0.5f, 0.0f, 0.866025f), Vector3(1.0f, 2.0f, 3.0f));
+        DualQuaternion negated_b = DualQuaternion(-b.real, -b.dual);
+        DualQuaternion middle = math::nlerp(a, b, 0.5f);
+        CHECK("dual quaternion nlerp",
+              equal(math::get_matrix3x4(math::nlerp(a, b, 0.0f)), math::get_matrix3x4(a), 1e-5f) &&
+              equal(math::get_matrix3x4(math::nlerp(a, b, 1.0f)), math::get_matrix3x4(b), 1e-5f) &&
+              equal(math::get_matrix3x4(math::nlerp(a, negated_b, 0.5f)), math::get_matrix3x4(middle), 1e-5f) &&
+              equal(math::get_translation(middle), Vector3(1.0f, 2.0f, 3.0f), 1e-5f) &&
+              equal(middle.real, Quaternion(0.0f, 0.0f, 0.0f, 1.0f), 1e-5f));
+    }
+
+    for(int i = 0; i < MATRIX_COUNT; ++i) {
+        matrices[i] = get_test_matrix(i * 0.01f);
+        affine_matrices[i] = math::get_matrix3x4(matrices[i]);
+        quaternions[i] = Quaternion(i * 0.01f, 1.0f, -0.5f, 0.25f);
+    }
+    BENCHMARK("multiply", scalar_multiply(matrices[i], matrices[(i + 1) & (MATRIX_COUNT - 1)]),
+                          matrices[i] * matrices[(i + 1) & (MATRIX_COUNT - 1)]);
+    BENCHMARK("transpose", scalar_transpose(matrices[i]), math::transpose(matrices[i]));
+    BENCHMARK("invert", scalar_invert(matrices[i]), math::invert(matrices[i]));
+    BENCHMARK("quaternion", scalar_rotation(quaternions[i]), math::get_rotation(quaternions[i]));
+    BENCHMARK_PAIR("affine multiply", "Matrix4x4", matrices[i] * matrices[(i + 1) & (MATRIX_COUNT - 1)],
+                                      "Matrix3x4", affine_matrices[i] * affine_matrices[(i + 1) & (MATRIX_COUNT - 1)]);
+    BENCHMARK_PAIR("affine invert", "Matrix4x4", math::invert(matrices[i]), "Matrix3x4", math::invert(affine_matrices[i]));
+
+    // Batch operations, odd counts exercise the tails.
+    for(uint32_t i = 0; i < BATCH_COUNT; ++i) {
+        float t = i * 0.001f;
+        batch_a[i] = Vector3(math::sin(t), t, -2.0f * t + 1.0f);
+        batch_b[i] = Vector3(1.0f - t, math::cos(t), 0.5f);
+        batch_a4[i] = Vector4(batch_a[i], (i & 1) ? 1.0f : 0.0f);
+    }
+    batch_a[7] = Vector3(0.0f, 0.0f, 0.0001f);
+    Matrix4x4 m = get_test_matrix(0.5f);
+    uint32_t counts[] = {0, 1, 3, 4, 7, 1029, BATCH_COUNT - 1};
+    bool points4_correct = true, points_correct = true, directions_correct = true;
+    bool normalize_correct = true, dot_correct = true, cross_correct = true;
+    for(uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        uint32_t count = counts[c];
+        // Check only a sample of the big array to keep the test quick.
+        uint32_t step = count > 10000 ? 97 : 1;
+        batch_out[count] = Vector3(123.0f, 0.0f, 0.0f);
+
+        math::transform_points(m, batch_a4, batch_out4, count);
+        for(uint32_t i = 0; i < count; i += step) points4_correct = points4_correct && equal(batch_out4[i], m * batch_a4[i]);
+        math::transform_points(m, batch_a, batch_out, count);
+        for(uint32_t i = 0; i < count; i += step) points_correct = points_correct && equal(batch_out[i], Vector3(m * Vector4(batch_a[i], 1.0f)));
+        math::transform_directions(m, batch_a, batch_out, count);
+        for(uint32_t i = 0; i < count; i += step) directions_correct = directions_correct && equal(batch_out[i], Vector3(m * Vector4(batch_a[i], 0.0f)));
+        math::normalize(batch_a, batch_out, count);
+        for(uint32_t i = 0; i < count; i += step) normalize_correct = normalize_correct && equal(batch_out[i], math::normalize(batch_a[i]));
+        math::dot(batch_a, batch_b, batch_dots, count);
+        for(uint32_t i = 0; i < count; i += step) dot_correct = dot_correct && fabsf(batch_dots[i] - math::dot(batch_a[i], batch_b[i])) < 1e-3f;
+        math::cross(batch_a, batch_b, batch_out, count);
+        for(uint32_t i = 0; i < count; i += step) cross_correct = cross_correct && equal(batch_out[i], math::cross(batch_a[i], batch_b[i]), 1e-3f);
+
+        // Nothing past the end is written.
+        cross_correct = cross_correct && batch_out[count].x == 123.0f;
+    }
+    CHECK("batch transform_points (Vector4)", points4_correct);
+    CHECK("batch transform_points (Vector3)", points_correct);
+    CHECK("batch transform_directions", directions_correct);
+    CHECK("batch normalize", normalize_correct);
+    CHECK("batch dot", dot_correct);
+    CHECK("batch cross", cross_correct);
+
+    {
+        Vector3 in_place[5] = {Vector3(1, 0, 0), Vector3(0, 2, 0), Vector3(0, 0, 3), Vector3(1, 1, 1), Vector3(4, 0, 0)};
+        math::transform_points(math::get_translation(1.0f, 2.0f, 3.0f), in_place, in_place, 5);
+        CHECK("batch transform in place", equal(in_place[1], Vector3(1, 4, 3)) && equal(in_place[4], Vector3(5, 2, 3)));
+    }
+
+    BENCHMARK_BATCH("transform Vector4", batch_out4[i] = m * batch_a4[i], math::transform_points(m, batch_a4, batch_out4, BATCH_COUNT));
+    BENCHMARK_BATCH("transform Vector3", batch_out[i] = Vector3(m * Vector4(batch_a[i], 1.0f)), math::transform_points(m, batch_a, batch_out, BATCH_COUNT));
+    BENCHMARK_BATCH("normalize", batch_out[i] = math::normalize(batch_a[i]), math::normalize(batch_a, batch_out, BATCH_COUNT));
+    BENCHMARK_BATCH("dot", batch_dots[i] = math::dot(batch_a[i], batch_b[i]), math::dot(batch_a, batch_b, batch_dots, BATCH_COUNT));
+    BENCHMARK_BATCH("cross", batch_out[i] = math::cross(batch_a[i], batch_b[i]), math::cross(batch_a, batch_b, batch_out, BATCH_COUNT));
+
+    // Random numbers.
+    {
+        math::random_seed(42);
+        uint32_t first = math::random_uint32();
+        float second = math::random_uniform();
+        math::random_seed(42);
+        CHECK("random_seed makes sequence reproducible", math::random_uint32() == first && math::random_uniform() == second);
+
+        uint32_t other_thread_value = 0;
+        std::thread other_thread([&]() { other_thread_value = math::random_uint32(); });
+        other_thread.join();
+        math::random_seed(42);
+        CHECK("threads have independent generators", other_thread_value != math::random_uint32());
+    }
+
+    {
+        float *floats = batch_dots;
+        int *ints = (int *)batch_out4;
+        bool scalar_in_range = true;
+        for(int i = 0; i < 10000; ++i) {
+            float f = math::random_uniform(-2.0f, 3.0f);
+            int n = math::random_uniform_int(-3, 4);
+            scalar_in_range = scalar_in_range && f >= -2.0f && f < 3.0f && n >= -3 && n < 4;
+        }
+        CHECK("random_uniform and random_uniform_int ranges", scalar_in_range);
+
+        const uint32_t count = BATCH_COUNT - 3;
+        math::random_uniform_n(floats, count, -2.0f, 3.0f);
+        double sum = 0.0;
+        bool floats_in_range = true;
+        for(uint32_t i = 0; i < count; ++i) {
+            floats_in_range = floats_in_range && floats[i] >= -2.0f && floats[i] < 3.0f;
+            sum += floats[i];
+        }
+        CHECK("random_uniform_n range and mean", floats_in_range && fabs(sum / count - 0.5) < 0.01);
+
+        math::random_uniform_int_n(ints, count, -3, 4);
+        uint32_t histogram[7] = {};
+        bool ints_in_range = true;
+        for(uint32_t i = 0; i < count; ++i) {
+            ints_in_range = ints_in_range && ints[i] >= -3 && ints[i] < 4;
+            if(ints_in_range) histogram[ints[i] + 3]++;
+        }
+        for(int i = 0; i < 7; ++i) {
+            ints_in_range = ints_in_range && fabs(histogram[i] / double(count) - 1.0 / 7.0) < 0.005;
+        }
+        CHECK("random_uniform_int_n range and histogram", ints_in_range);
+
+        math::random_uniform_unit_sphere_n(batch_out, count);
+        Vector3 mean = Vector3();
+        bool sphere_correct = true;
+        uint32_t inner_count = 0;
+        for(uint32_t i = 0; i < count; ++i) {
+            float length = math::length(batch_out[i]);
+            sphere_correct = sphere_correct && length <= 1.0001f;
+            inner_count += length < 0.5f ? 1 : 0;
+            mean += batch_out[i];
+        }
+        // Uniform in volume, so 1/8 of points lie within half the radius.
+        mean = mean / float(count);
+        sphere_correct = sphere_correct && math::length(mean) < 0.01f && fabs(inner_count / double(count) - 0.125) < 0.005;
+        CHECK("random_uniform_unit_sphere_n", sphere_correct);
+
+        math::random_uniform_unit_hemisphere_n(batch_out, count);
+        bool hemisphere_correct = true;
+        for(uint32_t i = 0; i < count; ++i) {
+            hemisphere_correct = hemisphere_correct && batch_out[i].y >= 0.0f && math::length(batch_out[i]) <= 1.0001f;
+        }
+        Vector3 scalar_sample = math::random_uniform_unit_hemisphere();
+        hemisphere_correct = hemisphere_correct && scalar_sample.y >= 0.0f && math::length(scalar_sample) <= 1.0001f;
+        CHECK("random_uniform_unit_hemisphere_n", hemisphere_correct);
+
+        BENCHMARK_BATCH("uniform floats", floats[i] = rand_uniform(), math::random_uniform_n(floats, BATCH_COUNT));
+        BENCHMARK_BATCH("sphere samples", batch_out[i] = rand_uniform_unit_sphere(), math::random_uniform_unit_sphere_n(batch_out, BATCH_COUNT));
+        BENCHMARK_BATCH("uniform floats (new)", floats[i] = math::random_uniform(), math::random_uniform_n(floats, BATCH_COUNT));
+    }
+
+    // Approximations, errors against libm over typical input ranges.
+    {
+        float *x = batch_dots;
+        float *y = (float *)batch_a4;
+        float *out = (float *)batch_out4;
+        const uint32_t count = BATCH_COUNT - 1;
+        const char *tier_names[] = {"fast", "high"};
+        math::Accuracy tiers[] = {math::ACCURACY_FAST, math::ACCURACY_HIGH};
+        // Maximum errors documented in maths.h.
+        float sin_limits[] = {1e-4f, 3e-7f};
+        float atan2_limits[] = {1e-4f, 5e-7f};
+        float acos_limits[] = {7e-5f, 5e-7f};
+        float pow_limits[] = {2e-4f, 3e-7f};
+
+        for(int t = 0; t < 2; ++t) {
+            math::Accuracy accuracy = tiers[t];
+            float sin_error = 0, cos_error = 0, atan2_error = 0, acos_error = 0, pow_error = 0;
+            bool scalar_matches = true;
+
+            for(uint32_t i = 0; i < count; ++i) x[i] = (i / float(count) - 0.5f) * 200.0f;
+            math::sin_approx(x, out, count, accuracy);
+            for(uint32_t i = 0; i < count; ++i) sin_error = fmaxf(sin_error, fabsf(out[i] - sinf(x[i])));
+            for(uint32_t i = 0; i < count; i += 101) scalar_matches = scalar_matches && fabsf(out[i] - math::sin_approx(x[i], accuracy)) < 1e-6f;
+            math::cos_approx(x, out, count, accuracy);
+            for(uint32_t i = 0; i < count; ++i) cos_error = fmaxf(cos_error, fabsf(out[i] - cosf(x[i])));
+
+            for(uint32_t i = 0; i < count; ++i) {
+                float angle = (i / float(count)) * math::PI2 * 7.0f;
+                float radius = 0.001f + (i % 1000) * 0.1f;
+                x[i] = cosf(angle) * radius;
+                y[i] = sinf(angle) * radius;
+            }
+            x[0] = 0.0f; y[0] = 0.0f;
+            math::atan2_approx(y, x, out, count, accuracy);
+            for(uint32_t i = 0; i < count; ++i) atan2_error = fmaxf(atan2_error, fabsf(out[i] - atan2f(y[i], x[i])));
+            for(uint32_t i = 0; i < count; i += 101) scalar_matches = scalar_matches && fabsf(out[i] - math::atan2_approx(y[i], x[i], accuracy)) < 1e-6f;
+
+            for(uint32_t i = 0; i < count; ++i) x[i] = (i / float(count - 1)) * 2.0f - 1.0f;
+            math::acos_approx(x, out, count, accuracy);
+            for(uint32_t i = 0; i < count; ++i) acos_error = fmaxf(acos_error, fabsf(out[i] - acosf(x[i])));
+
+            // Relative error divided by max(1, |e|) * max(1, |log2(x)|).
+            for(uint32_t i = 0; i < count; ++i) {
+                x[i] = 0.001f + (i % 4096) * 0.01f;
+                y[i] = ((i >> 12) / 256.0f) * 8.0f - 4.0f;
+            }
+            math::pow_approx(x, y, out, count, accuracy);
+            for(uint32_t i = 0; i < count; ++i) {
+                float expected = powf(x[i], y[i]);
+                float scale = fmaxf(1.0f, fabsf(y[i])) * fmaxf(1.0f, fabsf(log2f(x[i])));
+                pow_error = fmaxf(pow_error, fabsf(out[i] - expected) / expected / scale);
+            }
+            for(uint32_t i = 0; i < count; i += 101) scalar_matches = scalar_matches && fabsf(out[i] - math::pow_approx(x[i], y[i], accuracy)) <= 1e-6f * out[i];
+
+            printf("%s tier max errors: sin %.2e, cos %.2e, atan2 %.2e, acos %.2e, pow %.2e\n", tier_names[t], sin_error, cos_error, atan2_error, acos_error, pow_error);
+            CHECK("approximation errors within documented limits",
+                  sin_error < sin_limits[t] && cos_error < sin_limits[t] && atan2_error < atan2_limits[t] &&
+                  acos_error < acos_limits[t] && pow_error < pow_limits[t]);
+            CHECK("scalar approximations match array versions", scalar_matches);
+        }
+        CHECK("pow_approx of 0 is 0", math::pow_approx(0.0f, 2.0f) == 0.0f);
+        float zeros[9] = {};
+        float zero_powers[9];
+        math::pow_approx(zeros, zeros, zero_powers, 9);
+        bool zero_powers_are_1 = math::pow_approx(0.0f, 0.0f) == 1.0f && math::pow_approx(2.0f, 0.0f) == 1.0f;
+        for(int i = 0; i < 9; ++i) zero_powers_are_1 = zero_powers_are_1 && zero_powers[i] == 1.0f;
+        CHECK("pow_approx with exponent 0 is 1", zero_powers_are_1);
+
+        for(uint32_t i = 0; i < count; ++i) {
+            x[i] = 0.01f + (i % 1000) * 0.05f;
+            y[i] = (i % 7) * 0.5f - 1.0f;
+        }
+        BENCHMARK_BATCH("sin libm vs fast", out[i] = sinf(x[i]), math::sin_approx(x, out, BATCH_COUNT, math::ACCURACY_FAST));
+        BENCHMARK_BATCH("sin libm vs high", out[i] = sinf(x[i]), math::sin_approx(x, out, BATCH_COUNT, math::ACCURACY_HIGH));
+        BENCHMARK_BATCH("atan2 libm vs fast", out[i] = atan2f(y[i], x[i]), math::atan2_approx(y, x, out, BATCH_COUNT, math::ACCURACY_FAST));
+        BENCHMARK_BATCH("atan2 libm vs high", out[i] = atan2f(y[i], x[i]), math::atan2_approx(y, x, out, BATCH_COUNT, math::ACCURACY_HIGH));
+        BENCHMARK_BATCH("acos libm vs fast", out[i] = acosf(y[i]), math::acos_approx(y, out, BATCH_COUNT, math::ACCURACY_FAST));
+        BENCHMARK_BATCH("acos libm vs high", out[i] = acosf(y[i]), math::acos_approx(y, out, BATCH_COUNT, math::ACCURACY_HIGH));
+        BENCHMARK_BATCH("pow libm vs fast", out[i] = powf(x[i], y[i]), math::pow_approx(x, y, out, BATCH_COUNT, math::ACCURACY_FAST));
+        BENCHMARK_BATCH("pow libm vs high", out[i] = powf(x[i], y[i]), math::pow_approx(x, y, out, BATCH_COUNT, math::ACCURACY_HIGH));
+        BENCHMARK_BATCH("sin libm vs scalar", out[i] = sinf(x[i]), for(uint32_t i = 0; i < BATCH_COUNT; ++i) out[i] = math::sin_approx(x[i]));
+    }
+
+    // Bounding volumes and culling.
+    Matrix4x4 view = math::get_look_at(Vector3(0.0f, 0.0f, 5.0f), Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 1.0f, 0.0f));
+    Matrix4x4 projection = math::get_perspective_projection_dx_rh(math::deg2rad(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    Frustum frustum = math::get_frustum(projection * view);
+    {
+        bool normals_correct = true;
+        for(int i = 0; i < 6; ++i) normals_correct = normals_correct && fabsf(math::length(frustum.planes[i].normal) - 1.0f) < 1e-5f;
+        CHECK("frustum planes are normalized", normals_correct);
+        CHECK("frustum from perspective projection",
+              math::intersects(frustum, Sphere{Vector3(0.0f, 0.0f, 0.0f), 0.0f}) &&
+              math::intersects(frustum, Sphere{Vector3(0.0f, 0.0f, -90.0f), 0.0f}) &&
+              !math::intersects(frustum, Sphere{Vector3(0.0f, 0.0f, -110.0f), 0.0f}) &&
+              !math::intersects(frustum, Sphere{Vector3(0.0f, 0.0f, 5.0f), 0.0f}) &&
+              math::intersects(frustum, Sphere{Vector3(0.0f, 0.0f, 5.0f), 0.2f}) &&
+              !math::intersects(frustum, Sphere{Vector3(10.0f, 0.0f, 0.0f), 1.0f}) &&
+              math::intersects(frustum, Sphere{Vector3(10.0f, 0.0f, 0.0f), 4.0f}) &&
+              !math::intersects(frustum, AABB{Vector3(0.0f, 6.0f, 0.0f), Vector3(1.0f, 1.0f, 1.0f)}) &&
+              math::intersects(frustum, AABB{Vector3(0.0f, 6.0f, 0.0f), Vector3(1.0f, 4.0f, 1.0f)}));
+
+        Frustum box_frustum = math::get_frustum(math::get_orthographics_projection_dx_rh(-1.0f, 1.0f, -2.0f, 2.0f, -1.0f, -10.0f));
+        CHECK("frustum from orthographic projection",
+              math::intersects(box_frustum, AABB{Vector3(0.9f, 1.9f, -5.0f), Vector3(0.0f, 0.0f, 0.0f)}) &&
+              !math::intersects(box_frustum, AABB{Vector3(1.1f, 0.0f, -5.0f), Vector3(0.0f, 0.0f, 0.0f)}) &&
+              !math::intersects(box_frustum, AABB{Vector3(0.0f, 2.1f, -5.0f), Vector3(0.0f, 0.0f, 0.0f)}) &&
+              !math::intersects(box_frustum, AABB{Vector3(0.0f, 0.0f, -0.5f), Vector3(0.0f, 0.0f, 0.0f)}) &&
+              !math::intersects(box_frustum, AABB{Vector3(0.0f, 0.0f, -10.5f), Vector3(0.0f, 0.0f, 0.0f)}));
+
+        AABB box = AABB{Vector3(1.0f, -2.0f, 3.0f), Vector3(0.5f, 1.0f, 2.0f)};
+        Vector3 corners[8];
+        for(int i = 0; i < 8; ++i) {
+            Vector3 corner = Vector3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            corner = Vector3(corner.x * box.extents.x, corner.y * box.extents.y, corner.z * box.extents.z) + box.center;
+            corners[i] = Vector3(m * Vector4(corner, 1.0f));
+        }
+        AABB transformed = math::transform(m, box);
+        AABB from_corners = math::get_aabb(corners, 8);
+        CHECK("AABB transform", equal(transformed.center, from_corners.center) && equal(transformed.extents, from_corners.extents));
+    }
+
+    math::random_seed(7);
+    for(uint32_t i = 0; i < BATCH_COUNT; ++i) {
+        Vector3 center = Vector3(math::random_uniform(-60.0f, 60.0f), math::random_uniform(-60.0f, 60.0f), math::random_uniform(-110.0f, 10.0f));
+        cull_boxes[i] = AABB{center, Vector3(math::random_uniform(0.0f, 2.0f), math::random_uniform(0.0f, 2.0f), math::random_uniform(0.0f, 2.0f))};
+        cull_spheres[i] = Sphere{center, math::random_uniform(0.0f, 2.0f)};
+    }
+    bool cull_boxes_correct = true;
+    bool cull_spheres_correct = true;
+    uint32_t cull_counts[] = {0, 1, 3, 4, 31, 32, 33, 1029, BATCH_COUNT - 1};
+    for(uint32_t count : cull_counts) {
+        uint32_t word_count = (count + 31) / 32;
+        math::cull(frustum, cull_boxes, count, cull_visible);
+        for(uint32_t i = 0; i < word_count * 32; ++i) {
+            bool visible = (cull_visible[i / 32] >> (i % 32)) & 1;
+            cull_boxes_correct = cull_boxes_correct && visible == (i < count && math::intersects(frustum, cull_boxes[i]));
+        }
+        math::cull(frustum, cull_spheres, count, cull_visible);
+        for(uint32_t i = 0; i < word_count * 32; ++i) {
+            bool visible = (cull_visible[i / 32] >> (i % 32)) & 1;
+            cull_spheres_correct = cull_spheres_correct && visible == (i < count && math::intersects(frustum, cull_spheres[i]));
+        }
+    }
+    CHECK("batch cull AABBs", cull_boxes_correct);
+    CHECK("batch cull spheres", cull_spheres_correct);
+
+    BENCHMARK_BATCH("cull AABBs", cull_visible[i / 32] ^= math::intersects(frustum, cull_boxes[i]) << (i % 32), math::cull(frustum, cull_boxes, BATCH_COUNT, cull_visible));
+    BENCHMARK_BATCH("cull spheres", cull_visible[i / 32] ^= math::intersects(frustum, cull_spheres[i]) << (i % 32), math::cull(frustum, cull_spheres, BATCH_COUNT, cull_visible));
+
+    jobs::init();
+    BENCHMARK_BATCH("transform threaded", batch_out[i] = Vector3(m * Vector4(batch_a[i], 1.0f)), math::transform_points(m, batch_a, batch_out, BATCH_COUNT));
+    math::transform_points(m, batch_a, batch_out, BATCH_COUNT);
+    bool threaded_correct = true;
+    for(uint32_t i = 0; i < BATCH_COUNT; i += 13) threaded_correct = threaded_correct && equal(batch_out[i], Vector3(m * Vector4(batch_a[i], 1.0f)));
+    jobs::release();
+    CHECK("batch transform with job system", threaded_correct);
+
+    jobs::init();
+    BENCHMARK_BATCH("cull threaded", cull_visible[i / 32] ^= math::intersects(frustum, cull_boxes[i]) << (i % 32), math::cull(frustum, cull_boxes, BATCH_COUNT, cull_visible));
+    math::cull(frustum, cull_boxes, BATCH_COUNT, cull_visible);
+    jobs::release();
+    threaded_correct = true;
+    for(uint32_t i = 0; i < BATCH_COUNT; ++i) threaded_correct = threaded_correct && ((cull_visible[i / 32] >> (i % 32)) & 1) == math::intersects(frustum, cull_boxes[i]);
+    CHECK("batch cull with job system", threaded_correct);
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <thread>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#include "array.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+// Each worker fills its own temp memory and checks nobody else wrote into it.
+void temp_worker(int id, bool *result) {
+    TempScope scope;
+    int *data = memory::alloc_temp<int>(10000);
+    for(int i = 0; i < 10000; ++i) data[i] = id;
+    std::this_thread::yield();
+    bool ok = data != NULL;
+    for(int i = 0; i < 10000; ++i) ok = ok && data[i] == id;
+    *result = ok;
+}
+
+int main(int argc, char *argv[]) {
+    printf("STACK ALLOCATOR:\n");
+    {
+        // Reserve more than would fit into the old fixed 10 MB block.
+        StackAllocator allocator = memory::get_stack_allocator(MEGABYTES(256));
+        CHECK("reserve does not commit", allocator.storage && memory::get_committed_size(&allocator) == 0);
+
+        uint8_t *first = memory::alloc_stack<uint8_t>(&allocator, 1);
+        CHECK("first allocation commits pages", first && memory::get_committed_size(&allocator) > 0);
+
+        double *aligned = memory::alloc_stack<double>(&allocator, 1);
+        CHECK("default alignment follows type", ((uintptr_t)aligned % alignof(double)) == 0);
+
+        void *custom = memory::alloc_stack<uint8_t>(&allocator, 16, 256);
+        CHECK("custom alignment", ((uintptr_t)custom % 256) == 0);
+
+        StackAllocatorState state = memory::save_stack_state(&allocator);
+        float *big = memory::alloc_stack<float>(&allocator, MEGABYTES(16));
+        CHECK("grows past 10 MB", big != NULL);
+        big[MEGABYTES(16) - 1] = 1.0f;
+        CHECK("earlier pointers stay valid", (uint8_t *)first == (uint8_t *)allocator.storage);
+
+        uint32_t high_water = memory::get_high_water_mark(&allocator);
+        memory::load_stack_state(&allocator, state);
+        CHECK("high water survives state reload", memory::get_high_water_mark(&allocator) == high_water);
+        CHECK("high water covers big allocation", high_water >= MEGABYTES(64));
+
+        // Size check has to be in bytes, not in element count.
+        CHECK("out of reserve returns NULL", memory::alloc_stack<float>(&allocator, MEGABYTES(64)) == NULL);
+        // 2^29 + 1 doubles is 2^32 + 8 bytes, which would wrap to 8 bytes in 32 bits.
+        CHECK("oversized count returns NULL", memory::alloc_stack<double>(&allocator, (1u << 29) + 1) == NULL);
+
+        memory::release_stack_allocator(&allocator);
+        CHECK("release", allocator.storage == NULL && allocator.size == 0);
+    }
+
+    printf("TEMP ALLOCATOR:\n");
+    {
+        memory::push_temp_state();
+        int *data = memory::alloc_temp<int>(1000);
+        StackAllocatorState after_alloc = memory::save_stack_state(memory::get_temp_stack());
+        memory::push_temp_state();
+        memory::alloc_temp<int>(1000);
+        memory::pop_temp_state();
+        CHECK("pop restores inner scope", memory::save_stack_state(memory::get_temp_stack()) == after_alloc);
+        memory::pop_temp_state();
+        CHECK("pop restores outer scope", memory::save_stack_state(memory::get_temp_stack()) == 0);
+
+        {
+            TempScope scope;
+            memory::alloc_temp<int>(1000);
+        }
+        CHECK("TempScope restores state", memory::save_stack_state(memory::get_temp_stack()) == 0);
+
+        const int THREAD_COUNT = 8;
+        std::thread threads[THREAD_COUNT];
+        bool results[THREAD_COUNT] = {};
+        for(int i = 0; i < THREAD_COUNT; ++i) threads[i] = std::thread(temp_worker, i, &results[i]);
+        for(int i = 0; i < THREAD_COUNT; ++i) threads[i].join();
+        bool all_ok = true;
+        for(int i = 0; i < THREAD_COUNT; ++i) all_ok = all_ok && results[i];
+        CHECK("temp arenas are per-thread", all_ok);
+        CHECK("worker threads don't touch main arena", memory::save_stack_state(memory::get_temp_stack()) == 0);
+    }
+
+    printf("POOL:\n");
+    {
+        struct Record {
+            uint64_t id;
+            float value;
+        };
+        Pool<Record> records = pool::get<Record>(64, 1 << 20);
+        Record *first = pool::alloc(&records);
+        CHECK("alloc commits first chunk", first && records.capacity == 64);
+
+        Record *items[200];
+        items[0] = first;
+        for(int i = 1; i < 200; ++i) {
+            items[i] = pool::alloc(&records);
+            items[i]->id = i;
+        }
+        CHECK("grows in chunks", records.capacity == 256 && records.live_count == 200);
+        CHECK("slots are contiguous", pool::get_index(&records, items[199]) == 199);
+
+        pool::free(&records, items[10]);
+        pool::free(&records, items[20]);
+        Record *reused = pool::alloc(&records);
+        CHECK("free list reuses last freed slot", reused == items[20]);
+
+        uint32_t live = 0;
+        for(uint32_t i = 0; i < records.capacity; ++i) {
+            if(pool::get_item(&records, i)) live++;
+        }
+        CHECK("iteration skips free slots", live == 199 && !pool::get_item(&records, 10));
+
+        PoolStats stats = pool::get_stats(&records);
+        CHECK("stats", stats.alloc_count == 201 && stats.free_count == 2 && stats.live_count == 199);
+
+        Pool<Record> small = pool::get<Record>(4, 8);
+        for(int i = 0; i < 8; ++i) pool::alloc(&small);
+        CHECK("alloc past max count returns NULL", pool::alloc(&small) == NULL);
+
+        Pool<Record> uneven = pool::get<Record>(4, 10);
+        int uneven_count = 0;
+        while(pool::alloc(&uneven)) uneven_count++;
+        CHECK("last chunk is clamped to max count", uneven_count == 10 && uneven.capacity == 10);
+
+        pool::release(&uneven);
+        pool::release(&small);
+        pool::release(&records);
+        CHECK("release", records.slots == NULL && records.capacity == 0);
+    }
+
+    printf("TRACKING:\n");
+    {
+        memory::reset_stats();
+        int *data = memory::alloc_heap<int>(100, MEMORY_TAG_UI);
+        memory::free_heap(data, MEMORY_TAG_UI);
+        MemoryStats ui_stats = memory::get_stats(MEMORY_TAG_UI);
+        CHECK("heap allocs are tagged", ui_stats.heap_alloc_count == 1 && ui_stats.heap_alloc_bytes == 400);
+        CHECK("heap frees are tagged", ui_stats.heap_free_count == 1);
+        CHECK("other tags untouched", memory::get_stats(MEMORY_TAG_FONT).heap_alloc_count == 0);
+
+        Array<int> numbers = array::get<int>(2, MEMORY_TAG_ANIMATION);
+        for(int i = 0; i < 9; ++i) array::add(&numbers, i);
+        CHECK("array regrowths counted", memory::get_stats(MEMORY_TAG_ANIMATION).array_grow_count == 3);
+        array::release(&numbers);
+
+        StackAllocator allocator = memory::get_stack_allocator(MEGABYTES(1), MEMORY_TAG_RESOURCES);
+        memory::alloc_stack<uint8_t>(&allocator, 1000);
+        memory::load_stack_state(&allocator, 0);
+        memory::alloc_stack<uint8_t>(&allocator, 10);
+        CHECK("stack high water tracked per tag", memory::get_stats(MEMORY_TAG_RESOURCES).stack_high_water == 1000);
+        memory::release_stack_allocator(&allocator);
+
+        {
+            HotScope hot_scope("memory_test");
+            CHECK("inside hot scope", memory::is_in_hot_scope());
+            memory::alloc_temp<int>(100);
+            CHECK("temp allocation is not a heap allocation", memory::get_stats(MEMORY_TAG_GENERAL).hot_alloc_count == 0);
+            memory::free_heap(memory::alloc_heap<int>(1));
+        }
+        CHECK("heap allocation in hot scope reported", memory::get_stats(MEMORY_TAG_GENERAL).hot_alloc_count == 1);
+        CHECK("hot scope ends", !memory::is_in_hot_scope());
+    }
+
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#include "queue.h"
+
+#define CHECK(name, condition) {                \
+    printf("%-50s ", name);                     \
+    if(!(condition)) {                          \
+        printf("FAIL\n");                       \
+        return 1;                               \
+    }                                           \
+    printf("PASS\n");                           \
+}
+
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+const uint32_t ITEM_COUNT = 1 << 22;
+const uint32_t BATCH_SIZE = 64;
+
+/*
+
+SPSC throughput, producer pushes 0..ITEM_COUNT-1, consumer checks the order.
+
+*/
+
+void spsc_producer(SPSCQueue<uint32_t> *queue, uint32_t batch_size) {
+    uint32_t batch[BATCH_SIZE];
+    uint32_t next = 0;
+    while(next < ITEM_COUNT) {
+        uint32_t count = 0;
+        while(count < batch_size && next + count < ITEM_COUNT) {
+            batch[count] = next + count;
+            count++;
+        }
+        uint32_t pushed = queue::push_n(queue, batch, count);
+        if(pushed == 0) std::this_thread::yield();
+        next += pushed;
+    }
+}
+
+bool spsc_consumer(SPSCQueue<uint32_t> *queue, uint32_t batch_size) {
+    uint32_t batch[BATCH_SIZE];
+    uint32_t expected = 0;
+    bool in_order = true;
+    while(expected < ITEM_COUNT) {
+        uint32_t popped = queue::pop_n(queue, batch, batch_size);
+        if(popped == 0) std::this_thread::yield();
+        for(uint32_t i = 0; i < popped; ++i) {
+            in_order = in_order && batch[i] == expected++;
+        }
+    }
+    return in_order;
+}
+
+bool benchmark_spsc(uint32_t batch_size) {
+    SPSCQueue<uint32_t> queue;
+    queue::init(&queue, 4096);
+
+    double start = get_time_ms();
+    std::thread producer(spsc_producer, &queue, batch_size);
+    bool in_order = spsc_consumer(&queue, batch_size);
+    producer.join();
+    double time = get_time_ms() - start;
+
+    printf("SPSC batch %2u: %8.2f M items/s\n", batch_size, ITEM_COUNT / time / 1000.0);
+    queue::release(&queue);
+    return in_order;
+}
+
+/*
+
+MPMC throughput, every producer pushes its share of 1..ITEM_COUNT, consumers sum what they get.
+
+*/
+
+const int MPMC_THREAD_COUNT = 4;
+
+void mpmc_producer(MPMCQueue<uint32_t> *queue, uint32_t first, uint32_t last, uint32_t batch_size) {
+    uint32_t batch[BATCH_SIZE];
+    uint32_t next = first;
+    while(next < last) {
+        uint32_t count = 0;
+        while(count < batch_size && next + count < last) {
+            batch[count] = next + count;
+            count++;
+        }
+        uint32_t pushed = queue::push_n(queue, batch, count);
+        if(pushed == 0) std::this_thread::yield();
+        next += pushed;
+    }
+}
+
+void mpmc_consumer(MPMCQueue<uint32_t> *queue, std::atomic<uint32_t> *remaining, uint64_t *sum, uint32_t batch_size) {
+    uint32_t batch[BATCH_SIZE];
+    uint64_t local_sum = 0;
+    while(remaining->load(std::memory_order_relaxed) > 0) {
+        uint32_t popped = queue::pop_n(queue, batch, batch_size);
+        if(popped == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        for(uint32_t i = 0; i < popped; ++i) local_sum += batch[i];
+        remaining->fetch_sub(popped, std::memory_order_relaxed);
+    }
+    *sum = local_sum;
+}
+
+bool benchmark_mpmc(uint32_t batch_size) {
+    MPMCQueue<uint32_t> queue;
+    queue::init(&queue, 4096);
+    std::atomic<uint32_t> remaining(ITEM_COUNT);
+    uint64_t sums[MPMC_THREAD_COUNT] = {};
+
+    double start = get_time_ms();
+    std::thread producers[MPMC_THREAD_COUNT];
+    std::thread consumers[MPMC_THREAD_COUNT];
+    uint32_t share = ITEM_COUNT / MPMC_THREAD_COUNT;
+    for(int i = 0; i < MPMC_THREAD_COUNT; ++i) {
+        producers[i] = std::thread(mpmc_producer, &queue, 1 + share * i, 1 + share * (i + 1), batch_size);
+        consumers[i] = std::thread(mpmc_consumer, &queue, &remaining, &sums[i], batch_size);
+    }
+    for(int i = 0; i < MPMC_THREAD_COUNT; ++i) {
+        producers[i].join();
+        consumers[i].join();
+    }
+    double time = get_time_ms() - start;
+
+    uint64_t sum = 0;
+    for(int i = 0; i < MPMC_THREAD_COUNT; ++i) sum += sums[i];
+    uint64_t expected = uint64_t(ITEM_COUNT) * (ITEM_COUNT + 1) / 2;
+
+    printf("MPMC %dx%d batch %2u: %8.2f M items/s\n", MPMC_THREAD_COUNT, MPMC_THREAD_COUNT, batch_size,
+           ITEM_COUNT / time / 1000.0);
+    queue::release(&queue);
+    return sum == expected;
+}
+
+int main(int argc, char *argv[]) {
+    printf("SPSC QUEUE:\n");
+    {
+        SPSCQueue<int> queue;
+        queue::init(&queue, 5);
+        CHECK("capacity rounded to power of 2", queue.capacity == 8);
+
+        int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        CHECK("push_n stops when full", queue::push_n(&queue, items, 10) == 8);
+        CHECK("push fails when full", !queue::push(&queue, 10));
+
+        int out[10];
+        CHECK("pop_n", queue::pop_n(&queue, out, 3) == 3 && out[0] == 0 && out[2] == 2);
+        CHECK("push_n wraps around", queue::push_n(&queue, items, 3) == 3);
+        uint32_t popped = queue::pop_n(&queue, out, 10);
+        CHECK("pop_n wraps around", popped == 8 && out[4] == 7 && out[5] == 0 && out[7] == 2);
+        int item;
+        CHECK("pop fails when empty", !queue::pop(&queue, &item));
+        queue::release(&queue);
+    }
+
+    printf("MPMC QUEUE:\n");
+    {
+        MPMCQueue<int> queue;
+        queue::init(&queue, 8);
+        int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        CHECK("push_n stops when full", queue::push_n(&queue, items, 10) == 8);
+        CHECK("push fails when full", !queue::push(&queue, 10));
+
+        int out[10];
+        CHECK("pop_n", queue::pop_n(&queue, out, 3) == 3 && out[0] == 0 && out[2] == 2);
+        // Queue is neither full nor empty here.
+        CHECK("push_n and pop_n of 0 items", queue::push_n(&queue, items, 0) == 0 && queue::pop_n(&queue, out, 0) == 0);
+        CHECK("push_n wraps around", queue::push_n(&queue, items, 3) == 3);
+        uint32_t popped = queue::pop_n(&queue, out, 10);
+        CHECK("pop_n wraps around", popped == 8 && out[4] == 7 && out[5] == 0 && out[7] == 2);
+        int item;
+        CHECK("pop fails when empty", !queue::pop(&queue, &item));
+        queue::release(&queue);
+    }
+
+    printf("BENCHMARK (%u items):\n", ITEM_COUNT);
+    {
+        bool spsc_single = benchmark_spsc(1);
+        bool spsc_batch = benchmark_spsc(BATCH_SIZE);
+        CHECK("SPSC keeps order", spsc_single && spsc_batch);
+
+        bool mpmc_single = benchmark_mpmc(1);
+        bool mpmc_batch = benchmark_mpmc(BATCH_SIZE);
+        CHECK("MPMC delivers every item once", mpmc_single && mpmc_batch);
+    }
+
+    return 0;
+}
\ No newline at end of file
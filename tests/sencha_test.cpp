@@ -1,6 +1,14 @@
 
+#include <stdio.h>
+#include <chrono>
+#include <math.h>
+#define CPPLIB_MEMORY_IMPL
+#include "memory.h"
+#define CPPLIB_JOBS_IMPL
+#include "jobs.h"
 #define CPPLIB_MATHS_IMPL
-#include "math.h"
+#include "maths.h"
+#define CPPLIB_SENCHA_JOBS
 #define CPPLIB_SENCHA_IMPL
 #include "sencha.h"
 
@@ -11,6 +19,43 @@ struct TestCase {
     float result;
 };
 
+double get_time_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+void init_test_variables(SenchaTable *var_table) {
+    sencha::add_or_set_variable(var_table, "xx", 1.0f);
+    sencha::add_or_set_variable(var_table, "y", 2.0f);
+    sencha::add_or_set_variable(var_table, "z", 3.0f);
+    sencha::add_or_set_variable(var_table, "t", 0.0f);
+}
+
+// Compares batch results against evaluating the line element by element, `t` and `y` vary per element.
+bool check_batch(SenchaExpression *expression, SenchaTable *var_table, float *t, float *y, float *out, uint32_t count,
+                 uint32_t stride = 1) {
+    SenchaBatchInput inputs[] = {
+        SenchaBatchInput{"t", t},
+        SenchaBatchInput{"y", y},
+    };
+    if(!sencha::eval(expression, var_table, inputs, ARRAYSIZE(inputs), out, count)) {
+        return false;
+    }
+    float t_original, y_original;
+    sencha::get_variable(var_table, "t", &t_original);
+    sencha::get_variable(var_table, "y", &y_original);
+    bool correct = true;
+    for(uint32_t i = 0; i < count; i += stride) {
+        sencha::add_or_set_variable(var_table, "t", t[i]);
+        sencha::add_or_set_variable(var_table, "y", y[i]);
+        float expected = sencha::eval(expression, var_table);
+        correct = correct && fabsf(out[i] - expected) <= 1e-5f * (1.0f + fabsf(expected));
+    }
+    sencha::add_or_set_variable(var_table, "t", t_original);
+    sencha::add_or_set_variable(var_table, "y", y_original);
+    return correct;
+}
+
 int main(int argc, char *argv[]) {
     // Test cases which we expect to succeed.
     TestCase test_success[] = {
@@ -22,16 +67,21 @@ int main(int argc, char *argv[]) {
         TestCase{"x = y + z", 5.0f},
         TestCase{"x = 1 + 3 + 4 + 5", 13.0f},
         TestCase{"x = sin(t) * 0.25f + 0.75f", 0.75f},
+        TestCase{"x = min(y, z) + max(1, 2)", 4.0f},
+        TestCase{"x = clamp(5, 0, z)", 3.0f},
+        TestCase{"x = pow(y, 3)", math::pow(2.0f, 3.0f)},
+        TestCase{"x = abs(0 - y) + floor(2.5)", 4.0f},
+        TestCase{"x = lerp(y, z, sin(xx))", math::lerp(2.0f, 3.0f, math::sin(1.0f))},
+        TestCase{"x = smoothstep(0, 4, y)", 0.5f},
+        TestCase{"x = noise(z) + noise(0.5) * 0", 0.0f},
+        TestCase{"x = max(min(y, 1 + z), 0) * 2", 4.0f},
     };
 
     printf("EXPECTED SUCCESS:\n");
     for(int i = 0; i < ARRAYSIZE(test_success); ++i) {
         // Initialize variable table.
         SenchaTable var_table;
-        sencha::add_or_set_variable(&var_table, "xx", 1.0f);
-        sencha::add_or_set_variable(&var_table, "y", 2.0f);
-        sencha::add_or_set_variable(&var_table, "z", 3.0f);
-        sencha::add_or_set_variable(&var_table, "t", 0.0f);
+        init_test_variables(&var_table);
 
         // Parse.
         printf("%-30s ", test_success[i].line);
@@ -62,6 +112,7 @@ int main(int argc, char *argv[]) {
         }
         
         // The test passed!
+        sencha::release(&var_table);
         printf("PASS\n");
     }
 
@@ -81,7 +132,17 @@ int main(int argc, char *argv[]) {
         "x = sin(+5)",
         "x = sin + 5",
         "x = y + z"
-        ""
+        "",
+        "x = sinus(1)",
+        "x = si(1)",
+        "x = min(1)",
+        "x = pow(1, 2, 3)",
+        "x = clamp(1, 2,)",
+        "x = floor()",
+        "x = abs(1) , 2",
+        "x = (1, 2)",
+        "x",
+        "x + 1",
     };
 
     printf("EXPECTED FAIL:\n");
@@ -102,6 +163,7 @@ int main(int argc, char *argv[]) {
         }
 
         // Parsing failed correctly.
+        sencha::release(&var_table);
         printf("PASS\n");
 
         // Optionally we can print the error message.
@@ -109,5 +171,590 @@ int main(int argc, char *argv[]) {
             printf("%s\n", sencha_error_buffer);
         }
     }
+
+    // Compiled lines have to give exactly the same results as parse_line.
+    printf("EXPECTED SUCCESS (COMPILED):\n");
+    for(int i = 0; i < ARRAYSIZE(test_success); ++i) {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+
+        // Compile.
+        printf("%-30s ", test_success[i].line);
+        SenchaExpression expression;
+        bool result = sencha::compile_line(test_success[i].line, &var_table, &expression);
+        if(!result) {
+            printf("FAIL\n");
+            printf("FAILED TO COMPILE: %s\n", test_success[i].line);
+            printf("%s\n", sencha_error_buffer);
+            break;
+        }
+
+        // Evaluate twice, the second evaluation must not depend on state left by the first one.
+        float v = sencha::eval(&expression, &var_table);
+        v = sencha::eval(&expression, &var_table);
+        float assigned;
+        sencha::get_variable(&var_table, "x", &assigned);
+        if(v != test_success[i].result || assigned != v) {
+            printf("FAIL\n");
+            printf("WRONG RESULT %f, expected %f \n", v, test_success[i].result);
+            break;
+        }
+        sencha::release(&var_table);
+        printf("PASS\n");
+    }
+
+    // Optimized lines have to give the same results too, constant lines fold into a single instruction.
+    printf("EXPECTED SUCCESS (OPTIMIZED):\n");
+    for(int i = 0; i < ARRAYSIZE(test_success); ++i) {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+
+        printf("%-30s ", test_success[i].line);
+        SenchaExpression expression;
+        sencha::compile_line(test_success[i].line, &var_table, &expression);
+        bool is_constant = true;
+        for(int j = 0; j < expression.instruction_count; ++j) {
+            is_constant = is_constant && expression.instructions[j].opcode != SENCHA_OP_VARIABLE;
+        }
+        SenchaOptimizationStats stats = sencha::optimize(&expression);
+        float v = sencha::eval(&expression, &var_table);
+        if(v != test_success[i].result || (is_constant && stats.instruction_count_after != 1) ||
+           stats.instruction_count_after > stats.instruction_count_before) {
+            printf("FAIL\n");
+            printf("WRONG RESULT %f, expected %f, %d instructions\n", v, test_success[i].result, stats.instruction_count_after);
+            break;
+        }
+        sencha::release(&var_table);
+        printf("PASS\n");
+    }
+
+    printf("EXPECTED FAIL (COMPILED):\n");
+    for(int i = 0; i < ARRAYSIZE(test_fail); ++i) {
+        SenchaTable var_table;
+        sencha::add_or_set_variable(&var_table, "z", 3.0f);
+
+        printf("%-30s ", test_fail[i]);
+        SenchaExpression expression;
+        bool result = sencha::compile_line(test_fail[i], &var_table, &expression);
+        if(result) {
+            printf("FAIL\n");
+            printf("SHOULD FAIL TO COMPILE: %s\n", test_fail[i]);
+            break;
+        }
+        // Failed lines must not create the assigned variable.
+        float v;
+        if(sencha::get_variable(&var_table, "x", &v)) {
+            printf("FAIL\n");
+            printf("VARIABLE CREATED BY FAILED LINE: %s\n", test_fail[i]);
+            break;
+        }
+        sencha::release(&var_table);
+        printf("PASS\n");
+    }
+
+    // Batch evaluation, counts which aren't multiples of the SIMD width or block size included.
+    printf("BATCH EVAL:\n");
+    const uint32_t BATCH_COUNT = 1000000;
+    float *batch_t = (float *)malloc(BATCH_COUNT * sizeof(float));
+    float *batch_y = (float *)malloc(BATCH_COUNT * sizeof(float));
+    float *batch_out = (float *)malloc(BATCH_COUNT * sizeof(float));
+    for(uint32_t i = 0; i < BATCH_COUNT; ++i) {
+        batch_t[i] = i * 0.001f - 300.0f;
+        batch_y[i] = 1.0f + (i % 1000) * 0.01f;
+    }
+    char *batch_lines[] = {
+        "x = sin(t) * 0.25f + 0.75f",
+        "x = (y + z) * (xx - 3.1415 / 2.0f) + cos(t * 2 + y) / z",
+        "x = 5 + (1)",
+        "x = z",
+        "x = smoothstep(0, 4, y) * noise(t) + clamp(t, 0 - 1, y)",
+    };
+    uint32_t batch_counts[] = {0, 1, 3, 4, 63, 64, 65, 1000, 20001};
+    for(int i = 0; i < ARRAYSIZE(batch_lines); ++i) {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        SenchaExpression expression;
+        sencha::compile_line(batch_lines[i], &var_table, &expression);
+
+        printf("%-30.30s ", batch_lines[i]);
+        bool correct = true;
+        for(int j = 0; j < ARRAYSIZE(batch_counts); ++j) {
+            correct = correct && check_batch(&expression, &var_table, batch_t, batch_y, batch_out, batch_counts[j]);
+        }
+        if(!correct) {
+            printf("FAIL\n");
+            break;
+        }
+        sencha::release(&var_table);
+        printf("PASS\n");
+    }
+    {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        SenchaExpression expression;
+        sencha::compile_line("x = t", &var_table, &expression);
+        SenchaBatchInput input = SenchaBatchInput{"w", batch_t};
+        printf("%-30s ", "unknown input variable");
+        printf(sencha::eval(&expression, &var_table, &input, 1, batch_out, 16) ? "FAIL\n" : "PASS\n");
+
+        jobs::init();
+        sencha::compile_line("x = sin(t) * 0.25f + 0.75f", &var_table, &expression);
+        printf("%-30s ", "with job system");
+        printf(check_batch(&expression, &var_table, batch_t, batch_y, batch_out, BATCH_COUNT, 7) ? "PASS\n" : "FAIL\n");
+        jobs::release();
+        sencha::release(&var_table);
+    }
+
+    // Variable table growth and access by slot.
+    printf("SLOTS:\n");
+    {
+        const int VARIABLE_COUNT = 1000;
+        SenchaTable var_table;
+        char name[32];
+        bool correct = true;
+        for(int i = 0; i < VARIABLE_COUNT; ++i) {
+            // Names are copied into the table, so the buffer can be reused.
+            snprintf(name, sizeof(name), "v_%c%c%c", 'a' + i / 100, 'a' + i / 10 % 10, 'a' + i % 10);
+            int slot = sencha::add_variable(&var_table, name);
+            sencha::set_value(&var_table, slot, float(i));
+            correct = correct && slot == i && sencha::add_variable(&var_table, name) == i;
+        }
+        for(int i = 0; i < VARIABLE_COUNT; ++i) {
+            snprintf(name, sizeof(name), "v_%c%c%c", 'a' + i / 100, 'a' + i / 10 % 10, 'a' + i % 10);
+            float v = -1.0f;
+            correct = correct && sencha::get_slot(&var_table, name) == i &&
+                      sencha::get_variable(&var_table, name, &v) && v == float(i) &&
+                      strcmp(var_table.variable_names[i].data, name) == 0;
+        }
+        printf("%-30s %s\n", "1000 variables", correct ? "PASS" : "FAIL");
+
+        correct = sencha::get_slot(&var_table, "v_") == -1 && sencha::get_slot(&var_table, "v_aaaa") == -1;
+        printf("%-30s %s\n", "missing variables", correct ? "PASS" : "FAIL");
+
+        SenchaExpression expression;
+        correct = sencha::compile_line("result = v_jjj - v_aab * 2", &var_table, &expression) &&
+                  sencha::eval(&expression, &var_table) == 997.0f &&
+                  sencha::get_value(&var_table, sencha::get_slot(&var_table, "result")) == 997.0f;
+        printf("%-30s %s\n", "compile with 1000 variables", correct ? "PASS" : "FAIL");
+
+        sencha::release(&var_table);
+        correct = var_table.variable_values.count == 0 && sencha::get_slot(&var_table, "v_aaa") == -1;
+        printf("%-30s %s\n", "release", correct ? "PASS" : "FAIL");
+    }
+
+    // Programs, lines are out of order on purpose.
+    printf("PROGRAM:\n");
+    {
+        char *script =
+            "e = c + d\n"
+            "a = t * 2\n"
+            "\n"
+            "b = a + 1\r\n"
+            "c = sin(b)\n"
+            "d = y * 3\n"
+            "h = t * 0\n"
+            "k = h + 5";
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        SenchaProgram program;
+        bool result = sencha::compile_program(script, &var_table, &program);
+        if(!result) {
+            printf("%s\n", sencha_error_buffer);
+        }
+
+        // Lines recomputed by each update: everything, nothing, y's dependents, t's dependents except `k`,
+        // since `h` stays 0.
+        uint32_t expected_counts[] = {7, 0, 2, 5};
+        float t_values[] = {0.5f, 0.5f, 0.5f, 1.5f};
+        float y_values[] = {2.0f, 2.0f, 4.0f, 4.0f};
+        char *labels[] = {"first update", "unchanged inputs", "y changed", "t changed"};
+        for(int i = 0; result && i < ARRAYSIZE(expected_counts); ++i) {
+            sencha::add_or_set_variable(&var_table, "t", t_values[i]);
+            sencha::add_or_set_variable(&var_table, "y", y_values[i]);
+            uint32_t count = sencha::update(&program, &var_table);
+
+            float a = t_values[i] * 2;
+            float c = math::sin(a + 1);
+            float e, k;
+            sencha::get_variable(&var_table, "e", &e);
+            sencha::get_variable(&var_table, "k", &k);
+            bool correct = count == expected_counts[i] && e == c + y_values[i] * 3 && k == 5.0f;
+            printf("%-30s %s\n", labels[i], correct ? "PASS" : "FAIL");
+            if(!correct) {
+                printf("RECOMPUTED %u LINES, expected %u, e = %f\n", count, expected_counts[i], e);
+                break;
+            }
+        }
+        sencha::release(&program);
+        sencha::release(&var_table);
+    }
+    {
+        TestCase test_program_fail[] = {
+            TestCase{"a = t\na = 2", 2},
+            TestCase{"a = b\nb = a", 1},
+            TestCase{"a = a + 1", 1},
+            TestCase{"c = a\na = b\nb = a", 2},
+            TestCase{"c = a + b\n\nb = 1\nd = c\na = d", 1},
+            TestCase{"a = 1\n\nb = undefined_var", 3},
+            TestCase{"a = 1\n3 + 4", 2},
+        };
+        for(int i = 0; i < ARRAYSIZE(test_program_fail); ++i) {
+            SenchaTable var_table;
+            init_test_variables(&var_table);
+            SenchaProgram program;
+            bool result = sencha::compile_program(test_program_fail[i].line, &var_table, &program);
+
+            // Errors point at the offending line.
+            char expected_error[32];
+            snprintf(expected_error, sizeof(expected_error), "Line %d:", int(test_program_fail[i].result));
+            bool correct = !result && strncmp(sencha_error_buffer, expected_error, strlen(expected_error)) == 0;
+            char label[64];
+            snprintf(label, sizeof(label), "fails: %s", test_program_fail[i].line);
+            for(char *c = label; *c; ++c) if(*c == '\n') *c = '|';
+            printf("%-30s %s\n", label, correct ? "PASS" : "FAIL");
+            if(!correct) {
+                printf("%s\n", sencha_error_buffer);
+                break;
+            }
+            sencha::release(&var_table);
+        }
+    }
+
+    // Optimized program against the same program left as compiled, results have to match exactly.
+    printf("OPTIMIZATION:\n");
+    {
+        char *script =
+            "a = sin(t) * 2\n"
+            "b = sin(t) + half\n"
+            "half = pi / 2.0f\n"
+            "pi = 3.1415\n"
+            "c = cos(t * y) + sin(t) * 2\n"
+            "d = c * (pi - 1)";
+        SenchaTable var_table, optimized_var_table;
+        init_test_variables(&var_table);
+        init_test_variables(&optimized_var_table);
+        SenchaProgram program, optimized_program;
+        bool result = sencha::compile_program(script, &var_table, &program) &&
+                      sencha::compile_program(script, &optimized_var_table, &optimized_program);
+        SenchaOptimizationStats stats = sencha::optimize(&optimized_program, &optimized_var_table);
+
+        // `sin(t) * 2` is read from `a` by `c`, then `sin(t)` gets a hidden variable shared by `a` and `b`.
+        bool correct = result && stats.shared_subexpression_count == 2 && sencha::get_slot(&optimized_var_table, "#0") >= 0;
+        printf("%-30s %s\n", "shared subexpressions", correct ? "PASS" : "FAIL");
+        printf("    %d instructions, %d optimized\n", stats.instruction_count_before, stats.instruction_count_after);
+
+        char *names[] = {"a", "b", "c", "d", "half"};
+        float t_values[] = {0.5f, 0.5f, -2.0f, 100.0f};
+        for(int i = 0; result && i < ARRAYSIZE(t_values); ++i) {
+            sencha::add_or_set_variable(&var_table, "t", t_values[i]);
+            sencha::add_or_set_variable(&optimized_var_table, "t", t_values[i]);
+            sencha::update(&program, &var_table);
+            sencha::update(&optimized_program, &optimized_var_table);
+            for(int j = 0; j < ARRAYSIZE(names); ++j) {
+                float expected, v;
+                sencha::get_variable(&var_table, names[j], &expected);
+                sencha::get_variable(&optimized_var_table, names[j], &v);
+                correct = correct && v == expected;
+            }
+        }
+        printf("%-30s %s\n", "same results", correct ? "PASS" : "FAIL");
+        sencha::release(&program);
+        sencha::release(&optimized_program);
+        sencha::release(&var_table);
+        sencha::release(&optimized_var_table);
+    }
+
+    // Functions registered by the user are called like builtins by every evaluation path.
+    printf("FUNCTIONS:\n");
+    {
+        struct UserFunctions {
+            static float triple(float x) { return x * 3.0f; }
+            static float weighted(float a, float b, float w) { return a * w + b * (1.0f - w); }
+        };
+        bool correct = sencha::register_function("triple", UserFunctions::triple) &&
+                       sencha::register_function("weighted", UserFunctions::weighted) &&
+                       !sencha::register_function("triple", UserFunctions::triple) &&
+                       !sencha::register_function("min", UserFunctions::triple);
+        printf("%-30s %s\n", "register", correct ? "PASS" : "FAIL");
+
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        char *line = "x = weighted(triple(t), y, 0.25) - triple(2)";
+        SenchaExpression expression;
+        correct = sencha::parse_line(line, &var_table) && sencha::compile_line(line, &var_table, &expression);
+        for(int i = 0; correct && i < 5; ++i) {
+            float t = i * 0.5f;
+            float expected = UserFunctions::weighted(UserFunctions::triple(t), 2.0f, 0.25f) - UserFunctions::triple(2.0f);
+            sencha::add_or_set_variable(&var_table, "t", t);
+            float parsed;
+            sencha::parse_line(line, &var_table);
+            sencha::get_variable(&var_table, "x", &parsed);
+            correct = parsed == expected && sencha::eval(&expression, &var_table) == expected;
+        }
+        printf("%-30s %s\n", "user functions", correct ? "PASS" : "FAIL");
+
+        SenchaOptimizationStats stats = sencha::optimize(&expression);
+        correct = stats.instruction_count_after == stats.instruction_count_before - 1 &&
+                  check_batch(&expression, &var_table, batch_t, batch_y, batch_out, 1000);
+        SenchaNativeCode native_code;
+        if(sencha::compile_native(&expression, &native_code)) {
+            correct = correct && sencha::eval(&native_code, &var_table) == sencha::eval(&expression, &var_table);
+            sencha::release(&native_code);
+        }
+        printf("%-30s %s\n", "optimized, batch, native", correct ? "PASS" : "FAIL");
+
+        correct = !sencha::compile_line("x = triple(1, 2)", &var_table, &expression) &&
+                  !sencha::parse_line("x = weighted(1, 2)", &var_table);
+        printf("%-30s %s\n", "wrong argument count", correct ? "PASS" : "FAIL");
+        sencha::release(&var_table);
+    }
+
+    // Native code has to give exactly the same results as the interpreter.
+    printf("NATIVE:\n");
+    for(int i = 0; i < ARRAYSIZE(test_success); ++i) {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+
+        printf("%-30s ", test_success[i].line);
+        SenchaExpression expression;
+        SenchaNativeCode native_code;
+        sencha::compile_line(test_success[i].line, &var_table, &expression);
+        if(!sencha::compile_native(&expression, &native_code)) {
+            printf("FAIL\n");
+            printf("%s\n", sencha_error_buffer);
+            break;
+        }
+        float v = sencha::eval(&native_code, &var_table);
+        float assigned;
+        sencha::get_variable(&var_table, "x", &assigned);
+        sencha::release(&native_code);
+        if(v != test_success[i].result || assigned != v) {
+            printf("FAIL\n");
+            printf("WRONG RESULT %f, expected %f \n", v, test_success[i].result);
+            break;
+        }
+        sencha::release(&var_table);
+        printf("PASS\n");
+    }
+    {
+        // Every register in use, with calls spilling the values below their argument.
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        char line[256] = "x = ";
+        for(int i = 0; i < 15; ++i) strcat(line, i % 2 ? "t * sin(" : "y - cos(");
+        strcat(line, "z");
+        for(int i = 0; i < 15; ++i) strcat(line, ")");
+        SenchaExpression expression;
+        SenchaNativeCode native_code;
+        bool correct = sencha::compile_line(line, &var_table, &expression) && expression.stack_size == 16 &&
+                       sencha::compile_native(&expression, &native_code);
+        for(int i = 0; correct && i < 10; ++i) {
+            sencha::add_or_set_variable(&var_table, "t", i * 0.37f - 1.0f);
+            correct = sencha::eval(&native_code, &var_table) == sencha::eval(&expression, &var_table);
+        }
+        sencha::release(&native_code);
+        printf("%-30s %s\n", "16 registers", correct ? "PASS" : "FAIL");
+
+        // One level deeper doesn't fit the registers, the line stays interpreted.
+        sencha::compile_line("x = 1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - (1 - t)))))))))))))))",
+                             &var_table, &expression);
+        correct = expression.stack_size == 17 && !sencha::compile_native(&expression, &native_code) && native_code.memory == NULL;
+        printf("%-30s %s\n", "too deep falls back", correct ? "PASS" : "FAIL");
+        sencha::release(&var_table);
+    }
+    {
+        char *script =
+            "e = c + d\n"
+            "a = t * 2\n"
+            "b = a + 1\n"
+            "c = sin(b) / cos(a) + sin(t)\n"
+            "d = y * 3 - sin(t)";
+        SenchaTable var_table, native_var_table;
+        init_test_variables(&var_table);
+        init_test_variables(&native_var_table);
+        SenchaProgram program, native_program;
+        bool correct = sencha::compile_program(script, &var_table, &program) &&
+                       sencha::compile_program(script, &native_var_table, &native_program);
+        sencha::optimize(&native_program, &native_var_table);
+        correct = correct && sencha::compile_native(&native_program);
+        float t_values[] = {0.5f, 0.5f, -2.0f, 100.0f};
+        for(int i = 0; correct && i < ARRAYSIZE(t_values); ++i) {
+            sencha::add_or_set_variable(&var_table, "t", t_values[i]);
+            sencha::add_or_set_variable(&native_var_table, "t", t_values[i]);
+            sencha::update(&program, &var_table);
+            sencha::update(&native_program, &native_var_table);
+            float expected, v;
+            sencha::get_variable(&var_table, "e", &expected);
+            sencha::get_variable(&native_var_table, "e", &v);
+            correct = v == expected;
+        }
+        printf("%-30s %s\n", "optimized program", correct ? "PASS" : "FAIL");
+        sencha::release(&program);
+        sencha::release(&native_program);
+        sencha::release(&var_table);
+        sencha::release(&native_var_table);
+    }
+
+    // Evaluating the same line every frame, re-parsed by parse_line versus compiled once.
+    printf("BENCHMARK:\n");
+    {
+        const int ITERATIONS = 1000000;
+        char *lines[] = {
+            "x = sin(t) * 0.25f + 0.75f",
+            "x = (y + z) * (xx - 3.1415 / 2.0f) + cos(t * 2 + y) / z",
+        };
+        for(int i = 0; i < ARRAYSIZE(lines); ++i) {
+            SenchaTable var_table;
+            init_test_variables(&var_table);
+            volatile float sink = 0.0f;
+
+            double start = get_time_ms();
+            for(int j = 0; j < ITERATIONS; ++j) {
+                sencha::parse_line(lines[i], &var_table);
+                float v;
+                sencha::get_variable(&var_table, "x", &v);
+                sink = sink + v;
+            }
+            double parse_time = get_time_ms() - start;
+
+            SenchaExpression expression;
+            sencha::compile_line(lines[i], &var_table, &expression);
+            start = get_time_ms();
+            for(int j = 0; j < ITERATIONS; ++j) {
+                sink = sink + sencha::eval(&expression, &var_table);
+            }
+            double eval_time = get_time_ms() - start;
+
+            SenchaOptimizationStats stats = sencha::optimize(&expression);
+            start = get_time_ms();
+            for(int j = 0; j < ITERATIONS; ++j) {
+                sink = sink + sencha::eval(&expression, &var_table);
+            }
+            double optimized_time = get_time_ms() - start;
+
+            SenchaNativeCode native_code;
+            sencha::compile_native(&expression, &native_code);
+            start = get_time_ms();
+            for(int j = 0; j < ITERATIONS; ++j) {
+                sink = sink + sencha::eval(&native_code, &var_table);
+            }
+            double native_time = get_time_ms() - start;
+            sencha::release(&native_code);
+
+            printf("%s\n", lines[i]);
+            printf("    %d instructions, parse_line: %8.2f ms, eval: %8.2f ms (%.1fx)\n",
+                   stats.instruction_count_before, parse_time, eval_time, parse_time / eval_time);
+            printf("    %d instructions optimized, eval: %8.2f ms (%.1fx)\n",
+                   stats.instruction_count_after, optimized_time, parse_time / optimized_time);
+            printf("    native: %8.2f ms (%.1fx)\n", native_time, parse_time / native_time);
+            sencha::release(&var_table);
+        }
+    }
+
+    // One line over a million values of t, evaluated one by one versus batched.
+    {
+        SenchaTable var_table;
+        init_test_variables(&var_table);
+        SenchaExpression expression;
+        sencha::compile_line("x = sin(t) * 0.25f + 0.75f", &var_table, &expression);
+        SenchaBatchInput input = SenchaBatchInput{"t", batch_t};
+
+        double start = get_time_ms();
+        for(uint32_t i = 0; i < BATCH_COUNT; ++i) {
+            sencha::add_or_set_variable(&var_table, "t", batch_t[i]);
+            batch_out[i] = sencha::eval(&expression, &var_table);
+        }
+        double by_name_time = get_time_ms() - start;
+
+        int t_slot = sencha::get_slot(&var_table, "t");
+        start = get_time_ms();
+        for(uint32_t i = 0; i < BATCH_COUNT; ++i) {
+            sencha::set_value(&var_table, t_slot, batch_t[i]);
+            batch_out[i] = sencha::eval(&expression, &var_table);
+        }
+        double single_time = get_time_ms() - start;
+
+        start = get_time_ms();
+        sencha::eval(&expression, &var_table, &input, 1, batch_out, BATCH_COUNT);
+        double batch_time = get_time_ms() - start;
+
+        jobs::init();
+        start = get_time_ms();
+        sencha::eval(&expression, &var_table, &input, 1, batch_out, BATCH_COUNT);
+        double threaded_time = get_time_ms() - start;
+        uint32_t thread_count = jobs::get_thread_count();
+        jobs::release();
+
+        printf("x = sin(t) * 0.25f + 0.75f over %u values\n", BATCH_COUNT);
+        printf("    eval per value, t set by name: %8.2f ms, by slot: %8.2f ms\n", by_name_time, single_time);
+        printf("    batch: %8.2f ms (%.1fx), batch on %u threads: %8.2f ms (%.1fx)\n",
+               batch_time, single_time / batch_time, thread_count, threaded_time, single_time / threaded_time);
+        sencha::release(&var_table);
+    }
+
+    // 1000 line program made of 10 chains of 100 lines, each chain driven by its own input. Changing one input
+    // recomputes one chain, instead of every line.
+    {
+        const int CHAIN_COUNT = 10;
+        const int LINE_COUNT = 1000;
+        char *script = (char *)malloc(LINE_COUNT * 64);
+        char *cursor = script;
+        SenchaTable var_table;
+        for(int i = 0; i < CHAIN_COUNT; ++i) {
+            char name[16];
+            snprintf(name, sizeof(name), "in_%c", 'a' + i);
+            sencha::add_or_set_variable(&var_table, name, float(i));
+        }
+        for(int i = 0; i < LINE_COUNT; ++i) {
+            char previous[16] = "1";
+            if(i >= CHAIN_COUNT) {
+                snprintf(previous, sizeof(previous), "v_%c%c%c", 'a' + (i - CHAIN_COUNT) / 100, 'a' + (i - CHAIN_COUNT) / 10 % 10, 'a' + (i - CHAIN_COUNT) % 10);
+            }
+            cursor += sprintf(cursor, "v_%c%c%c = in_%c * 0.5 + sin(%s)\n", 'a' + i / 100, 'a' + i / 10 % 10, 'a' + i % 10, 'a' + i % CHAIN_COUNT, previous);
+        }
+
+        SenchaProgram program;
+        sencha::compile_program(script, &var_table, &program);
+        sencha::update(&program, &var_table);
+        int input_slot = sencha::get_slot(&var_table, "in_c");
+
+        const int FRAMES = 1000;
+        double start = get_time_ms();
+        for(int i = 0; i < FRAMES; ++i) {
+            sencha::set_value(&var_table, input_slot, float(i));
+            for(uint32_t j = 0; j < program.lines.count; ++j) {
+                sencha::eval(&program.lines[j], &var_table);
+            }
+        }
+        double all_time = get_time_ms() - start;
+
+        uint32_t recomputed = 0;
+        start = get_time_ms();
+        for(int i = 0; i < FRAMES; ++i) {
+            sencha::set_value(&var_table, input_slot, float(i) + 0.5f);
+            recomputed += sencha::update(&program, &var_table);
+        }
+        double update_time = get_time_ms() - start;
+
+        sencha::compile_native(&program);
+        start = get_time_ms();
+        for(int i = 0; i < FRAMES; ++i) {
+            sencha::set_value(&var_table, input_slot, float(i));
+            sencha::update(&program, &var_table);
+        }
+        double native_update_time = get_time_ms() - start;
+
+        printf("1000 line program, one of 10 inputs changed per frame, %d frames\n", FRAMES);
+        printf("    every line: %8.2f ms, update: %8.2f ms (%.1fx), %u lines recomputed per frame\n",
+               all_time, update_time, all_time / update_time, recomputed / FRAMES);
+        printf("    native update: %8.2f ms (%.1fx)\n", native_update_time, all_time / native_update_time);
+        sencha::release(&program);
+        sencha::release(&var_table);
+        free(script);
+    }
+
+    free(batch_t);
+    free(batch_y);
+    free(batch_out);
     return 0;
 }
\ No newline at end of file
@@ -87,26 +87,18 @@ bool ui::is_registering_input() {
 
 This section defines allocator for per-frame temporary data.
 
+All per-frame data (item arrays and line points) lives in a single arena,
+which is reset as a whole in `ui::end_frame`. The arena only commits memory
+as it grows, so pointers handed out during a frame stay valid.
+
 */
 
-const int INITIAL_POOL_SIZE = 1024 * 1024;
-int pool_size = INITIAL_POOL_SIZE;
-int pool_top = 0;
-uint8_t *pool = (uint8_t *)malloc(pool_size);
+const uint32_t FRAME_ARENA_SIZE = MEGABYTES(256);
+StackAllocator frame_allocator = memory::get_stack_allocator(FRAME_ARENA_SIZE, MEMORY_TAG_UI);
 
 void *alloc_temp(int bytes) {
-    // Reallocate if pool too small.
-    if(pool_top + bytes > pool_size) {
-        pool_size = pool_size * 2;
-        pool = (uint8_t *)realloc(pool, pool_size);
-    }
-
-    // Get return pointer.
-    void *allocated_data_ptr = pool + pool_top;
-
-    // "Allocate" the memory.
-    pool_top += bytes;
-
+    void *allocated_data_ptr = memory::alloc_stack<uint8_t>(&frame_allocator, bytes, 16);
+    assert(allocated_data_ptr);
     return allocated_data_ptr;
 }
 
@@ -152,47 +144,42 @@ struct LineItem {
 
 // Arrays for storing per-frame items.
 const int INITIAL_ITEM_COUNT = 100;
-Array<TextItem> text_items = array::get<TextItem>(INITIAL_ITEM_COUNT);
-Array<RectItem> rect_items = array::get<RectItem>(INITIAL_ITEM_COUNT);
-Array<RectItem> rect_items_bg = array::get<RectItem>(INITIAL_ITEM_COUNT);
-Array<TriangleItem> triangle_items = array::get<TriangleItem>(INITIAL_ITEM_COUNT);
-Array<LineItem> line_items = array::get<LineItem>(INITIAL_ITEM_COUNT);
+Array<TextItem> text_items = array::get<TextItem>(INITIAL_ITEM_COUNT, &frame_allocator);
+Array<RectItem> rect_items = array::get<RectItem>(INITIAL_ITEM_COUNT, &frame_allocator);
+Array<RectItem> rect_items_bg = array::get<RectItem>(INITIAL_ITEM_COUNT, &frame_allocator);
+Array<TriangleItem> triangle_items = array::get<TriangleItem>(INITIAL_ITEM_COUNT, &frame_allocator);
+Array<LineItem> line_items = array::get<LineItem>(INITIAL_ITEM_COUNT, &frame_allocator);
 
 // Helper function to store a rectangle for current frame.
 void add_rect(Vector2 pos, Vector2 size, Vector4 color, ShadingType shading=SOLID_COLOR) {
-    RectItem item = {color, pos, size, shading};
-    array::add(&rect_items, item);
+    array::emplace(&rect_items, color, pos, size, shading);
 }
 
 void add_rect_bg(Vector2 pos, Vector2 size, Vector4 color, ShadingType shading=SOLID_COLOR) {
-    RectItem item = {color, pos, size, shading};
-    array::add(&rect_items_bg, item);
+    array::emplace(&rect_items_bg, color, pos, size, shading);
 }
 
+// Text items are constructed directly in the array, so the text buffer is never copied.
 void add_text(Vector2 pos, Vector4 color, Vector2 origin, char *fmt_string, ...) {
-    TextItem item = {color, pos, origin};
+    TextItem *item = array::emplace(&text_items, color, pos, origin);
 
     // Print formatted string into buffer.
     va_list args;
     va_start(args, fmt_string);
-    vsnprintf(item.text, MAX_TEXT_LENGTH, fmt_string, args);
+    vsnprintf(item->text, MAX_TEXT_LENGTH, fmt_string, args);
     va_end(args);
-
-    array::add(&text_items, item);
 }
 
 // Helper functions to store a piece of text for current frame.
 void add_text(Vector2 pos, char *text, int text_length, Vector4 color, Vector2 origin=Vector2(0, 0)) {
-    TextItem item = {color, pos, origin};
+    TextItem *item = array::emplace(&text_items, color, pos, origin);
 
     // Copy text string.
-    if(text_length > MAX_TEXT_LENGTH) {
-        text_length = MAX_TEXT_LENGTH;
+    if(text_length > MAX_TEXT_LENGTH - 1) {
+        text_length = MAX_TEXT_LENGTH - 1;
     }
-    memcpy(item.text, text, text_length);
-    item.text[text_length] = 0;
-
-    array::add(&text_items, item);
+    memcpy(item->text, text, text_length);
+    item->text[text_length] = 0;
 }
 
 void add_text(Vector2 pos, char *text, Vector4 color, Vector2 origin=Vector2(0, 0)) {
@@ -201,18 +188,18 @@ void add_text(Vector2 pos, char *text, Vector4 color, Vector2 origin=Vector2(0,
 
 // Helper function to store a triangle for current frame.
 void add_triangle(Vector2 v1, Vector2 v2, Vector2 v3, Vector4 color) {
-    TriangleItem item = {color, v1, v2, v3};
-    array::add(&triangle_items, item);
+    array::emplace(&triangle_items, color, v1, v2, v3);
 }
 
 // Helper function to store a line for current frame.
 void add_line(Vector2 *points, int point_count, float width, Vector4 color) {
-    LineItem item = {color, points, point_count, width};
-    array::add(&line_items, item);
+    array::emplace(&line_items, color, points, point_count, width);
 }
 
 // Submits items for rendering.
 void ui::end_frame() {
+    HotScope hot_scope("ui::end_frame");
+
     for(uint32_t i = 0; i < rect_items_bg.count; ++i) {
         RectItem *item = &rect_items_bg.data[i];
         ui_draw::draw_rect(item->pos, item->size.x, item->size.y, item->color, item->shading);
@@ -238,13 +225,14 @@ void ui::end_frame() {
         ui_draw::draw_text(item->text, item->pos, item->color, item->origin);
     }
 
-    // Clear frame.
-    array::reset(&rect_items_bg);
-    array::reset(&rect_items);
-    array::reset(&triangle_items);
-    array::reset(&text_items);
-    array::reset(&line_items);
-    pool_top = 0;
+    // Clear frame. Arrays start the next frame with the capacity they grew to in this one,
+    // so in steady state they don't grow at all.
+    memory::load_stack_state(&frame_allocator, 0);
+    array::init(&rect_items_bg, rect_items_bg.size, &frame_allocator);
+    array::init(&rect_items, rect_items.size, &frame_allocator);
+    array::init(&triangle_items, triangle_items.size, &frame_allocator);
+    array::init(&text_items, text_items.size, &frame_allocator);
+    array::init(&line_items, line_items.size, &frame_allocator);
 }
 
 /*
@@ -358,6 +358,10 @@ uint16_t quad_indices[] = {
     2, 1, 0
 };
 
+// Moves the quad from [-1, 1] to [0, 1] x [-1, 0], so it's positioned by its top left corner. Folded at compile time
+// where matrix operators are constexpr.
+CPPLIB_MATHS_SIMD_CONSTEXPR const Matrix4x4 quad_top_left_matrix = math::get_translation(Vector3(0.5f, -0.5f, 0.0f)) * math::get_scale(0.5f);
+
 // These are essentially indices into a matrix of actual triangle points.
 float triangle_vertices[] = {
     1.0f, 0.0f, 0.0f,
@@ -707,8 +711,7 @@ void ui_draw::draw_text(char *text, float x, float y, Vector4 color, Vector2 ori
         Matrix4x4 model_matrix =
             math::get_translation(final_x, _ui_draw::screen_height - final_y, 0) * 
             math::get_scale((float)glyph.bitmap_width, (float)glyph.bitmap_height, 1.0f) *
-            math::get_translation(Vector3(0.5f, -0.5f, 0.0f)) *
-            math::get_scale(0.5f);
+            _ui_draw::quad_top_left_matrix;
         graphics::update_constant_buffer(&_ui_draw::buffer_model, &model_matrix);
 
         graphics::draw_mesh(&_ui_draw::quad_mesh);
@@ -750,8 +753,7 @@ void ui_draw::draw_rect(float x, float y, float width, float height, Vector4 col
     Matrix4x4 model_matrix =
         math::get_translation(x, _ui_draw::screen_height - y, 0) *
         math::get_scale(width, height, 1.0f) *
-        math::get_translation(Vector3(0.5f, -0.5f, 0.0f)) *
-        math::get_scale(0.5f);
+        _ui_draw::quad_top_left_matrix;
 
     // Update constant buffers
     graphics::update_constant_buffer(&_ui_draw::buffer_pv, pv_matrices);
@@ -796,8 +798,7 @@ void ui_draw::draw_rect_textured(float x, float y, float width, float height, Te
     Matrix4x4 model_matrix =
         math::get_translation(x, _ui_draw::screen_height - y, 0) *
         math::get_scale(width, height, 1.0f) *
-        math::get_translation(Vector3(0.5f, -0.5f, 0.0f)) *
-        math::get_scale(0.5f);
+        _ui_draw::quad_top_left_matrix;
     Vector4 source_rect = {0.0f, 0.0f, 1.0f, 1.0f};
 
     // Update constant buffers